@@ -0,0 +1,55 @@
+#!/bin/sh
+# Builds replay_benchmark three ways and compares them on the parse -> EMA -> CSV path:
+#   baseline  Release (-O3, compiler default target)
+#   lto       Release + LTO + -march=$MARCH
+#   pgo       the lto configuration rebuilt with a profile from the corpus
+#
+# Usage: bench/compare_builds.sh [build_root] [passes]
+# Environment: MARCH (default native), CMAKE_ARGS (extra configure arguments,
+# e.g. -DCMAKE_PREFIX_PATH=...), RUNS (benchmark runs per build, default 3)
+set -eu
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_ROOT=${1:-"$SOURCE_DIR/build/compare"}
+PASSES=${2:-20}
+MARCH=${MARCH:-native}
+RUNS=${RUNS:-3}
+CMAKE_ARGS=${CMAKE_ARGS:-}
+
+configure() {
+    dir=$1
+    shift
+    # shellcheck disable=SC2086
+    cmake -S "$SOURCE_DIR" -B "$dir" -DCMAKE_BUILD_TYPE=Release -DHFT_TOOLS_ONLY=ON $CMAKE_ARGS "$@" > "$dir.log" 2>&1 ||
+        { echo "configure failed, see $dir.log" >&2; exit 1; }
+}
+
+mkdir -p "$BUILD_ROOT"
+echo "building baseline..."
+configure "$BUILD_ROOT/baseline"
+cmake --build "$BUILD_ROOT/baseline" --target replay_benchmark -j >> "$BUILD_ROOT/baseline.log" 2>&1
+
+echo "building lto (-march=$MARCH)..."
+configure "$BUILD_ROOT/lto" -DHFT_LTO=ON -DHFT_MARCH="$MARCH"
+cmake --build "$BUILD_ROOT/lto" --target replay_benchmark -j >> "$BUILD_ROOT/lto.log" 2>&1
+
+echo "building pgo (two stages)..."
+cmake --build "$BUILD_ROOT/lto" --target pgo >> "$BUILD_ROOT/lto.log" 2>&1
+
+# Best of RUNS runs for each path: prints "parse parse+ema parse+ema+csv" in ns/frame
+best() {
+    i=0
+    while [ "$i" -lt "$RUNS" ]; do
+        "$1" "" "$PASSES" "$BUILD_ROOT/compare.csv"
+        i=$((i + 1))
+    done | awk '
+        $1 == "parse" || $1 == "parse+ema" || $1 == "parse+ema+csv" {
+            if (!($1 in b) || $2 < b[$1]) b[$1] = $2
+        }
+        END { printf "%12s %12s %16s\n", b["parse"], b["parse+ema"], b["parse+ema+csv"] }'
+}
+
+printf '\n%-10s %12s %12s %16s   (ns/frame, best of %s runs)\n' "build" "parse" "parse+ema" "parse+ema+csv" "$RUNS"
+for build in baseline lto lto/pgo; do
+    printf '%-10s %s\n' "$(basename "$build")" "$(best "$BUILD_ROOT/$build/replay_benchmark")"
+done
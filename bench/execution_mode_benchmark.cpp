@@ -0,0 +1,212 @@
+// Threaded against coroutine execution (HFTProcessor's two modes) for the
+// live pipeline minus its I/O sinks: sequence, EMAs, indicators, history.
+//
+// THREADED runs the pipeline on the receiving thread, as the ix callback does.
+// COROUTINES hands each ticker through an AsyncChannel to a coroutine on an
+// event loop. Measured per mode:
+//   - throughput with the receiver sending as fast as it can
+//   - latency from a tick's scheduled arrival to the end of the pipeline, with
+//     ticks arriving at a fixed gap (a busy feed, then a quiet one)
+//   - context switches of the whole process (getrusage)
+//
+// Needs HFT_COROUTINES (cmake -DHFT_COROUTINES=ON).
+//
+// Usage: execution_mode_benchmark [ticks]
+#include "event_loop.h"
+#include "tick_pipeline.h"
+#include "tick_stages.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<TickerData> makeTicks(size_t count) {
+    std::vector<TickerData> ticks(count);
+    for (size_t i = 0; i < count; ++i) {
+        ticks[i].type = "ticker";
+        ticks[i].product_id = "BTC-USD";
+        ticks[i].price = 50000.0 + (i % 1000) * 0.01;
+        ticks[i].best_bid = ticks[i].price - 0.5;
+        ticks[i].best_ask = ticks[i].price + 0.5;
+        ticks[i].mid_price = ticks[i].price;
+        ticks[i].time = "2024-01-01T00:00:00.000000Z";
+        ticks[i].timestamp = std::chrono::system_clock::now();
+    }
+    return ticks;
+}
+
+IndicatorConfig liveIndicators() {
+    IndicatorConfig config;
+    config.defaults = {
+        IndicatorSpec(IndicatorType::SMA, 20),
+        IndicatorSpec(IndicatorType::VOLATILITY, 50),
+        IndicatorSpec(IndicatorType::RSI, 14),
+        IndicatorSpec(IndicatorType::BOLLINGER, 20, 2.0),
+        IndicatorSpec(IndicatorType::SPREAD_EMA, 20)
+    };
+    return config;
+}
+
+long contextSwitches() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+// Pipeline state for one run; the last stage stamps when each tick finished
+struct Bench {
+    std::atomic<size_t> sequence{0}, updates{0};
+    EMACalculator price_ema{0.2}, mid_price_ema{0.2};
+    IndicatorEngine indicators{liveIndicators()};
+    TickHistory history{std::chrono::hours(1)};
+    std::vector<Clock::time_point> finished;
+    std::atomic<size_t> processed{0};
+    
+    explicit Bench(size_t ticks) : finished(ticks) {}
+    
+    auto pipeline() {
+        return makeTickPipeline(
+            SequenceStage{sequence},
+            EMAStage{price_ema, mid_price_ema, updates},
+            IndicatorStage{indicators},
+            HistoryStage{history},
+            [this](TickerData& ticker) {
+                finished[ticker.exchange_sequence] = Clock::now();
+                processed.store(processed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            });
+    }
+};
+
+template <typename Pipeline>
+Task consume(AsyncChannel<TickerData>& channel, Pipeline& pipeline) {
+    TickerData ticker;
+    while (true) {
+        bool open = co_await channel.wait();
+        if (!open) break;
+        while (channel.tryReceive(ticker)) {
+            pipeline.process(ticker);
+        }
+    }
+}
+
+struct Result {
+    double seconds = 0;
+    long switches = 0;
+    std::vector<double> latency_us;
+};
+
+// Feeds count ticks to deliver(ticker), one every gap (0 = back to back), and
+// returns the scheduled arrival of each
+template <typename Deliver>
+std::vector<Clock::time_point> feed(const std::vector<TickerData>& source, size_t count, Clock::duration gap,
+                                    Deliver deliver) {
+    std::vector<Clock::time_point> arrivals(count);
+    TickerData ticker;
+    Clock::time_point next = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        if (gap.count() > 0) {
+            next += gap;
+            // A transport waits in the kernel between frames; yield rather than hog a core
+            while (Clock::now() < next) {
+                std::this_thread::yield();
+            }
+        }
+        arrivals[i] = gap.count() > 0 ? next : Clock::now();
+        ticker = source[i % source.size()];    // what the parser leaves in its scratch ticker
+        ticker.exchange_sequence = i;
+        deliver(ticker);
+    }
+    return arrivals;
+}
+
+Result finish(Bench& bench, const std::vector<Clock::time_point>& arrivals, Clock::time_point start, long switches) {
+    Result result;
+    result.seconds = std::chrono::duration<double>(bench.finished.back() - start).count();
+    result.switches = contextSwitches() - switches;
+    result.latency_us.reserve(arrivals.size());
+    for (size_t i = 0; i < arrivals.size(); ++i) {
+        result.latency_us.push_back(std::chrono::duration<double, std::micro>(bench.finished[i] - arrivals[i]).count());
+    }
+    std::sort(result.latency_us.begin(), result.latency_us.end());
+    return result;
+}
+
+Result runThreaded(const std::vector<TickerData>& source, size_t count, Clock::duration gap) {
+    Bench bench(count);
+    auto pipeline = bench.pipeline();
+    long switches = contextSwitches();
+    Clock::time_point start = Clock::now();
+    std::vector<Clock::time_point> arrivals;
+    std::thread receiver([&]() {
+        arrivals = feed(source, count, gap, [&](TickerData& ticker) { pipeline.process(ticker); });
+    });
+    receiver.join();
+    return finish(bench, arrivals, start, switches);
+}
+
+Result runCoroutines(Logger& logger, const std::vector<TickerData>& source, size_t count, Clock::duration gap) {
+    Bench bench(count);
+    auto pipeline = bench.pipeline();
+    EventLoop loop(logger, "bench");
+    AsyncChannel<TickerData> channel(loop, 4096);
+    loop.start();
+    loop.spawn(consume(channel, pipeline));
+    
+    long switches = contextSwitches();
+    Clock::time_point start = Clock::now();
+    std::vector<Clock::time_point> arrivals;
+    std::thread receiver([&]() {
+        arrivals = feed(source, count, gap, [&](TickerData& ticker) { channel.send(ticker); });
+    });
+    receiver.join();
+    while (bench.processed.load(std::memory_order_acquire) < count) {
+        std::this_thread::yield();
+    }
+    Result result = finish(bench, arrivals, start, switches);
+    channel.close();
+    loop.stop();
+    return result;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+void report(const char* mode, const char* load, const Result& result, size_t count) {
+    std::printf("%-11s %-22s %10.0f %9.2f %9.2f %9.2f %9.2f %9ld\n", mode, load, count / result.seconds,
+                percentile(result.latency_us, 0.50), percentile(result.latency_us, 0.99),
+                percentile(result.latency_us, 0.999), result.latency_us.back(), result.switches);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Logger logger("", "", LogLevel::ERROR);
+    std::vector<TickerData> source = makeTicks(1024);
+    
+    // A busy feed (100k ticks/s) and a quiet one (1k ticks/s), where the loop sleeps between ticks
+    size_t busy = std::min<size_t>(count, 200000);
+    size_t quiet = std::min<size_t>(count, 2000);
+    const auto busy_gap = std::chrono::microseconds(10);
+    const auto quiet_gap = std::chrono::milliseconds(1);
+    
+    std::printf("%-11s %-22s %10s %9s %9s %9s %9s %9s\n", "mode", "load", "ticks/s", "p50 us", "p99 us",
+                "p99.9 us", "max us", "switches");
+    report("threaded", "back to back", runThreaded(source, count, Clock::duration::zero()), count);
+    report("coroutines", "back to back", runCoroutines(logger, source, count, Clock::duration::zero()), count);
+    report("threaded", "every 10 us", runThreaded(source, busy, busy_gap), busy);
+    report("coroutines", "every 10 us", runCoroutines(logger, source, busy, busy_gap), busy);
+    report("threaded", "every 1 ms", runThreaded(source, quiet, quiet_gap), quiet);
+    report("coroutines", "every 1 ms", runCoroutines(logger, source, quiet, quiet_gap), quiet);
+    std::printf("(ticks/s for the paced loads is the arrival rate; latency from scheduled arrival to pipeline end)\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Per-tick cost of the compile-time pipeline against the same stages called
+// through the type-erased wrapper and through a std::function chain. The
+// configuration is the minimal one: EMA plus the shared-memory snapshot sink.
+//
+// runCompiled() is the loop to inspect with objdump: it should contain no
+// indirect calls, only the direct calls into EMACalculator and the publisher.
+//
+// Usage: pipeline_benchmark [ticks]
+#include "tick_pipeline.h"
+#include "tick_stages.h"
+#include "logger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+
+const char* BENCH_SEGMENT = "/coinbase_hft_pipeline_bench";
+
+std::vector<TickerData> makeTicks(size_t count) {
+    std::vector<TickerData> ticks(count);
+    for (size_t i = 0; i < count; ++i) {
+        ticks[i].type = "ticker";
+        ticks[i].product_id = "BTC-USD";
+        ticks[i].price = 50000.0 + (i % 1000) * 0.01;
+        ticks[i].best_bid = ticks[i].price - 0.5;
+        ticks[i].best_ask = ticks[i].price + 0.5;
+        ticks[i].mid_price = ticks[i].price;
+        ticks[i].timestamp = std::chrono::system_clock::now();
+    }
+    return ticks;
+}
+
+template <typename Pipeline>
+BENCH_NOINLINE void runCompiled(Pipeline& pipeline, std::vector<TickerData>& ticks, size_t rounds) {
+    for (size_t round = 0; round < rounds; ++round) {
+        for (auto& ticker : ticks) {
+            pipeline.process(ticker);
+        }
+    }
+}
+
+BENCH_NOINLINE void runErased(AnyTickPipeline& pipeline, std::vector<TickerData>& ticks, size_t rounds) {
+    for (size_t round = 0; round < rounds; ++round) {
+        for (auto& ticker : ticks) {
+            pipeline.process(ticker);
+        }
+    }
+}
+
+BENCH_NOINLINE void runFunctions(std::vector<std::function<void(TickerData&)>>& stages, 
+                                 std::vector<TickerData>& ticks, size_t rounds) {
+    for (size_t round = 0; round < rounds; ++round) {
+        for (auto& ticker : ticks) {
+            for (auto& stage : stages) {
+                stage(ticker);
+            }
+        }
+    }
+}
+
+// Best of several passes so one noisy pass doesn't decide the comparison
+template <typename Run>
+double nsPerTick(Run run, size_t ticks) {
+    double best = 0;
+    for (int pass = 0; pass < 5; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / ticks;
+        best = (pass == 0 || ns < best) ? ns : best;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Logger logger("", "", LogLevel::ERROR);
+    SharedTickPublisher publisher(BENCH_SEGMENT, logger);
+    if (!publisher.isOpen()) {
+        std::fprintf(stderr, "cannot open shared memory segment\n");
+        return 1;
+    }
+    // A cache-resident batch replayed many times, so the stages rather than
+    // memory traffic decide the numbers
+    std::vector<TickerData> ticks = makeTicks(1024);
+    size_t rounds = count / ticks.size() > 0 ? count / ticks.size() : 1;
+    count = rounds * ticks.size();
+    
+    std::atomic<size_t> sequence{0}, updates{0};
+    EMACalculator price_ema(0.2), mid_price_ema(0.2);
+    
+    auto compiled = makeTickPipeline(
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates},
+        OptionalStage<false, CSVSinkStage>{},
+        SharedTickStage{publisher});
+    auto compiled_ema = makeTickPipeline(
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates},
+        OptionalStage<false, SharedTickStage>{publisher});
+    
+    AnyTickPipeline erased(makeTickPipeline(
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates},
+        SharedTickStage{publisher}));
+    AnyTickPipeline erased_ema(makeTickPipeline(
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates}));
+    
+    std::vector<std::function<void(TickerData&)>> functions = {
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates},
+        SharedTickStage{publisher}
+    };
+    std::vector<std::function<void(TickerData&)>> functions_ema = {
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates}
+    };
+    
+    // Warm caches and the publisher's slot lookup
+    runCompiled(compiled, ticks, rounds);
+    
+    std::printf("%-22s %12s %16s\n", "ns/tick", "EMA only", "EMA + shm sink");
+    std::printf("%-22s %12.2f %16.2f\n", "compile-time",
+                nsPerTick([&] { runCompiled(compiled_ema, ticks, rounds); }, count),
+                nsPerTick([&] { runCompiled(compiled, ticks, rounds); }, count));
+    std::printf("%-22s %12.2f %16.2f\n", "type-erased wrapper",
+                nsPerTick([&] { runErased(erased_ema, ticks, rounds); }, count),
+                nsPerTick([&] { runErased(erased, ticks, rounds); }, count));
+    std::printf("%-22s %12.2f %16.2f\n", "std::function chain",
+                nsPerTick([&] { runFunctions(functions_ema, ticks, rounds); }, count),
+                nsPerTick([&] { runFunctions(functions, ticks, rounds); }, count));
+    std::printf("(%zu ticks per pass)\n", count);
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Replays recorded ticker frames through the live parse -> EMA -> CSV path.
+// This is the PGO training workload and the benchmark used to compare
+// baseline, LTO and PGO builds (bench/compare_builds.sh).
+//
+// Three configurations are timed over the same frames: parsing alone, parsing
+// plus the EMA stages, and the full path with the CSV sink. Each pass replays
+// the whole corpus; the best pass is reported.
+//
+// Usage: replay_benchmark [corpus.ndjson] [passes] [csv_path]
+// An empty corpus argument selects the bundled corpus.
+#include "json_parser.h"
+#include "mapped_file.h"
+#include "tick_pipeline.h"
+#include "tick_stages.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef HFT_CORPUS_PATH
+#define HFT_CORPUS_PATH "bench/corpus/ticker_frames.ndjson"
+#endif
+
+namespace {
+
+std::vector<std::string_view> splitFrames(std::string_view text) {
+    std::vector<std::string_view> frames;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            frames.push_back(line);
+        }
+        if (end == std::string_view::npos) break;
+        text.remove_prefix(end + 1);
+    }
+    return frames;
+}
+
+// Runs every frame through the pipeline; frames the parser rejects are counted
+template <typename Frames>
+size_t replay(Frames& frame_pipeline, const std::vector<std::string_view>& frames) {
+    size_t rejected = 0;
+    for (const auto& frame : frames) {
+        try {
+            if (!frame_pipeline.onFrame(frame)) {
+                rejected++;
+            }
+        } catch (const std::exception&) {
+            rejected++;
+        }
+    }
+    return rejected;
+}
+
+template <typename Run>
+double bestNsPerFrame(Run run, size_t passes, size_t frames) {
+    double best = 0;
+    for (size_t pass = 0; pass < passes; ++pass) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+        best = (pass == 0 || ns < best) ? ns : best;
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string corpus_path = argc > 1 && argv[1][0] ? argv[1] : HFT_CORPUS_PATH;
+    size_t passes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+    std::string csv_path = argc > 3 ? argv[3] : "replay_benchmark.csv";
+    passes = std::max<size_t>(passes, 1);
+    
+    std::unique_ptr<MappedFile> corpus;
+    try {
+        corpus = std::make_unique<MappedFile>(corpus_path);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "cannot read corpus: %s\n", e.what());
+        return 1;
+    }
+    std::vector<std::string_view> frames = splitFrames(corpus->view());
+    if (frames.empty()) {
+        std::fprintf(stderr, "corpus %s has no frames\n", corpus_path.c_str());
+        return 1;
+    }
+    
+    Logger logger("", "", LogLevel::ERROR);
+    JSONParser parser(logger);
+    std::atomic<size_t> sequence{0}, updates{0};
+    EMACalculator price_ema(0.2), mid_price_ema(0.2);
+    
+    auto parse_only = makeTickPipeline(SequenceStage{sequence});
+    auto with_ema = makeTickPipeline(
+        SequenceStage{sequence},
+        EMAStage{price_ema, mid_price_ema, updates});
+    
+    FramePipeline<JSONParser, decltype(parse_only)> parse_frames(parser, parse_only);
+    FramePipeline<JSONParser, decltype(with_ema)> ema_frames(parser, with_ema);
+    
+    size_t rejected = replay(parse_frames, frames);
+    double parse_ns = bestNsPerFrame([&] { replay(parse_frames, frames); }, passes, frames.size());
+    double ema_ns = bestNsPerFrame([&] { replay(ema_frames, frames); }, passes, frames.size());
+    
+    double csv_ns = 0;
+    size_t rows = 0;
+    {
+        CSVWriter writer(csv_path, logger);
+        auto with_csv = makeTickPipeline(
+            SequenceStage{sequence},
+            EMAStage{price_ema, mid_price_ema, updates},
+            CSVSinkStage{writer});
+        FramePipeline<JSONParser, decltype(with_csv)> csv_frames(parser, with_csv);
+        csv_ns = bestNsPerFrame([&] { replay(csv_frames, frames); }, passes, frames.size());
+        rows = writer.getRecordsWritten();
+    }
+    std::remove(csv_path.c_str());
+    
+    std::printf("corpus: %s (%zu frames, %zu rejected), %zu passes\n",
+                corpus_path.c_str(), frames.size(), rejected, passes);
+    std::printf("%-18s %10s %14s\n", "path", "ns/frame", "frames/s");
+    std::printf("%-18s %10.1f %14.0f\n", "parse", parse_ns, 1e9 / parse_ns);
+    std::printf("%-18s %10.1f %14.0f\n", "parse+ema", ema_ns, 1e9 / ema_ns);
+    std::printf("%-18s %10.1f %14.0f\n", "parse+ema+csv", csv_ns, 1e9 / csv_ns);
+    std::printf("(%zu CSV rows written)\n", rows);
+    return 0;
+}
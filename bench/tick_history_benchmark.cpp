@@ -0,0 +1,99 @@
+// Memory and query throughput of TickHistory on a synthetic quote stream:
+// cent-priced random walk, bid/ask a few ticks apart, exponential arrival
+// times with microsecond jitter (mean gap 5 ms).
+//
+// Usage: tick_history_benchmark [ticks]
+#include "tick_history.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    
+    std::mt19937_64 rng(39);
+    std::exponential_distribution<double> gap_ms(1.0 / 5.0);
+    std::discrete_distribution<int> step({1, 3, 12, 3, 1});     // price move of -2..+2 cents
+    std::discrete_distribution<int> spread({6, 3, 1});          // 1..3 cents
+    
+    std::vector<TickerData> ticks(count);
+    auto time = std::chrono::system_clock::time_point() + std::chrono::hours(24 * 365 * 55);
+    int64_t cents = 5000000;
+    for (auto& ticker : ticks) {
+        ticker.product_id = "BTC-USD";
+        cents += step(rng) - 2;
+        time += std::chrono::microseconds(static_cast<int64_t>(gap_ms(rng) * 1000.0) + 1);
+        ticker.timestamp = time;
+        ticker.best_bid = static_cast<double>(cents) / 100.0;
+        ticker.best_ask = static_cast<double>(cents + 1 + spread(rng)) / 100.0;
+        ticker.price = rng() % 2 ? ticker.best_ask : ticker.best_bid;
+    }
+    
+    TickHistory history(std::chrono::hours(24 * 365));
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& ticker : ticks) {
+        history.append(ticker);
+    }
+    double append_seconds = secondsSince(start);
+    
+    size_t bytes = history.getMemoryBytes();
+    int64_t first_us = std::chrono::duration_cast<std::chrono::microseconds>(ticks.front().timestamp.time_since_epoch()).count();
+    int64_t last_us = std::chrono::duration_cast<std::chrono::microseconds>(ticks.back().timestamp.time_since_epoch()).count();
+    
+    std::printf("ticks: %zu over %.1f h, %zu blocks\n", count, (last_us - first_us) / 3.6e9, history.getBlockCount());
+    std::printf("memory: %zu bytes, %.2f bytes/tick, %.2f MB per million ticks (HistoryTick is %zu bytes raw)\n",
+                bytes, double(bytes) / count, double(bytes) / count, sizeof(HistoryTick));
+    std::printf("append: %.1f ns/tick\n", append_seconds * 1e9 / count);
+    
+    // Full decode, checking every tick comes back exactly
+    size_t mismatches = 0, index = 0;
+    start = std::chrono::steady_clock::now();
+    size_t scanned = history.forEach("BTC-USD", first_us, last_us, [&](const HistoryTick& tick) {
+        const TickerData& original = ticks[index++];
+        mismatches += tick.price != original.price || tick.best_bid != original.best_bid ||
+                      tick.best_ask != original.best_ask;
+    });
+    double scan_seconds = secondsSince(start);
+    std::printf("full scan: %.1f M ticks/s (%zu ticks, %zu mismatches)\n", scanned / scan_seconds / 1e6, scanned, mismatches);
+    
+    // Random windows: decode-based iteration vs summary-based aggregation
+    std::uniform_int_distribution<int64_t> at(first_us, last_us);
+    const int queries = 20000;
+    int64_t minute = 60 * 1000000LL;
+    size_t visited = 0;
+    double checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        int64_t from = at(rng);
+        visited += history.forEach("BTC-USD", from, from + minute, [&](const HistoryTick& tick) { checksum += tick.price; });
+    }
+    double iterate_seconds = secondsSince(start);
+    std::printf("1 min forEach:     %9.0f queries/s (%.0f ticks per query)\n",
+                queries / iterate_seconds, double(visited) / queries);
+    
+    for (int64_t window : {minute, 60 * minute}) {
+        size_t aggregated = 0;
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; ++q) {
+            int64_t from = at(rng);
+            HistoryAggregate result = history.aggregate("BTC-USD", from, from + window);
+            aggregated += result.count;
+            checksum += result.meanPrice();
+        }
+        double aggregate_seconds = secondsSince(start);
+        std::printf("%s aggregate: %9.0f queries/s (%.0f ticks per query)\n", window == minute ? "1 min" : "1 h  ",
+                    queries / aggregate_seconds, double(aggregated) / queries);
+    }
+    std::printf("(checksum %.2f)\n", checksum);
+    return mismatches == 0 ? 0 : 1;
+}
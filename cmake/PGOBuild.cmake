@@ -0,0 +1,47 @@
+# Two-stage profile-guided build, run by the `pgo` target:
+#   1. configure BUILD_DIR with HFT_PGO=GENERATE and build replay_benchmark
+#   2. replay the corpus through it to record a profile
+#   3. reconfigure the same directory with HFT_PGO=USE and rebuild everything
+# Both stages use the same build directory: GCC matches profiles to object
+# files by path, so the optimized objects must be built where they were trained.
+#
+# Expects SOURCE_DIR, BUILD_DIR, GENERATOR, INITIAL_CACHE (compiler, LTO,
+# -march and dependency settings of the parent build), CXX_COMPILER,
+# CXX_COMPILER_ID and CORPUS.
+
+set(PROFILE_DIR "${BUILD_DIR}/pgo-profile")
+set(TRAINING_PASSES 30)
+
+function(run_step description)
+    message(STATUS "PGO: ${description}")
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "PGO: ${description} failed (${result})")
+    endif()
+endfunction()
+
+set(CONFIGURE_ARGS
+    -S "${SOURCE_DIR}" -B "${BUILD_DIR}" -G "${GENERATOR}"
+    -C "${INITIAL_CACHE}"
+    -DCMAKE_BUILD_TYPE=Release
+    "-DHFT_PGO_PROFILE_DIR=${PROFILE_DIR}")
+
+# Stage 1: instrumented build and training run
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+run_step("configuring instrumented build" ${CMAKE_COMMAND} ${CONFIGURE_ARGS} -DHFT_PGO=GENERATE)
+run_step("building instrumented replay_benchmark" ${CMAKE_COMMAND} --build "${BUILD_DIR}" --target replay_benchmark)
+run_step("training on ${CORPUS}"
+    "${BUILD_DIR}/replay_benchmark" "${CORPUS}" ${TRAINING_PASSES} "${BUILD_DIR}/pgo-training.csv")
+
+# Clang writes raw profiles that have to be merged before use; GCC reads its .gcda files directly
+if(CXX_COMPILER_ID MATCHES "Clang")
+    get_filename_component(COMPILER_DIR "${CXX_COMPILER}" DIRECTORY)
+    find_program(LLVM_PROFDATA NAMES llvm-profdata HINTS "${COMPILER_DIR}" REQUIRED)
+    file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+    run_step("merging profiles" "${LLVM_PROFDATA}" merge -o "${PROFILE_DIR}/merged.profdata" ${RAW_PROFILES})
+endif()
+
+# Stage 2: optimized rebuild of every target
+run_step("configuring optimized build" ${CMAKE_COMMAND} ${CONFIGURE_ARGS} -DHFT_PGO=USE)
+run_step("building with profile" ${CMAKE_COMMAND} --build "${BUILD_DIR}")
+message(STATUS "PGO: optimized binaries are in ${BUILD_DIR}")
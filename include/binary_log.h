@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR
+};
+
+enum class LogFormat {
+    TEXT,       // one formatted line per message, as always
+    BINARY      // template IDs and raw arguments; tools/log_decode turns it back into text
+};
+
+// A log message with its variable parts left out: "{}" takes the next
+// argument (integers and strings as written, doubles as std::to_string does)
+// and "{:.Nf}" a double with N decimals. Declare templates once, at namespace
+// scope; each gets a process-wide ID the binary log refers to.
+//
+//   static const LogTemplate PROGRESS("Progress: {} messages processed");
+//   logger.log(LogLevel::INFO, PROGRESS, message_number);
+class LogTemplate {
+private:
+    uint32_t id;
+    std::string_view format;
+
+public:
+    explicit LogTemplate(std::string_view text);
+    constexpr LogTemplate(uint32_t builtin_id, std::string_view text) : id(builtin_id), format(text) {}
+    
+    uint32_t getId() const { return id; }
+    std::string_view getFormat() const { return format; }
+};
+
+// Binary log layout: the magic, then records that each start with a tag byte.
+// Integers are LEB128 varints (v), signed ones zigzag-encoded; f64 is raw.
+//
+//   'B' i64 unix microseconds                  session start; timestamps below are deltas from it
+//   'T' v id, v length, text                   template definition, before first use in a session
+//   'L' v zigzag time delta, u8 level, v template id, v length, arguments
+//   'R' v length, text                         verbatim text (file banners)
+//
+// Level 255 marks a test-log line, which has no level column. Each argument
+// is a type byte and its value: 'i' zigzag v, 'u' v, 'd' f64, 's' v length + bytes.
+namespace binlog {
+
+constexpr char MAGIC[8] = {'H', 'F', 'T', 'B', 'L', 'O', 'G', '1'};
+constexpr uint8_t TEST_LEVEL = 255;
+
+// Built-in templates: plain string messages and the two test-line shapes
+extern const LogTemplate MESSAGE;
+extern const LogTemplate TEST;
+extern const LogTemplate TEST_DETAILS;
+
+inline void putRaw(std::string& out, const void* data, size_t length) {
+    out.append(static_cast<const char*>(data), length);
+}
+
+inline void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline void encodeArgument(std::string& out, std::string_view value) {
+    out += 's';
+    putVarint(out, value.size());
+    out.append(value.data(), value.size());
+}
+
+inline void encodeArgument(std::string& out, const std::string& value) { encodeArgument(out, std::string_view(value)); }
+inline void encodeArgument(std::string& out, const char* value) { encodeArgument(out, std::string_view(value)); }
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type encodeArgument(std::string& out, T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        double converted = static_cast<double>(value);
+        out += 'd';
+        putRaw(out, &converted, sizeof(converted));
+    } else if constexpr (std::is_signed<T>::value) {
+        out += 'i';
+        putVarint(out, zigzag(static_cast<int64_t>(value)));
+    } else {
+        out += 'u';
+        putVarint(out, static_cast<uint64_t>(value));
+    }
+}
+
+inline void encodeArguments(std::string&) {}
+
+template <typename First, typename... Rest>
+void encodeArguments(std::string& out, const First& first, const Rest&... rest) {
+    encodeArgument(out, first);
+    encodeArguments(out, rest...);
+}
+
+// Appends the template with its encoded arguments substituted. Missing
+// arguments render as "{}"; false if the argument bytes are malformed.
+bool render(std::string& out, std::string_view format, std::string_view arguments);
+
+// Appends format from cursor up to the next placeholder and moves cursor past
+// it, reading its precision (-1 for "{}"); false once none is left, with the
+// rest of the format appended
+bool appendUntilPlaceholder(std::string& out, std::string_view format, size_t& cursor, int& precision);
+
+void appendSigned(std::string& out, int64_t value);
+void appendUnsigned(std::string& out, uint64_t value);
+void appendDouble(std::string& out, double value, int precision);
+
+inline void formatArgument(std::string& out, std::string_view value, int) { out.append(value.data(), value.size()); }
+inline void formatArgument(std::string& out, const std::string& value, int) { out.append(value); }
+inline void formatArgument(std::string& out, const char* value, int precision) {
+    formatArgument(out, std::string_view(value), precision);
+}
+
+template <typename T>
+typename std::enable_if<std::is_arithmetic<T>::value>::type formatArgument(std::string& out, T value, int precision) {
+    if constexpr (std::is_floating_point<T>::value) {
+        appendDouble(out, static_cast<double>(value), precision);
+    } else if constexpr (std::is_signed<T>::value) {
+        appendSigned(out, static_cast<int64_t>(value));
+    } else {
+        appendUnsigned(out, static_cast<uint64_t>(value));
+    }
+}
+
+inline void formatArguments(std::string& out, std::string_view format, size_t& cursor) {
+    out.append(format.data() + cursor, format.size() - cursor);
+    cursor = format.size();
+}
+
+template <typename First, typename... Rest>
+void formatArguments(std::string& out, std::string_view format, size_t& cursor, const First& first, const Rest&... rest) {
+    int precision;
+    if (!appendUntilPlaceholder(out, format, cursor, precision)) return;
+    formatArgument(out, first, precision);
+    formatArguments(out, format, cursor, rest...);
+}
+
+// Appends the template with the arguments substituted, exactly as render()
+// prints them once encoded; the text log formats this way, with no encoding
+template <typename... Args>
+void formatMessage(std::string& out, std::string_view format, const Args&... args) {
+    size_t cursor = 0;
+    formatArguments(out, format, cursor, args...);
+}
+
+// "YYYY-MM-DD HH:MM:SS.ffffff" in local time, as the text log writes it
+void appendTimestamp(std::string& out, int64_t unix_micros);
+std::string formatTimestamp(int64_t unix_micros);
+
+const char* levelName(uint8_t level);
+
+// Appends the text-log lines for a whole binary log. Throws std::runtime_error
+// on a bad magic; a truncated last record (crash mid-write) is left out.
+size_t decode(std::string_view data, std::string& out);
+
+} // namespace binlog
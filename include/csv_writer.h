@@ -1,23 +1,68 @@
 #pragma once
 #include "ticker_data.h"
 #include "logger.h"
-#include <fstream>
+#include "segment_compressor.h"
+#include "file_sink.h"
+#include "metrics.h"
+#include <array>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
+
+struct CSVWriterOptions {
+    size_t max_file_bytes = 0;                  // roll over past this size, 0 = never
+    std::chrono::seconds max_file_age{0};       // roll over after this long, 0 = never
+    bool compress_closed_segments = false;      // gzip rolled segments off the write path
+    bool append_on_restart = false;             // keep an existing file instead of replacing it
+    FileSinkBackend backend = FileSinkBackend::AUTO;
+    std::vector<std::string> extra_columns;     // appended to the header, e.g. indicator names
+};
 
 class CSVWriter {
 private:
-    std::ofstream csv_file;
+    std::unique_ptr<FileSink> csv_sink;
     std::mutex csv_mutex;
     Logger& logger;
     bool header_written;
+    std::string header;
     size_t records_written;
+    std::vector<char> row_buffer;
+    
+    // Rolling output: the active file keeps the configured name and closed
+    // segments are renamed with the time they were opened
+    std::string filename;
+    CSVWriterOptions options;
+    size_t current_file_bytes;
+    std::chrono::system_clock::time_point current_file_opened;
+    size_t segments_rolled;
+    std::unique_ptr<SegmentCompressor> compressor;
+    
+    MetricCounter& rows_metric;
+    MetricCounter& segments_metric;
+    MetricHistogram& flush_latency_metric;
 
 public:
-    CSVWriter(const std::string& filename, Logger& log);
+    CSVWriter(const std::string& path, Logger& log, const CSVWriterOptions& opts = CSVWriterOptions());
     ~CSVWriter();
     
     void writeHeader();
     void writeTickerData(const TickerData& ticker);
     void flush();
+    
+    // Waits for every outstanding write and closes the file; later rows are dropped.
+    // Returns false if any write was lost. The destructor closes too.
+    bool close();
     size_t getRecordsWritten() const { return records_written; }
+    size_t getSegmentsRolled() const { return segments_rolled; }
+    size_t getSegmentsCompressed() const { return compressor ? compressor->getSegmentsCompressed() : 0; }
+    const char* getBackendName() const { return csv_sink->backendName(); }
+    
+private:
+    bool rollingEnabled() const { return options.max_file_bytes > 0 || options.max_file_age.count() > 0; }
+    void openActiveFile(bool append);
+    void writeHeaderLocked();
+    void rollOver();
+    std::string segmentName(std::chrono::system_clock::time_point opened) const;
 };
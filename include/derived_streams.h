@@ -0,0 +1,140 @@
+#pragma once
+#include "ema_calculator.h"
+#include "ticker_data.h"
+#include "state_checkpoint.h"
+#include "metrics.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class DerivedType {
+    RATIO,      // inputs[0] / inputs[1], e.g. ETH-BTC implied from ETH-USD and BTC-USD
+    SPREAD,     // inputs[0] - hedge * inputs[1]
+    BASKET      // sum of weights[i] * inputs[i]
+};
+
+struct DerivedSpec {
+    DerivedType type;
+    std::string name;                   // synthetic product id written to the sinks; at most 15 chars
+    std::vector<std::string> inputs;
+    std::vector<double> weights;        // linear coefficients; unused for RATIO
+    
+    static DerivedSpec ratio(const std::string& name, const std::string& numerator, const std::string& denominator);
+    static DerivedSpec spread(const std::string& name, const std::string& long_leg, const std::string& short_leg,
+                              double hedge = 1.0);
+    static DerivedSpec basket(const std::string& name, const std::vector<std::string>& products,
+                              const std::vector<double>& weights);
+};
+
+// Cross-product values kept up to date from a dependency graph. Each input
+// product lists the derived streams that read it, so a tick recomputes just
+// those streams: O(fan-out) work, never a scan over every product. Spreads and
+// baskets are linear and are updated by the ticking input's delta alone.
+//
+// A stream emits a synthetic ticker (type "derived") once every input has
+// ticked. Its bid is the worst price at which the combination could be sold
+// from the inputs' quotes (e.g. ETH bid / BTC ask for ETH-BTC), its ask the
+// worst buy, and its mid the average of the two. Each stream has its own EMAs.
+class DerivedStreamEngine {
+private:
+    enum Field { PRICE = 0, BID = 1, ASK = 2, FIELDS = 3 };
+    
+    struct Edge {
+        uint32_t stream;
+        uint32_t slot;                  // position of the input in the stream's spec
+    };
+    
+    struct InputState {
+        double values[FIELDS] = {0.0, 0.0, 0.0};
+        bool ticked = false;
+        std::vector<Edge> dependents;
+    };
+    
+    struct DerivedStream {
+        DerivedSpec spec;
+        std::vector<uint32_t> inputs;
+        uint32_t missing;               // inputs that have not ticked yet
+        double sums[FIELDS] = {0.0, 0.0, 0.0};     // running linear combination
+        uint32_t updates_since_resync = 0;
+        EMACalculator price_ema;
+        EMACalculator mid_price_ema;
+        TickerData ticker;              // reused for every emitted tick
+        
+        DerivedStream(const DerivedSpec& derived_spec, double alpha)
+            : spec(derived_spec), missing(0), price_ema(alpha), mid_price_ema(alpha) {}
+    };
+    
+    std::vector<InputState> inputs;
+    std::unordered_map<std::string, uint32_t> input_index;
+    std::vector<std::string> input_names;
+    std::vector<DerivedStream> streams;
+    std::string last_product;
+    int last_input;
+    
+    // Statistics
+    std::atomic<size_t> input_ticks{0};
+    std::atomic<size_t> derived_ticks{0};
+    MetricCounter& derived_metric;
+
+public:
+    explicit DerivedStreamEngine(const std::vector<DerivedSpec>& specs, double ema_alpha = 0.2);
+    
+    DerivedStreamEngine(const DerivedStreamEngine&) = delete;
+    DerivedStreamEngine& operator=(const DerivedStreamEngine&) = delete;
+    
+    bool empty() const { return streams.empty(); }
+    
+    // Every product some stream reads, in first-use order
+    const std::vector<std::string>& inputProducts() const { return input_names; }
+    
+    // Records the ticker's quotes and passes each derived ticker it changes to
+    // emit(TickerData&). Returns the number emitted; 0 for unrelated products.
+    template <typename Emit>
+    size_t update(const TickerData& ticker, Emit&& emit) {
+        int input = inputFor(ticker.product_id);
+        if (input < 0) return 0;
+        
+        recordInput(static_cast<uint32_t>(input), ticker);
+        size_t emitted = 0;
+        for (const Edge& edge : inputs[input].dependents) {
+            DerivedStream& stream = streams[edge.stream];
+            if (stream.missing == 0 && computeStream(stream, ticker)) {
+                emit(stream.ticker);
+                emitted++;
+            }
+        }
+        derived_ticks.fetch_add(emitted, std::memory_order_relaxed);
+        derived_metric.increment(emitted);
+        return emitted;
+    }
+    
+    size_t getStreamCount() const { return streams.size(); }
+    size_t getInputTicks() const { return input_ticks; }
+    size_t getDerivedTicks() const { return derived_ticks; }
+    
+    // Checkpoint support: only the EMAs are kept. Input quotes are not, so a
+    // restored stream waits for every input to tick again before emitting.
+    // As in IndicatorEngine, readState parses the section without applying it.
+    struct SavedStream {
+        std::string name;
+        double alpha;
+        double price_ema;
+        bool price_initialized;
+        double mid_price_ema;
+        bool mid_initialized;
+    };
+    using SavedState = std::vector<SavedStream>;
+    
+    void saveState(CheckpointWriter& out) const;
+    static SavedState readState(CheckpointReader& in);
+    size_t restoreState(const SavedState& state);
+    size_t restoreState(CheckpointReader& in) { return restoreState(readState(in)); }
+
+private:
+    int inputFor(const std::string& product_id);
+    void recordInput(uint32_t input, const TickerData& ticker);
+    bool computeStream(DerivedStream& stream, const TickerData& trigger);
+    void resync(DerivedStream& stream);
+};
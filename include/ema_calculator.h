@@ -14,6 +14,9 @@ public:
     bool isInitialized() const;
     void reset();
     
+    // Warm start from a checkpoint
+    void restore(double ema, bool was_initialized);
+    
     // For testing
     double getAlpha() const { return alpha; }
 };
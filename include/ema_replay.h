@@ -0,0 +1,96 @@
+#pragma once
+#include "mapped_file.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct EMAReplayOptions {
+    double price_alpha = 0.2;
+    double mid_price_alpha = 0.2;
+    size_t threads = 0;             // 0 = one per hardware thread
+};
+
+struct EMAReplayStats {
+    size_t rows = 0;
+    size_t malformed_rows = 0;
+    size_t products = 0;
+    size_t threads = 0;
+    double index_seconds = 0.0;     // scanning and parsing, parallel by byte range
+    double compute_seconds = 0.0;   // EMA recomputation, parallel by product
+    double output_seconds = 0.0;
+};
+
+// Fixed-size record of the binary output, after a header of
+// "HFTEMAB1", uint32 product count, (uint32 length, name) per product, uint64 rows
+struct EMAReplayRecord {
+    uint64_t sequence_number;
+    int64_t timestamp_us;
+    uint32_t product;
+    uint32_t reserved;
+    double price;
+    double mid_price;
+    double price_ema;
+    double mid_price_ema;
+};
+
+// Recomputes EMAs over captured ticker_data.csv files. Files are mapped, not
+// copied; rows are parsed in place and each product's rows are run through
+// EMACalculator in file order.
+//
+// The EMA is recomputed from the rows in the file only. The live app conflates
+// its CSV (at most one row per product per 100 ms, sooner on a 5 bp move; see
+// liveConflationOptions in hft_processor.cpp), while its EMAs saw every tick, so
+// a replay of a conflated capture does not reproduce the live EMA columns; it
+// gives the EMA of the subsample. Only a capture written with conflation off
+// (one row per tick) replays to the live values with the same alpha.
+class EMAReplay {
+private:
+    struct Row {
+        const char* line;
+        uint32_t length;
+        uint32_t product;
+        uint64_t sequence_number;
+        int64_t timestamp_us;
+        double price;
+        double mid_price;
+    };
+    
+    struct Chunk;
+    
+    EMAReplayOptions options;
+    std::vector<std::unique_ptr<MappedFile>> inputs;
+    std::string header;
+    std::vector<Row> rows;
+    std::vector<std::string> products;
+    std::vector<double> price_emas;
+    std::vector<double> mid_price_emas;
+    EMAReplayStats stats;
+
+public:
+    explicit EMAReplay(const EMAReplayOptions& replay_options = EMAReplayOptions());
+    ~EMAReplay();
+    
+    // Inputs are replayed in the order added; EMAs carry across files
+    void addInput(const std::string& path);
+    
+    const EMAReplayStats& run();
+    
+    // Input rows with price_ema and mid_price_ema replaced; other columns verbatim
+    void writeCSV(const std::string& path);
+    void writeBinary(const std::string& path);
+    
+    size_t rowCount() const { return rows.size(); }
+    double priceEMA(size_t row) const { return price_emas[row]; }
+    double midPriceEMA(size_t row) const { return mid_price_emas[row]; }
+    const std::string& productOf(size_t row) const { return products[rows[row].product]; }
+    const EMAReplayStats& getStats() const { return stats; }
+    
+    // Parses one CSV data row; false if it is malformed. Exposed for tests.
+    static bool parseRow(std::string_view line, std::string_view& product, uint64_t& sequence_number,
+                         int64_t& timestamp_us, double& price, double& mid_price);
+
+private:
+    void indexChunk(std::string_view text, Chunk& chunk) const;
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct ssl_st;
+struct ssl_ctx_st;
+
+struct EpollWebSocketOptions {
+    size_t receive_buffer_bytes = 256 * 1024;   // grows when a single frame is larger
+    bool busy_poll = false;                     // spin on epoll_wait(0) instead of sleeping
+    int socket_busy_poll_us = 0;                // SO_BUSY_POLL, 0 = off
+    int socket_receive_buffer = 0;              // SO_RCVBUF, 0 = kernel default
+    int cpu = -1;                               // pin the I/O thread, -1 = no pinning
+    std::chrono::milliseconds connect_timeout{10000};       // TCP, TLS and upgrade together
+    std::chrono::milliseconds reconnect_delay{1000};
+};
+
+enum class WebSocketEventType { OPEN, MESSAGE, CLOSE, ERROR };
+
+struct WebSocketEvent {
+    WebSocketEventType type;
+    std::string_view payload;       // MESSAGE only; valid until the callback returns
+    uint16_t close_code = 0;
+    std::string reason;             // CLOSE and ERROR
+};
+
+// WebSocket client transport on a non-blocking socket and epoll, with TLS from
+// OpenSSL for wss:// URLs. Frames are parsed in place in one reusable receive
+// buffer and every message is passed to the callback as a string_view into it,
+// on the transport's own I/O thread: no copy, allocation or thread handoff per
+// message. Only fragmented messages are reassembled in a side buffer.
+//
+// Like ix, it reconnects after reconnect_delay until stop(). Linux only, and
+// isAvailable() is false when built without OpenSSL.
+class EpollWebSocket {
+public:
+    using EventCallback = std::function<void(const WebSocketEvent&)>;
+
+private:
+    Logger& logger;
+    EpollWebSocketOptions options;
+    std::string url;
+    std::string host;
+    std::string port;
+    std::string path;
+    bool use_tls;
+    EventCallback callback;
+    
+    std::thread io_thread;
+    std::thread::id io_thread_id;
+    std::atomic<bool> running{false};
+    std::atomic<bool> open{false};
+    std::atomic<bool> close_requested{false};
+    int epoll_fd;
+    int wake_fd;
+    int socket_fd;
+    ssl_ctx_st* ssl_context;
+    ssl_st* ssl;
+    
+    // I/O thread only
+    std::vector<char> receive_buffer;
+    size_t buffer_begin;
+    size_t buffer_end;
+    std::string fragments;          // a message split over several frames
+    uint8_t fragment_opcode;
+    std::vector<char> frame_buffer; // outgoing frame being masked
+    uint32_t mask_state;
+    std::string last_error;
+    uint16_t close_code;
+    std::string close_reason;
+    
+    // Sends from other threads wait here for the I/O thread
+    std::mutex send_mutex;
+    std::vector<std::string> pending_sends;
+    uint16_t requested_close_code;
+    std::string requested_close_reason;
+    
+    // Statistics
+    std::atomic<size_t> connections{0};
+    std::atomic<size_t> messages_received{0};
+    std::atomic<size_t> bytes_received{0};
+
+public:
+    explicit EpollWebSocket(Logger& log, const EpollWebSocketOptions& opts = EpollWebSocketOptions());
+    ~EpollWebSocket();
+    
+    EpollWebSocket(const EpollWebSocket&) = delete;
+    EpollWebSocket& operator=(const EpollWebSocket&) = delete;
+    
+    static bool isAvailable();
+    
+    // ws://host[:port]/path or wss://...; throws std::invalid_argument otherwise
+    void setUrl(const std::string& ws_url);
+    void setEventCallback(EventCallback event_callback) { callback = std::move(event_callback); }
+    
+    void start();
+    void stop();
+    
+    // One text frame. On the I/O thread (e.g. from the OPEN event) it is
+    // written at once; from other threads it is queued. False when not open.
+    bool send(std::string_view text);
+    
+    // Ends the current connection with a close frame; it reconnects after reconnect_delay
+    void close(uint16_t code, const std::string& reason);
+    
+    bool isOpen() const { return open; }
+    size_t getConnections() const { return connections; }
+    size_t getMessagesReceived() const { return messages_received; }
+    size_t getBytesReceived() const { return bytes_received; }
+    
+    // Sec-WebSocket-Accept for a Sec-WebSocket-Key (RFC 6455 section 4.2.2)
+    static std::string acceptKey(const std::string& client_key);
+
+private:
+    void ioLoop();
+    bool connectSocket(std::chrono::steady_clock::time_point deadline);
+    bool startTLS(std::chrono::steady_clock::time_point deadline);
+    bool upgrade(std::chrono::steady_clock::time_point deadline);
+    void readLoop();
+    void disconnect();
+    bool waitFor(short events, std::chrono::steady_clock::time_point deadline);
+    long readSome(char* data, size_t length);
+    bool writeAll(const char* data, size_t length);
+    bool fillBuffer();
+    bool parseFrames();
+    bool sendFrame(uint8_t opcode, const char* payload, size_t length);
+    bool flushPendingSends();
+    void emit(WebSocketEventType type, std::string_view payload = std::string_view(), uint16_t code = 0,
+              const std::string& reason = std::string());
+    void wake();
+};
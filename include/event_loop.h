@@ -0,0 +1,299 @@
+#pragma once
+// C++20 coroutine runtime for HFTProcessor's COROUTINES execution mode. Only
+// built with HFT_COROUTINES (cmake -DHFT_COROUTINES=ON, which compiles as C++20);
+// the rest of the tree stays C++17 and this header is empty without it.
+#ifdef HFT_COROUTINES
+
+#include "logger.h"
+#include "spsc_ring.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EventLoop;
+
+// A coroutine run detached on an event loop: it starts suspended, and
+// EventLoop::spawn() schedules it and frees its frame once it finishes.
+// An exception escaping it is logged by the loop.
+class Task {
+public:
+    struct promise_type {
+        EventLoop* loop = nullptr;
+        
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        
+        void return_void() {}
+        void unhandled_exception();
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+    
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+    friend class EventLoop;
+
+public:
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+    
+    // Never spawned: the frame is freed without running
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+};
+
+struct EventLoopOptions {
+    // Before sleeping, an idle loop polls for this long so a tick arriving
+    // just after the last one is picked up without a futex wake-up. 0 = never
+    // spin; ignored on a single core.
+    std::chrono::microseconds idle_spin{50};
+};
+
+// One thread resuming coroutines. Work arrives through post() from any thread;
+// timers are a heap on the loop thread, so a coroutine awaiting sleepFor()
+// costs no thread and nothing runs until the earliest deadline. Everything
+// spawned on one loop runs on its thread, so those coroutines may share
+// state that is not thread-safe without locking.
+//
+//   Task tick(EventLoop& loop) {
+//       while (true) {
+//           bool expired = co_await loop.sleepFor(std::chrono::seconds(1));
+//           if (!expired) break;
+//           ...
+//       }
+//   }
+//   loop.spawn(tick(loop));
+//
+// Await into a local as above: GCC 12 miscompiles a co_await written directly
+// in an if or while condition (the coroutine never runs past it).
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    
+    // Suspends until the deadline; resumes with false instead when the loop is
+    // stopping, which ends a periodic coroutine's loop
+    class SleepAwaiter {
+    private:
+        EventLoop& loop;
+        Clock::time_point deadline;
+    
+    public:
+        SleepAwaiter(EventLoop& event_loop, Clock::time_point until) : loop(event_loop), deadline(until) {}
+        bool await_ready() const noexcept { return loop.stopping.load(std::memory_order_relaxed); }
+        void await_suspend(std::coroutine_handle<> handle) { loop.addTimer(deadline, handle); }
+        bool await_resume() const noexcept { return !loop.stopping.load(std::memory_order_relaxed); }
+    };
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t order;                 // equal deadlines resume in the order they were set
+        std::coroutine_handle<> handle;
+        
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : order > other.order;
+        }
+    };
+    
+    Logger& logger;
+    std::string name;
+    EventLoopOptions options;
+    std::thread thread;
+    std::thread::id thread_id;
+    
+    // Posted from any thread
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::vector<std::coroutine_handle<>> posted;
+    std::atomic<bool> has_posted{false};
+    bool sleeping;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> active_tasks{0};
+    
+    // Loop thread only
+    std::vector<std::coroutine_handle<>> runnable;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    uint64_t timer_order;
+    
+    // Statistics
+    std::atomic<size_t> resumptions{0};
+    std::atomic<size_t> timers_fired{0};
+    std::atomic<size_t> sleeps{0};          // blocking waits; each one is a wake-up to pay for
+
+public:
+    EventLoop(Logger& log, const std::string& loop_name, const EventLoopOptions& opts = EventLoopOptions());
+    ~EventLoop();
+    
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    
+    void start();
+    
+    // Pending timers resume with false and the thread runs what they lead to,
+    // then exits. Close channels first so their consumers can finish too.
+    void stop();
+    
+    // Runs the task on this loop's thread; safe from any thread
+    void spawn(Task task);
+    
+    // Resumes the coroutine on this loop's thread; safe from any thread
+    void post(std::coroutine_handle<> handle);
+    
+    // Only on the loop thread, i.e. from a coroutine spawned here
+    SleepAwaiter sleepUntil(Clock::time_point deadline) { return SleepAwaiter(*this, deadline); }
+    SleepAwaiter sleepFor(Clock::duration delay) { return SleepAwaiter(*this, Clock::now() + delay); }
+    
+    bool isRunning() const { return thread.joinable(); }
+    bool onLoopThread() const { return std::this_thread::get_id() == thread_id; }
+    const std::string& getName() const { return name; }
+    size_t getActiveTasks() const { return active_tasks; }
+    size_t getResumptions() const { return resumptions; }
+    size_t getTimersFired() const { return timers_fired; }
+    size_t getSleeps() const { return sleeps; }
+
+private:
+    friend struct Task::promise_type;
+    
+    void run();
+    void addTimer(Clock::time_point deadline, std::coroutine_handle<> handle);
+    bool takePosted();
+    void fireTimers(Clock::time_point now);
+    void idle();
+    void taskFinished();
+    void taskFailed(const char* what);
+};
+
+// A fixed set of event loops started and stopped together
+class EventLoopPool {
+private:
+    std::vector<std::unique_ptr<EventLoop>> loops;
+
+public:
+    EventLoopPool(Logger& log, size_t threads, const std::string& name,
+                  const EventLoopOptions& opts = EventLoopOptions());
+    
+    void start();
+    
+    // In reverse order, so loops started first stop last
+    void stop();
+    
+    EventLoop& operator[](size_t index) { return *loops[index]; }
+    const EventLoop& operator[](size_t index) const { return *loops[index]; }
+    size_t size() const { return loops.size(); }
+};
+
+// Bounded queue from one producer thread to one coroutine. The producer never
+// suspends: when the consumer is behind it spins until a slot frees, which
+// holds back the transport as processing on its own thread would. Items are
+// copied into preallocated slots, so strings keep their capacity and a warm
+// channel does not allocate.
+//
+//   while (true) {
+//       bool open = co_await channel.wait();
+//       if (!open) break;
+//       while (channel.tryReceive(item)) { ... }      // drain the batch, then wait again
+//   }
+template <typename T>
+class AsyncChannel {
+private:
+    EventLoop& loop;
+    SPSCRing<T> ring;
+    std::coroutine_handle<> consumer;
+    std::atomic<bool> consumer_waiting{false};
+    std::atomic<bool> closed{false};
+    
+    // Statistics
+    std::atomic<size_t> items_sent{0};
+    std::atomic<size_t> consumer_wakeups{0};
+    std::atomic<size_t> producer_stalls{0};
+    
+    bool readable() const { return !ring.empty() || closed.load(std::memory_order_acquire); }
+    
+    void wakeConsumer() {
+        // Read-modify-writes on the flag on both sides: either the consumer's
+        // exchange sees the new item, or this one sees the consumer waiting
+        if (consumer_waiting.exchange(false, std::memory_order_acq_rel)) {
+            consumer_wakeups.fetch_add(1, std::memory_order_relaxed);
+            loop.post(consumer);
+        }
+    }
+
+public:
+    class WaitAwaiter {
+    private:
+        AsyncChannel& channel;
+    
+    public:
+        explicit WaitAwaiter(AsyncChannel& async_channel) : channel(async_channel) {}
+        bool await_ready() const noexcept { return channel.readable(); }
+        
+        bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            channel.consumer = handle;
+            channel.consumer_waiting.exchange(true, std::memory_order_acq_rel);
+            // An item sent before the flag was visible: take the wake-up back, unless the producer already did
+            if (channel.readable() && channel.consumer_waiting.exchange(false, std::memory_order_acq_rel)) {
+                return false;
+            }
+            return true;
+        }
+        
+        // False once the channel is closed and drained. True may find nothing to
+        // receive: a wake-up for an item the consumer already took on its last pass.
+        bool await_resume() const noexcept {
+            return !channel.closed.load(std::memory_order_acquire) || !channel.ring.empty();
+        }
+    };
+    
+    // The consumer runs on consumer_loop; capacity must be a power of two
+    AsyncChannel(EventLoop& consumer_loop, size_t capacity) : loop(consumer_loop), ring(capacity) {}
+    
+    AsyncChannel(const AsyncChannel&) = delete;
+    AsyncChannel& operator=(const AsyncChannel&) = delete;
+    
+    // Producer thread
+    void send(const T& item) {
+        if (!ring.push(item)) {
+            producer_stalls.fetch_add(1, std::memory_order_relaxed);
+            do {
+                std::this_thread::yield();
+            } while (!ring.push(item));
+        }
+        items_sent.fetch_add(1, std::memory_order_relaxed);
+        wakeConsumer();
+    }
+    
+    // No more items; the consumer's wait() returns false once it has taken the rest
+    void close() {
+        closed.store(true, std::memory_order_release);
+        wakeConsumer();
+    }
+    
+    // Consumer coroutine
+    WaitAwaiter wait() { return WaitAwaiter(*this); }
+    bool tryReceive(T& item) { return ring.pop(item); }
+    
+    size_t size() const { return ring.size(); }
+    size_t getItemsSent() const { return items_sent; }
+    size_t getConsumerWakeups() const { return consumer_wakeups; }
+    size_t getProducerStalls() const { return producer_stalls; }
+};
+
+#endif // HFT_COROUTINES
@@ -0,0 +1,103 @@
+#pragma once
+#include "mapped_file.h"
+#include "ticker_data.h"
+#include "logger.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct FeedIngestOptions {
+    size_t threads = 0;             // 0 = one per hardware thread
+    
+    // Put each product's ticks back into exchange sequence order and drop
+    // repeated sequence numbers (overlapping captures, pool handoffs)
+    bool reorder = true;
+};
+
+struct FeedIngestStats {
+    size_t bytes = 0;
+    size_t lines = 0;
+    size_t ticks = 0;               // after duplicates are dropped
+    size_t skipped = 0;             // heartbeats, subscriptions and other non-ticker messages
+    size_t malformed = 0;           // lines the live parser rejects
+    size_t fallbacks = 0;           // lines the SIMD path handed to JSONParser
+    size_t duplicates = 0;
+    size_t reordered = 0;           // ticks that moved to restore sequence order
+    size_t products = 0;
+    size_t threads = 0;
+    bool simd = false;              // parsed with simdjson rather than JSONParser
+    double parse_seconds = 0.0;     // parallel by byte range
+    double merge_seconds = 0.0;     // product interning and sequence ordering
+};
+
+// Bulk parser for recorded feeds: newline-delimited frames as the WebSocket
+// delivered them. Files are mapped, split at line boundaries into one byte
+// range per thread and parsed in parallel; chunks are then joined in file
+// order and each product's ticks are sorted by exchange sequence, so the EMA
+// and sinks see what a live session with no gaps or repeats would have sent.
+//
+// With simdjson (HFT_HAVE_SIMDJSON) each line is read by its on-demand parser
+// straight from the mapping. Any line it cannot settle exactly as JSONParser
+// would (unusual price text, non-string fields, trailing bytes, JSON errors)
+// is parsed by JSONParser instead, so the ticks are the live parser's ticks.
+// Fields the live path does not read are not validated by the SIMD path.
+// Without simdjson every line goes through JSONParser on the worker threads.
+class FeedIngest {
+private:
+    // One parsed tick; strings live in the chunk arenas
+    struct Tick {
+        uint32_t product;
+        uint32_t chunk;
+        uint32_t time_offset;
+        uint32_t time_length;
+        double price;
+        double best_bid;
+        double best_ask;
+        uint64_t exchange_sequence;
+    };
+    
+    struct Chunk;
+    
+    Logger& logger;
+    FeedIngestOptions options;
+    std::vector<std::unique_ptr<MappedFile>> inputs;
+    std::vector<std::string> products;
+    std::vector<std::string> time_arenas;               // per chunk
+    std::vector<Tick> ticks;
+    FeedIngestStats stats;
+
+public:
+    explicit FeedIngest(Logger& log, const FeedIngestOptions& ingest_options = FeedIngestOptions());
+    ~FeedIngest();
+    
+    // Inputs are read in the order added, as one continuous recording
+    void addInput(const std::string& path);
+    
+    const FeedIngestStats& run();
+    
+    size_t tickCount() const { return ticks.size(); }
+    const std::string& productOf(size_t index) const { return products[ticks[index].product]; }
+    const FeedIngestStats& getStats() const { return stats; }
+    
+    // Fills a caller-owned ticker as JSONParser::parseTickerMessage would have
+    void getTick(size_t index, TickerData& ticker) const;
+    
+    // Hands every tick to the callback in merged order, reusing one TickerData
+    template <typename Callback>
+    void forEach(Callback&& callback) const {
+        TickerData ticker;
+        for (size_t i = 0; i < ticks.size(); ++i) {
+            getTick(i, ticker);
+            callback(ticker);
+        }
+    }
+    
+    static bool simdAvailable();
+
+private:
+    void parseChunk(Chunk& chunk) const;
+    void mergeChunks(std::vector<Chunk>& chunks);
+    void orderBySequence();
+};
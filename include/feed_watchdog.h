@@ -0,0 +1,136 @@
+#pragma once
+#include "logger.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct WatchdogOptions {
+    std::chrono::milliseconds product_stale_after{std::chrono::seconds(30)};
+    std::chrono::milliseconds heartbeat_gap_after{std::chrono::seconds(3)};     // Coinbase sends one per second
+    std::chrono::milliseconds resolution{100};                                  // timer wheel slot width
+    
+    // Call the stall callback when a connection misses heartbeats. Repeats
+    // while it stays silent, backing off from heartbeat_gap_after up to max_reconnect_backoff.
+    bool reconnect_on_heartbeat_gap = true;
+    std::chrono::milliseconds max_reconnect_backoff{std::chrono::seconds(60)};
+};
+
+// Tells a quiet market from a stalled feed. Products are watched for the age
+// of their last update and connections for gaps between heartbeats; a product
+// that goes quiet while its connection still heartbeats is only a quiet market.
+//
+// touch() is a single relaxed store, so the tick path never sees the timer
+// wheel. Each watch sits in one wheel slot at its current deadline; when the
+// slot comes round the watchdog thread compares the deadline with the last
+// touch and either re-files the watch at its new deadline or raises an alert.
+// Register every watch before start().
+class FeedWatchdog {
+public:
+    enum class WatchKind { PRODUCT, CONNECTION };
+    
+    using StallCallback = std::function<void(const std::string& connection)>;
+
+private:
+    struct Watch {
+        std::string name;
+        WatchKind kind;
+        int64_t threshold_ns;
+        std::atomic<int64_t> last_seen_ns{0};       // steady clock; 0 until the first touch
+        
+        // Watchdog thread only
+        bool scheduled = false;
+        int64_t deadline_ns = 0;                    // wheel slot this watch is filed under
+        int64_t stale_since_ns = 0;                 // 0 while healthy
+        uint32_t alerts = 0;                        // consecutive alerts in this stall
+        MetricGauge* stale_gauge = nullptr;
+        MetricCounter* alerts_metric = nullptr;
+        
+        Watch(const std::string& watch_name, WatchKind watch_kind, int64_t threshold)
+            : name(watch_name), kind(watch_kind), threshold_ns(threshold) {}
+    };
+    
+    Logger& logger;
+    WatchdogOptions options;
+    int64_t resolution_ns;
+    
+    std::deque<Watch> watches;
+    std::unordered_map<std::string, size_t> product_index;
+    std::string last_product;
+    size_t last_index;
+    
+    // Timer wheel, advanced by advance() on the watchdog thread
+    std::vector<std::vector<uint32_t>> wheel;
+    int64_t wheel_time_ns;                          // start of the next slot to expire; 0 before the first advance
+    std::vector<uint32_t> unscheduled;              // registered but not yet touched
+    std::vector<uint32_t> stale;
+    mutable std::mutex advance_mutex;
+    
+    StallCallback stall_callback;
+    
+    std::thread watchdog_thread;
+    std::mutex thread_mutex;
+    std::condition_variable thread_cv;
+    bool running;
+    
+    // Statistics
+    std::atomic<size_t> stale_events{0};
+    std::atomic<size_t> heartbeat_gaps{0};
+    std::atomic<size_t> reconnects_requested{0};
+    MetricCounter& reconnects_metric;
+
+public:
+    FeedWatchdog(Logger& log, const WatchdogOptions& watchdog_options = WatchdogOptions());
+    ~FeedWatchdog();
+    
+    FeedWatchdog(const FeedWatchdog&) = delete;
+    FeedWatchdog& operator=(const FeedWatchdog&) = delete;
+    
+    // Returns the watch id for touch(); registering a name twice returns the same id
+    size_t watchProduct(const std::string& product_id);
+    size_t watchConnection(const std::string& connection);
+    
+    // Called with the connection name from the watchdog thread
+    void setStallCallback(StallCallback callback) { stall_callback = std::move(callback); }
+    
+    void touch(size_t watch_id, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        watches[watch_id].last_seen_ns.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+    
+    // By name, for products arriving without an id; unknown products are ignored.
+    // Single caller thread (the processing thread).
+    void touchProduct(const std::string& product_id,
+                      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+    
+    // Runs the wheel up to now: raises alerts for watches past their threshold
+    // and clears those touched again. start() calls this every resolution;
+    // without start(), the owner calls it, e.g. from a timer on its event loop.
+    void advance(std::chrono::steady_clock::time_point now);
+    std::chrono::milliseconds getResolution() const { return options.resolution; }
+    
+    void start();
+    void stop();
+    
+    bool isStale(size_t watch_id) const;
+    size_t getStaleEvents() const { return stale_events; }
+    size_t getHeartbeatGaps() const { return heartbeat_gaps; }
+    size_t getReconnectsRequested() const { return reconnects_requested; }
+    size_t getStaleCount() const;
+
+private:
+    size_t addWatch(const std::string& name, WatchKind kind, std::chrono::milliseconds threshold);
+    void schedule(uint32_t watch_id, int64_t deadline_ns);
+    void expire(uint32_t watch_id, int64_t now_ns);
+    void raiseAlert(uint32_t watch_id, int64_t now_ns);
+    void checkRecovered(int64_t now_ns);
+    bool connectionsHealthy() const;
+    void watchdogLoop();
+};
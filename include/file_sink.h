@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+enum class FileSinkBackend {
+    AUTO,       // io_uring where the kernel supports it, otherwise ofstream
+    OFSTREAM,
+    IO_URING
+};
+
+// Append-only output file used by CSVWriter and Logger. write() and flush()
+// never block on the kernel for the io_uring backend; close() waits for all
+// outstanding writes.
+class FileSink {
+public:
+    virtual ~FileSink() = default;
+    
+    virtual bool isOpen() const = 0;
+    virtual void write(const char* data, size_t length) = 0;
+    virtual void flush() = 0;
+    virtual void close() = 0;
+    virtual const char* backendName() const = 0;
+    
+    // True once any write has been lost; for io_uring this is only known after completion
+    virtual bool hasFailed() const = 0;
+    
+    void write(const std::string& text) { write(text.data(), text.size()); }
+};
+
+// Never returns null; check isOpen() for failure. AUTO falls back to ofstream
+// when io_uring is unavailable (non-Linux build, old kernel or seccomp).
+std::unique_ptr<FileSink> openFileSink(const std::string& path, bool append, 
+                                       FileSinkBackend backend = FileSinkBackend::AUTO);
+
+bool ioUringAvailable();
@@ -3,44 +3,172 @@
 #include "ticker_data.h"
 #include "logger.h"
 #include "csv_writer.h"
+#include "shared_tick_publisher.h"
+#include "tick_fanout_server.h"
 #include "websocket_client.h"
+#include "metrics.h"
+#include "tick_pipeline.h"
+#include "tick_stages.h"
+#include "state_checkpoint.h"
+#include "derived_streams.h"
+#include "feed_watchdog.h"
+#include "event_loop.h"
 #include <chrono>
 #include <atomic>
 #include <thread>
 
+// How long each shutdown phase took, filled in by HFTProcessor::stop()
+struct ShutdownTimings {
+    double stop_intake_ms = 0.0;        // exchange connection and watchdog stopped; no frame in flight
+    double drain_ms = 0.0;              // conflated CSV rows written, fan-out queues delivered
+    double flush_ms = 0.0;              // CSV writes completed, final checkpoint synced
+    size_t rows_drained = 0;
+    size_t fanout_undelivered = 0;      // left behind when the fan-out drain timed out
+    bool csv_complete = true;           // false if any CSV write was lost
+    
+    double totalMs() const { return stop_intake_ms + drain_ms + flush_ms; }
+};
+
+enum class ExecutionMode {
+    THREADED,       // ticks run through the pipeline on the transport thread; the watchdog has its own thread
+    COROUTINES      // needs HFT_COROUTINES: ticks handed to an event loop, timers awaited there (see below)
+};
+
+// In COROUTINES mode the transport thread only parses and hands each ticker to
+// a channel. Two event loops run everything else as coroutines:
+//   loop 0: receive -> process (the pipelines), the conflation flush deadline and
+//           the EMA state snapshot, so pipeline state stays on one thread
+//   loop 1: watchdog ticks and statistics reports
+// Each timer is an awaited deadline on a loop rather than a thread sleeping.
 class HFTProcessor {
+public:
+    // Stages of the live pipeline; a disabled stage is compiled out entirely
+    static constexpr bool INDICATORS_ENABLED = true;
+    static constexpr bool HISTORY_ENABLED = true;
+    static constexpr bool CSV_OUTPUT_ENABLED = true;
+    static constexpr bool SHARED_MEMORY_ENABLED = true;
+    static constexpr bool FANOUT_ENABLED = true;
+    // Opt-in: subscribes ETH-USD, SOL-USD and BTC-USDT as inputs and writes the
+    // synthetic products (liveDerivedSpecs) into the CSV alongside BTC-USD
+    static constexpr bool DERIVED_STREAMS_ENABLED = false;
+    
+    using LivePipeline = TickPipeline<
+        SequenceStage,
+        EMAStage,
+        OptionalStage<INDICATORS_ENABLED, IndicatorStage>,
+        OptionalStage<HISTORY_ENABLED, HistoryStage>,
+        OptionalStage<CSV_OUTPUT_ENABLED, ConflatedCSVSinkStage>,
+        OptionalStage<SHARED_MEMORY_ENABLED, SharedTickStage>,
+        OptionalStage<FANOUT_ENABLED, FanoutStage>>;
+    
+    // Synthetic products from DerivedStreamEngine arrive with their EMAs set and
+    // go through the same indicators and sinks as the primary product
+    using DerivedPipeline = TickPipeline<
+        SequenceStage,
+        OptionalStage<INDICATORS_ENABLED, IndicatorStage>,
+        OptionalStage<HISTORY_ENABLED, HistoryStage>,
+        OptionalStage<CSV_OUTPUT_ENABLED, ConflatedCSVSinkStage>,
+        OptionalStage<SHARED_MEMORY_ENABLED, SharedTickStage>,
+        OptionalStage<FANOUT_ENABLED, FanoutStage>>;
+
 private:
     EMACalculator price_ema_calc;
     EMACalculator mid_price_ema_calc;
     Logger& logger;
+    IndicatorEngine indicators;
+    DerivedStreamEngine derived_streams;
+    TickHistory history;
     CSVWriter csv_writer;
+    TickConflator csv_conflator;
+    SharedTickPublisher tick_publisher;
+    TickFanoutServer fanout_server;
+    
+    // Declared before ws_client: heartbeats touch it from the transport thread
+    FeedWatchdog watchdog;
+    size_t product_watch;
+    size_t heartbeat_watch;
     WebSocketClient ws_client;
+    std::string product;
+    
+    // EMA/indicator state and the sequence counter survive restarts
+    StateCheckpointer checkpointer;
+    std::vector<char> checkpoint_buffer;
     
     std::chrono::system_clock::time_point last_ema_update;
     const std::chrono::seconds ema_interval;
     
-    // Processing thread
-    std::thread processing_thread;
+    const ExecutionMode execution_mode;
     std::atomic<bool> running{false};
+    std::chrono::steady_clock::time_point started_at;
+    
+#ifdef HFT_COROUTINES
+    EventLoopPool event_loops;
+    AsyncChannel<TickerData> tick_channel;      // transport thread -> loop 0
+#endif
+    
+    // Sequence numbers continue from a restored checkpoint; the statistics are per run.
+    // Derived streams count separately so the primary product's sequence has no gaps.
+    std::atomic<size_t> last_sequence{0};
+    std::atomic<size_t> derived_sequence{0};
     
     // Statistics
     std::atomic<size_t> total_messages_processed{0};
     std::atomic<size_t> ema_updates_count{0};
+    std::atomic<size_t> derived_input_ticks{0};     // other products, subscribed only as derived inputs
+    ShutdownTimings shutdown_timings;
+    MetricCounter& ticks_metric;
+    MetricHistogram& tick_latency_metric;
+    
+    // Declared last: their stages refer to the members above
+    LivePipeline pipeline;
+    DerivedPipeline derived_pipeline;
 
 public:
     HFTProcessor(const std::string& product_id, Logger& log);
     ~HFTProcessor();
     
     void start();
+    
+    // Stops taking frames, drains what is queued, flushes the sinks, in that order
     void stop();
     void processTickerData(TickerData& ticker);
     
+    ExecutionMode getExecutionMode() const { return execution_mode; }
+    
+    // True when the processor logs logProgress() itself, from a timer
+    bool reportsProgress() const { return execution_mode == ExecutionMode::COROUTINES; }
+    
+    // Runtime, messages processed, EMA updates, the fan-out subscribers and
+    // the heap charged to each component
+    void logProgress() const;
+    
     // Statistics
     size_t getTotalMessagesProcessed() const { return total_messages_processed; }
     size_t getEMAUpdatesCount() const { return ema_updates_count; }
+    const ShutdownTimings& getShutdownTimings() const { return shutdown_timings; }
+    
+    // Recent ticks of the primary and derived products, for range queries
+    const TickHistory& getHistory() const { return history; }
+    void logFanoutStatistics() const;
+    
+    // Per AllocationTag: allocations and live bytes, plus allocations per tick.
+    // Nothing is logged unless AllocationCounter accounting is enabled.
+    void logAllocationStatistics() const;
     
 private:
-    void processingLoop();
+#ifdef HFT_COROUTINES
+    void startCoroutines();
+    void stopCoroutines();
+    Task receiveTicks();
+    Task flushConflatedRows();
+    Task snapshotState();
+    Task runWatchdog();
+    Task reportProgress();
+#endif
+    void processTick(TickerData& ticker);
+    void updateDerivedStreams(const TickerData& ticker);
     void updateEMAs(TickerData& ticker);
     void logStatistics() const;
+    void captureState(std::vector<char>& payload) const;
+    bool restoreState(const std::vector<char>& payload);
 };
\ No newline at end of file
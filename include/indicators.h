@@ -0,0 +1,98 @@
+#pragma once
+#include "ticker_data.h"
+#include "state_checkpoint.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Incremental indicators computed alongside the EMAs. Every update is O(1)
+// and, once a product has been seen, does not allocate.
+enum class IndicatorType {
+    SMA,            // rolling mean of trade price
+    VOLATILITY,     // rolling std dev of mid-price returns (Welford)
+    RSI,            // Wilder RSI of trade price
+    BOLLINGER,      // rolling mean of mid price +/- width std devs
+    SPREAD_EMA      // EMA of best_ask - best_bid, alpha = 2 / (window + 1)
+};
+
+struct IndicatorSpec {
+    IndicatorType type;
+    size_t window;          // samples in the window, or the RSI / EMA period
+    double width;           // Bollinger band width in std devs; unused otherwise
+    
+    IndicatorSpec(IndicatorType indicator, size_t samples, double band_width = 2.0)
+        : type(indicator), window(samples), width(band_width) {}
+};
+
+struct IndicatorConfig {
+    std::vector<IndicatorSpec> defaults;
+    std::unordered_map<std::string, std::vector<IndicatorSpec>> per_product;   // replaces defaults
+    
+    const std::vector<IndicatorSpec>& specsFor(const std::string& product_id) const;
+};
+
+// Owns indicator state for every product. A product's outputs, running values
+// and rolling windows live in one contiguous block: outputs and per-indicator
+// headers first, then the windows, so one tick touches the hot front of the
+// block plus a single slot in each window.
+class IndicatorEngine {
+private:
+    struct Indicator {
+        IndicatorType type;
+        uint32_t window;
+        double width;
+        uint32_t state;         // offset of the indicator's header in the block
+        uint32_t ring;          // offset of its window, if it has one
+        uint32_t column;        // first output column
+    };
+    
+    struct ProductIndicators {
+        std::vector<Indicator> indicators;
+        std::vector<double> block;      // [outputs][headers][windows]
+    };
+    
+    IndicatorConfig config;
+    std::vector<std::string> columns;
+    std::unordered_map<std::string, size_t> column_index;
+    std::vector<ProductIndicators> products;
+    std::unordered_map<std::string, size_t> product_index;
+    std::string last_product;
+    size_t last_index;
+
+public:
+    explicit IndicatorEngine(const IndicatorConfig& indicator_config = IndicatorConfig());
+    
+    // CSV column names, shared by all products; products without an
+    // indicator leave its columns empty
+    const std::vector<std::string>& columnNames() const { return columns; }
+    bool empty() const { return columns.empty(); }
+    
+    // Updates the ticker's product and points ticker.indicator_values at its
+    // outputs, which stay valid until that product's next update
+    void update(TickerData& ticker);
+    
+    size_t getProductCount() const { return products.size(); }
+    
+    // Checkpoint support. Products whose indicator set changed since the
+    // checkpoint was taken are skipped and start cold; returns those restored.
+    // readState parses the whole section first, so a caller restoring several
+    // sections can apply none of them if a later one is truncated.
+    struct SavedProduct {
+        std::string product_id;
+        std::string signature;
+        std::vector<double> block;
+    };
+    using SavedState = std::vector<SavedProduct>;
+    
+    void saveState(CheckpointWriter& out) const;
+    static SavedState readState(CheckpointReader& in);
+    size_t restoreState(const SavedState& state);
+    size_t restoreState(CheckpointReader& in) { return restoreState(readState(in)); }
+
+private:
+    size_t productFor(const std::string& product_id);
+    void addColumn(const std::string& name);
+    static std::vector<std::string> outputNames(const IndicatorSpec& spec);
+    static std::string layoutSignature(const ProductIndicators& product);
+};
@@ -2,6 +2,20 @@
 #include "ticker_data.h"
 #include "logger.h"
 #include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string_view>
+
+// Well-formed JSON that is not a ticker: another message type, or required fields missing
+class NotATickerError : public std::invalid_argument {
+public:
+    using std::invalid_argument::invalid_argument;
+};
+
+// A ticker field holding the wrong kind of value, e.g. a price that is not a number
+class FieldTypeError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
 
 class JSONParser {
 private:
@@ -10,10 +24,20 @@ private:
 public:
     explicit JSONParser(Logger& log);
     
-    TickerData parseTickerMessage(const std::string& json_string);
+    TickerData parseTickerMessage(std::string_view json_string);
+    
+    // Fills a caller-owned ticker so its strings keep their capacity between messages
+    void parseTickerMessage(std::string_view json_string, TickerData& ticker);
+    
+    // Throws the same errors without logging them, for bulk callers that count
+    // failures themselves
+    void parseTickerMessageQuietly(std::string_view json_string, TickerData& ticker);
     bool validateTickerJSON(const nlohmann::json& j) const;
     
 private:
+    bool scanTickerMessage(std::string_view json_string, TickerData& ticker) const;
+    void parseTickerDocument(std::string_view json_string, TickerData& ticker);
     double parsePrice(const nlohmann::json& j, const std::string& field) const;
     std::string parseString(const nlohmann::json& j, const std::string& field) const;
-};
\ No newline at end of file
+    uint64_t parseSequence(const nlohmann::json& j) const;
+};
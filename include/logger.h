@@ -1,38 +1,105 @@
 #pragma once
+#include "allocation_counter.h"
+#include "file_sink.h"
+#include "binary_log.h"
 #include <string>
-#include <fstream>
+#include <string_view>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <vector>
 
-enum class LogLevel {
-    DEBUG,
-    INFO,
-    WARNING,
-    ERROR
-};
-
+// Writes the application log and the test verification log. In BINARY format
+// both files hold records (see binary_log.h) instead of text: a template ID,
+// the raw timestamp and the arguments, with nothing formatted on the hot path.
+// tools/log_decode prints them exactly as the text format would have. Only
+// warnings and errors are echoed to the console in BINARY format.
 class Logger {
 private:
-    std::ofstream log_file;
-    std::ofstream test_log_file;
+    std::unique_ptr<FileSink> log_file;
+    std::unique_ptr<FileSink> test_log_file;
     mutable std::mutex log_mutex;
     LogLevel min_level;
+    LogFormat format;
+    
+    // BINARY format: per file, the templates defined this session and the
+    // timestamp the next record's delta is taken from
+    struct BinarySession {
+        std::vector<bool> defined;
+        int64_t last_timestamp = 0;
+    };
+    BinarySession log_session;
+    BinarySession test_session;
+    std::string record_buffer;
+    std::string line_buffer;            // TEXT format: the line being written, under log_mutex
     
     std::string getCurrentTimestamp() const;
     std::string getCurrentTimestampMicroseconds() const;
     std::string levelToString(LogLevel level) const;
+    
+    void writeLine(LogLevel level, std::string_view message);
+    void writeTestLine(std::string_view line);
+    void logEncoded(LogLevel level, const LogTemplate& message, const std::string& arguments);
+    void logTestEncoded(const LogTemplate& line, const std::string& arguments);
+    void startSession(FileSink& sink, BinarySession& session, bool write_magic);
+    void writeRecord(FileSink& sink, BinarySession& session, uint8_t level, const LogTemplate& message,
+                     const std::string& arguments);
+    void writeText(FileSink& sink, const std::string& text);
+    static std::string& argumentBuffer();
 
 public:
     Logger(const std::string& log_filename = "hft_app.log", 
            const std::string& test_log_filename = "test_verification.log",
-           LogLevel level = LogLevel::INFO);
+           LogLevel level = LogLevel::INFO,
+           FileSinkBackend backend = FileSinkBackend::AUTO,
+           LogFormat log_format = LogFormat::TEXT);
     ~Logger();
     
     void log(LogLevel level, const std::string& message);
     void logTest(const std::string& test_name, const std::string& result, const std::string& details = "");
     
+    // Templated message: the arguments are substituted when the line is read,
+    // not when it is logged, if the format is BINARY. In TEXT format they are
+    // formatted straight into the line.
+    template <typename... Args>
+    void log(LogLevel level, const LogTemplate& message, const Args&... args) {
+        if (level < min_level) return;
+        AllocationScope scope(AllocationTag::LOGGER);
+        std::string& buffer = argumentBuffer();
+        buffer.clear();
+        if (format == LogFormat::TEXT) {
+            binlog::formatMessage(buffer, message.getFormat(), args...);
+            writeLine(level, buffer);
+        } else {
+            binlog::encodeArguments(buffer, args...);
+            logEncoded(level, message, buffer);
+        }
+    }
+    
+    // Templated test line; the template is the whole line after the timestamp:
+    //   static const LogTemplate BATCH_DONE("TEST: BATCH - PASSED | Details: {} rows");
+    //   logger.logTest(BATCH_DONE, rows);
+    template <typename... Args>
+    void logTest(const LogTemplate& line, const Args&... args) {
+        AllocationScope scope(AllocationTag::LOGGER);
+        std::string& buffer = argumentBuffer();
+        buffer.clear();
+        if (format == LogFormat::TEXT) {
+            binlog::formatMessage(buffer, line.getFormat(), args...);
+            writeTestLine(buffer);
+        } else {
+            binlog::encodeArguments(buffer, args...);
+            logTestEncoded(line, buffer);
+        }
+    }
+    
+    LogFormat getFormat() const { return format; }
+    
+    // Lets hot paths skip building a message that would be filtered out anyway
+    bool isEnabled(LogLevel level) const { return level >= min_level; }
+    
     // Convenience methods
     void debug(const std::string& message) { log(LogLevel::DEBUG, message); }
     void info(const std::string& message) { log(LogLevel::INFO, message); }
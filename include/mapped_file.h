@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only view of a whole file. Plain files are memory-mapped; .gz files
+// (rolled CSV segments) are inflated into memory when zlib is available.
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    void* mapping;
+    std::vector<char> inflated;
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    std::string_view view() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+    bool isMapped() const { return mapping != nullptr; }
+};
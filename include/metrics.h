@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr size_t METRIC_SHARDS = 16;
+constexpr size_t METRIC_MAX_BUCKETS = 32;
+constexpr size_t METRIC_CACHE_LINE = 64;
+
+// Each thread sticks to one shard, so threads recording the same metric
+// normally touch different cache lines
+inline size_t metricShardIndex() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+    return shard;
+}
+
+// Monotonic counter; increment() is one relaxed fetch_add on the caller's shard
+class MetricCounter {
+private:
+    struct alignas(METRIC_CACHE_LINE) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    Shard shards[METRIC_SHARDS];
+
+public:
+    void increment(uint64_t delta = 1) {
+        shards[metricShardIndex()].value.fetch_add(delta, std::memory_order_relaxed);
+    }
+    
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+// Last-value gauge; set() is one relaxed store
+class alignas(METRIC_CACHE_LINE) MetricGauge {
+private:
+    std::atomic<double> current{0.0};
+
+public:
+    void set(double value) { current.store(value, std::memory_order_relaxed); }
+    double value() const { return current.load(std::memory_order_relaxed); }
+};
+
+// Fixed-bucket histogram over integer samples (e.g. nanoseconds). Exposed
+// values are divided by scale, so nanosecond samples can be reported in seconds.
+class MetricHistogram {
+private:
+    struct alignas(METRIC_CACHE_LINE) Shard {
+        std::atomic<uint64_t> counts[METRIC_MAX_BUCKETS + 1];
+        std::atomic<uint64_t> sum{0};
+        Shard() {
+            for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+        }
+    };
+    std::vector<uint64_t> bounds;
+    double scale;
+    Shard shards[METRIC_SHARDS];
+
+public:
+    MetricHistogram(std::vector<uint64_t> upper_bounds, double value_scale);
+    
+    void observe(uint64_t sample) {
+        size_t bucket = 0;
+        while (bucket < bounds.size() && sample > bounds[bucket]) {
+            ++bucket;
+        }
+        Shard& shard = shards[metricShardIndex()];
+        shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(sample, std::memory_order_relaxed);
+    }
+    
+    // Cumulative count per bucket bound, with +Inf last
+    std::vector<uint64_t> cumulativeCounts() const;
+    uint64_t sum() const;
+    const std::vector<uint64_t>& upperBounds() const { return bounds; }
+    double getScale() const { return scale; }
+};
+
+// Process-wide registry rendered in Prometheus text format. Registration takes a
+// lock and returns a stable reference; recording through it never does.
+class MetricsRegistry {
+private:
+    enum class MetricType { COUNTER, GAUGE, HISTOGRAM };
+    
+    struct Entry {
+        std::string name;
+        std::string help;
+        std::string labels;
+        MetricType type;
+        void* metric;
+    };
+    
+    mutable std::mutex registry_mutex;
+    std::deque<MetricCounter> counters;
+    std::deque<MetricGauge> gauges;
+    std::deque<MetricHistogram> histograms;
+    std::vector<Entry> entries;
+    std::vector<std::pair<int, std::function<void(std::string&)>>> collectors;
+    int next_collector_id;
+
+public:
+    MetricsRegistry();
+    
+    static MetricsRegistry& global();
+    
+    // labels use Prometheus syntax without braces, e.g. reason="malformed_json".
+    // The same name and labels always return the same metric.
+    MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    MetricGauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    MetricHistogram& histogram(const std::string& name, const std::string& help, 
+                               const std::vector<uint64_t>& upper_bounds, double scale = 1.0,
+                               const std::string& labels = "");
+    
+    // Collectors append their own exposition text at scrape time, for metrics
+    // whose label sets come and go (e.g. per-subscriber stats)
+    int addCollector(std::function<void(std::string&)> collector);
+    void removeCollector(int id);
+    
+    std::string render() const;
+    
+private:
+    Entry* find(const std::string& name, const std::string& labels, MetricType type);
+};
+
+// Bucket bounds for latencies recorded in nanoseconds: 1us .. ~1s
+std::vector<uint64_t> latencyBucketsNs();
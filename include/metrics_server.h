@@ -0,0 +1,38 @@
+#pragma once
+#include "metrics.h"
+#include "logger.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Serves MetricsRegistry in Prometheus text format on a loopback HTTP port
+// (GET /metrics). One connection at a time on its own thread; scrapes are
+// rare enough that nothing more is needed.
+class MetricsServer {
+private:
+    Logger& logger;
+    MetricsRegistry& registry;
+    uint16_t port;
+    int listen_fd;
+    int wake_pipe[2];
+    std::thread server_thread;
+    std::atomic<bool> running{false};
+    std::atomic<size_t> scrapes{0};
+
+public:
+    // Port 0 picks a free port; see getPort() after start()
+    MetricsServer(uint16_t listen_port, Logger& log, MetricsRegistry& metrics = MetricsRegistry::global());
+    ~MetricsServer();
+    
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    
+    bool start();
+    void stop();
+    uint16_t getPort() const { return port; }
+    size_t getScrapes() const { return scrapes; }
+    
+private:
+    void serverLoop();
+    void handleClient(int client_fd);
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include "logger.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Gzips closed output segments on its own thread so compression never runs on
+// the write path. Each file is replaced by <file>.gz once compressed.
+class SegmentCompressor {
+private:
+    Logger& logger;
+    std::thread worker;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::string> pending;
+    bool stopping;
+    
+    // Statistics
+    std::atomic<size_t> segments_compressed{0};
+    std::atomic<size_t> bytes_in{0};
+    std::atomic<size_t> bytes_out{0};
+
+public:
+    explicit SegmentCompressor(Logger& log);
+    ~SegmentCompressor();
+    
+    SegmentCompressor(const SegmentCompressor&) = delete;
+    SegmentCompressor& operator=(const SegmentCompressor&) = delete;
+    
+    // False when built without zlib; closed segments are then left as-is
+    static bool isAvailable();
+    
+    void enqueue(const std::string& path);
+    
+    // Statistics
+    size_t getSegmentsCompressed() const { return segments_compressed; }
+    size_t getBytesIn() const { return bytes_in; }
+    size_t getBytesOut() const { return bytes_out; }
+    
+private:
+    void workerLoop();
+    bool compressFile(const std::string& path);
+};
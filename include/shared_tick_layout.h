@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the POSIX shared-memory segment that HFTProcessor publishes the
+// latest tick and EMAs into. Shared by the writer and out-of-process readers,
+// so any change to it must bump SHARED_TICK_LAYOUT_VERSION.
+
+constexpr uint64_t SHARED_TICK_MAGIC = 0x4B43495454464843ULL;
+constexpr uint32_t SHARED_TICK_LAYOUT_VERSION = 1;
+constexpr uint32_t SHARED_TICK_MAX_PRODUCTS = 512;
+constexpr size_t SHARED_TICK_PRODUCT_ID_SIZE = 16;
+constexpr const char* SHARED_TICK_SEGMENT_NAME = "/coinbase_hft_ticks";
+constexpr size_t SHARED_TICK_CACHE_LINE = 64;
+
+// Plain copy of one product's latest state, as handed to readers
+struct SharedTickSnapshot {
+    char product_id[SHARED_TICK_PRODUCT_ID_SIZE];  // NUL-terminated, truncated if longer
+    uint64_t sequence_number;
+    int64_t timestamp_us;       // TickerData::timestamp, microseconds since epoch
+    int64_t publish_time_ns;    // steady clock when published, for propagation latency
+    double price;
+    double best_bid;
+    double best_ask;
+    double mid_price;
+    double price_ema;
+    double mid_price_ema;
+};
+
+constexpr size_t SHARED_TICK_WORDS = sizeof(SharedTickSnapshot) / sizeof(uint64_t);
+static_assert(sizeof(SharedTickSnapshot) % sizeof(uint64_t) == 0, "snapshot must be whole words");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seqlock words must be lock-free across processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "header counters must be lock-free across processes");
+
+// One product per slot. The payload is stored as relaxed atomic words so a
+// reader racing the writer is well-defined; version is odd while an update
+// is in flight and readers retry until they see the same even value twice.
+struct alignas(SHARED_TICK_CACHE_LINE) SharedTickSlot {
+    std::atomic<uint64_t> version;
+    std::atomic<uint64_t> words[SHARED_TICK_WORDS];
+};
+
+struct alignas(SHARED_TICK_CACHE_LINE) SharedTickHeader {
+    std::atomic<uint64_t> magic;    // written last by the writer once the segment is ready
+    uint32_t layout_version;
+    uint32_t capacity;
+    std::atomic<uint32_t> product_count;
+};
+
+struct SharedTickSegment {
+    SharedTickHeader header;
+    SharedTickSlot slots[SHARED_TICK_MAX_PRODUCTS];
+};
+
+static_assert(sizeof(SharedTickSlot) % SHARED_TICK_CACHE_LINE == 0, "slots must not share cache lines");
+
+inline void storeSharedTick(SharedTickSlot& slot, const SharedTickSnapshot& snapshot) {
+    uint64_t words[SHARED_TICK_WORDS];
+    std::memcpy(words, &snapshot, sizeof(words));
+    
+    uint64_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < SHARED_TICK_WORDS; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.version.store(version + 2, std::memory_order_release);
+}
+
+// Single attempt; false if the slot is empty or an update raced the copy
+inline bool tryLoadSharedTick(const SharedTickSlot& slot, SharedTickSnapshot& snapshot) {
+    uint64_t before = slot.version.load(std::memory_order_acquire);
+    if (before == 0 || (before & 1) != 0) {
+        return false;
+    }
+    
+    uint64_t words[SHARED_TICK_WORDS];
+    for (size_t i = 0; i < SHARED_TICK_WORDS; ++i) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    
+    if (slot.version.load(std::memory_order_relaxed) != before) {
+        return false;
+    }
+    std::memcpy(&snapshot, words, sizeof(words));
+    return true;
+}
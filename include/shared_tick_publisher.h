@@ -0,0 +1,38 @@
+#pragma once
+#include "shared_tick_layout.h"
+#include "ticker_data.h"
+#include "logger.h"
+#include <string>
+#include <unordered_map>
+
+// Writer side of the shared-memory tick segment. Owned by HFTProcessor and only
+// called from its processing thread; readers use SharedTickReader.
+class SharedTickPublisher {
+private:
+    Logger& logger;
+    std::string segment_name;
+    SharedTickSegment* segment;
+    
+    // Writer-local copy of slot ownership so lookups never touch shared memory
+    std::unordered_map<std::string, size_t> slot_index;
+    std::string last_product;
+    size_t last_slot;
+    size_t ticks_published;
+
+public:
+    SharedTickPublisher(const std::string& name, Logger& log);
+    ~SharedTickPublisher();
+    
+    SharedTickPublisher(const SharedTickPublisher&) = delete;
+    SharedTickPublisher& operator=(const SharedTickPublisher&) = delete;
+    
+    void publish(const TickerData& ticker);
+    bool isOpen() const { return segment != nullptr; }
+    size_t getTicksPublished() const { return ticks_published; }
+    
+    // Also used by other local publishers that share the snapshot layout
+    static void fillSnapshot(const TickerData& ticker, SharedTickSnapshot& snapshot);
+    
+private:
+    SharedTickSlot* slotFor(const std::string& product_id);
+};
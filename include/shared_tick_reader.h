@@ -0,0 +1,94 @@
+#pragma once
+#include "shared_tick_layout.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Header-only reader for the segment published by SharedTickPublisher.
+// Readers map it read-only and never write, so nothing flows back to the writer.
+//
+//   SharedTickReader reader;
+//   SharedTickSnapshot tick;
+//   if (reader.isOpen() && reader.read("BTC-USD", tick)) { ... tick.price_ema ... }
+class SharedTickReader {
+private:
+    const SharedTickSegment* segment;
+
+public:
+    explicit SharedTickReader(const char* segment_name = SHARED_TICK_SEGMENT_NAME) : segment(nullptr) {
+#ifndef _WIN32
+        int fd = shm_open(segment_name, O_RDONLY, 0);
+        if (fd < 0) {
+            return;
+        }
+        
+        struct stat info;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedTickSegment)) {
+            void* mapped = mmap(nullptr, sizeof(SharedTickSegment), PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED) {
+                segment = static_cast<const SharedTickSegment*>(mapped);
+            }
+        }
+        close(fd);
+        
+        if (segment && (segment->header.magic.load(std::memory_order_acquire) != SHARED_TICK_MAGIC ||
+                        segment->header.layout_version != SHARED_TICK_LAYOUT_VERSION)) {
+            unmap();
+        }
+#else
+        (void)segment_name;
+#endif
+    }
+    
+    ~SharedTickReader() { unmap(); }
+    
+    SharedTickReader(const SharedTickReader&) = delete;
+    SharedTickReader& operator=(const SharedTickReader&) = delete;
+    
+    bool isOpen() const { return segment != nullptr; }
+    
+    size_t productCount() const {
+        return segment ? segment->header.product_count.load(std::memory_order_acquire) : 0;
+    }
+    
+    // Spins only while the writer is mid-update; false if the slot was never written
+    bool readSlot(size_t index, SharedTickSnapshot& snapshot) const {
+        if (index >= productCount()) {
+            return false;
+        }
+        
+        const SharedTickSlot& slot = segment->slots[index];
+        while (!tryLoadSharedTick(slot, snapshot)) {
+            if (slot.version.load(std::memory_order_relaxed) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool read(const char* product_id, SharedTickSnapshot& snapshot) const {
+        size_t count = productCount();
+        for (size_t i = 0; i < count; ++i) {
+            if (readSlot(i, snapshot) &&
+                std::strncmp(snapshot.product_id, product_id, SHARED_TICK_PRODUCT_ID_SIZE) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    void unmap() {
+#ifndef _WIN32
+        if (segment) {
+            munmap(const_cast<SharedTickSegment*>(segment), sizeof(SharedTickSegment));
+        }
+#endif
+        segment = nullptr;
+    }
+};
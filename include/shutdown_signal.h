@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <csignal>
+
+// Turns SIGINT/SIGTERM into an event the main loop can wait on. The handler
+// only write()s the signal number to a self-pipe, which is async-signal-safe;
+// stopping anything happens on the thread that called wait(). A second signal
+// gets the default action, so a stuck shutdown can still be interrupted.
+//
+// One instance at a time: the handlers are process-wide.
+class ShutdownSignal {
+private:
+    bool requested;
+    int signal_number;                  // 0 when requested without a signal
+    std::chrono::steady_clock::time_point requested_at;
+
+public:
+    ShutdownSignal();
+    ~ShutdownSignal();
+    
+    ShutdownSignal(const ShutdownSignal&) = delete;
+    ShutdownSignal& operator=(const ShutdownSignal&) = delete;
+    
+    // Blocks until shutdown is requested or the timeout passes; returns true
+    // once it has been requested. Wakes as soon as the signal arrives.
+    bool wait(std::chrono::milliseconds timeout);
+    
+    // Same as receiving a signal, from any thread
+    void request();
+    
+    bool isRequested() const { return requested; }
+    int getSignal() const { return signal_number; }
+    
+    // When wait() first saw the request, for timing the shutdown
+    std::chrono::steady_clock::time_point getRequestedAt() const { return requested_at; }
+};
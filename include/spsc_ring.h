@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// Bounded single-producer/single-consumer ring. push() and pop() never block
+// or allocate; head and tail sit on separate cache lines so the producer and
+// consumer threads don't false-share.
+template <typename T>
+class SPSCRing {
+private:
+    alignas(64) std::atomic<size_t> head{0};   // next slot to read, owned by the consumer
+    alignas(64) std::atomic<size_t> tail{0};   // next slot to write, owned by the producer
+    alignas(64) std::vector<T> items;
+    size_t mask;
+
+public:
+    explicit SPSCRing(size_t capacity) : items(capacity), mask(capacity - 1) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("SPSCRing capacity must be a power of two");
+        }
+    }
+    
+    bool push(const T& item) {
+        size_t write = tail.load(std::memory_order_relaxed);
+        if (write - head.load(std::memory_order_acquire) == items.size()) {
+            return false;
+        }
+        items[write & mask] = item;
+        tail.store(write + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& item) {
+        size_t read = head.load(std::memory_order_relaxed);
+        if (read == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[read & mask];
+        head.store(read + 1, std::memory_order_release);
+        return true;
+    }
+    
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return items.size(); }
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Appends fixed-width values to a checkpoint payload. Values are stored in
+// host byte order; checkpoints are only read back by the same build.
+class CheckpointWriter {
+private:
+    std::vector<char>& out;
+
+public:
+    explicit CheckpointWriter(std::vector<char>& buffer) : out(buffer) {}
+    
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be plain data");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+    
+    void putString(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        out.insert(out.end(), value.begin(), value.end());
+    }
+    
+    void putDoubles(const double* values, size_t count) {
+        put(static_cast<uint64_t>(count));
+        const char* bytes = reinterpret_cast<const char*>(values);
+        out.insert(out.end(), bytes, bytes + count * sizeof(double));
+    }
+};
+
+// Reads a payload written by CheckpointWriter; throws std::runtime_error if it
+// runs past the end, so a truncated payload can't be half-applied silently
+class CheckpointReader {
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+
+public:
+    CheckpointReader(const char* payload, size_t length) : data(payload), size(length), offset(0) {}
+    
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "checkpoint values must be plain data");
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+    
+    std::string getString() {
+        uint32_t length = get<uint32_t>();
+        return std::string(take(length), length);
+    }
+    
+    std::vector<double> getDoubles() {
+        uint64_t count = get<uint64_t>();
+        if (count > (size - offset) / sizeof(double)) {
+            throw std::runtime_error("Checkpoint payload truncated");
+        }
+        std::vector<double> values(count);
+        std::memcpy(values.data(), take(count * sizeof(double)), count * sizeof(double));
+        return values;
+    }
+    
+    bool atEnd() const { return offset == size; }
+
+private:
+    const char* take(size_t length) {
+        if (length > size - offset) {
+            throw std::runtime_error("Checkpoint payload truncated");
+        }
+        const char* at = data + offset;
+        offset += length;
+        return at;
+    }
+};
+
+// Writes checkpoint payloads to disk on its own thread. Each write goes to
+// <path>.tmp, is synced, then renamed over <path>, so a crash leaves either
+// the old checkpoint or the new one, never a torn file.
+class StateCheckpointer {
+private:
+    Logger& logger;
+    std::string path;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point next_due;
+    
+    std::thread writer;
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    std::vector<char> pending_payload;
+    bool has_pending;
+    bool stopping;
+    uint64_t submitted_generation;
+    
+    // The writer thread and writeNow share the .tmp file; generations keep a
+    // slow background write from replacing a newer checkpoint
+    std::mutex file_mutex;
+    uint64_t written_generation;
+    
+    // Statistics
+    std::atomic<size_t> checkpoints_written{0};
+    std::atomic<size_t> write_failures{0};
+
+public:
+    StateCheckpointer(const std::string& checkpoint_path, Logger& log,
+                      std::chrono::milliseconds write_interval = std::chrono::seconds(1));
+    ~StateCheckpointer();
+    
+    StateCheckpointer(const StateCheckpointer&) = delete;
+    StateCheckpointer& operator=(const StateCheckpointer&) = delete;
+    
+    bool due(std::chrono::steady_clock::time_point now) const { return now >= next_due; }
+    std::chrono::milliseconds getInterval() const { return interval; }
+    
+    // Hands the payload to the writer thread. The caller's buffer is swapped
+    // with an earlier one so its capacity is reused on the next capture.
+    // A payload not yet written is replaced; only the newest state matters.
+    void submit(std::vector<char>& payload, std::chrono::steady_clock::time_point now);
+    
+    // Synchronous write, used for the final checkpoint at shutdown
+    bool writeNow(const std::vector<char>& payload);
+    
+    // Loads the checkpoint at path if it is intact and no older than max_age
+    static bool load(const std::string& path, std::chrono::seconds max_age,
+                     std::vector<char>& payload, Logger& log);
+    
+    const std::string& getPath() const { return path; }
+    size_t getCheckpointsWritten() const { return checkpoints_written; }
+    size_t getWriteFailures() const { return write_failures; }
+
+private:
+    void writerLoop();
+    bool writeFile(const std::vector<char>& payload, uint64_t generation);
+};
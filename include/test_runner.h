@@ -19,6 +19,28 @@ private:
     void testTickerDataStructure();
     void testCSVFormatting();
     void testWebSocketConnection();
+    void testZeroAllocationPath();
+    void testSharedTickPublisher();
+    void testTickFanoutConflation();
+    void testCSVRollingCompression();
+    void testFileSinkBackends();
+    void testMetricsRegistry();
+    void testCompiledPipeline();
+    void testIndicators();
+    void testStateCheckpoint();
+    void testEMAReplay();
+    void testTickConflation();
+    void testDerivedStreams();
+    void testTickHistory();
+    void testFeedWatchdog();
+    void testGracefulShutdown();
+    void testEpollWebSocketTransport();
+    void testTracepoints();
+    void testWebSocketPool();
+    void testFeedIngest();
+    void testBinaryLog();
+    void testEventLoop();
+    void testAllocationAccounting();
     
     void assertTrue(bool condition, const std::string& test_name, const std::string& details = "");
     void assertEqual(double expected, double actual, const std::string& test_name, double tolerance = 0.001);
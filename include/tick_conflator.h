@@ -0,0 +1,165 @@
+#pragma once
+#include "ticker_data.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ConflationOptions {
+    std::chrono::milliseconds interval{0};      // per-product minimum gap between rows; 0 = every tick
+    double price_threshold = 0.0;               // relative move that emits at once, e.g. 0.0005 = 5 bp; 0 = off
+};
+
+// Throttles sink output per product while the EMAs and indicators upstream
+// keep updating on every tick. A product emits when its interval has passed
+// since its last row or its price has moved by the threshold; ticks in
+// between are held as the product's pending row, and each one superseded
+// before it is written is counted as conflated. A pending row is written
+// once its interval expires, checked against the timestamps of later ticks
+// from any product or by flushDue() from a timer, or by flush(), so the
+// latest state always reaches the sink.
+//
+// Times come from TickerData::timestamp. Not thread-safe: offer and flush
+// belong to the processing thread; the statistics can be read from anywhere.
+class TickConflator {
+private:
+    using TimePoint = std::chrono::system_clock::time_point;
+    
+    struct ProductState {
+        TimePoint last_emit;
+        double last_emitted_price = 0.0;
+        bool emitted = false;
+        bool has_pending = false;
+        TickerData pending;             // strings keep their capacity between ticks
+    };
+    
+    ConflationOptions options;
+    std::vector<ProductState> products;
+    std::unordered_map<std::string, size_t> product_index;
+    std::string last_product;
+    size_t last_index;
+    size_t pending_count;
+    TimePoint next_deadline;            // earliest time a pending row falls due
+    
+    // Statistics
+    std::atomic<size_t> ticks_offered{0};
+    std::atomic<size_t> rows_emitted{0};
+    std::atomic<size_t> ticks_conflated{0};
+    MetricCounter& conflated_metric;
+
+public:
+    explicit TickConflator(const ConflationOptions& conflation_options = ConflationOptions());
+    
+    TickConflator(const TickConflator&) = delete;
+    TickConflator& operator=(const TickConflator&) = delete;
+    
+    bool enabled() const { return options.interval.count() > 0; }
+    std::chrono::milliseconds getInterval() const { return options.interval; }
+    
+    // Passes the ticker, or any pending rows that fell due, to emit(const TickerData&)
+    template <typename Emit>
+    void offer(const TickerData& ticker, Emit&& emit) {
+        ticks_offered.fetch_add(1, std::memory_order_relaxed);
+        if (!enabled()) {
+            emitRow(nullptr, ticker, emit);
+            return;
+        }
+        
+        ProductState& state = products[productFor(ticker.product_id)];
+        if (isDue(state, ticker)) {
+            if (state.has_pending) {
+                // The held row is older than this one; it is never written
+                state.has_pending = false;
+                pending_count--;
+                countConflated();
+            }
+            emitRow(&state, ticker, emit);
+        } else {
+            if (state.has_pending) {
+                countConflated();
+            } else {
+                state.has_pending = true;
+                pending_count++;
+                TimePoint due_at = state.last_emit + options.interval;
+                if (pending_count == 1 || due_at < next_deadline) {
+                    next_deadline = due_at;
+                }
+            }
+            state.pending = ticker;
+        }
+        
+        if (pending_count > 0 && ticker.timestamp >= next_deadline) {
+            emitExpired(ticker.timestamp, emit);
+        }
+    }
+    
+    // Writes every pending row regardless of its interval, e.g. at shutdown
+    template <typename Emit>
+    void flush(Emit&& emit) {
+        for (auto& state : products) {
+            if (state.has_pending) {
+                state.has_pending = false;
+                emitRow(&state, state.pending, emit);
+            }
+        }
+        pending_count = 0;
+    }
+    
+    // Writes the pending rows whose interval has passed by now, for a timer
+    // that flushes a product gone quiet instead of waiting for the next tick
+    template <typename Emit>
+    void flushDue(TimePoint now, Emit&& emit) {
+        if (pending_count > 0 && now >= next_deadline) {
+            emitExpired(now, emit);
+        }
+    }
+    
+    // When the earliest pending row falls due; meaningful while getPendingCount() > 0
+    TimePoint getNextDeadline() const { return next_deadline; }
+    
+    size_t getPendingCount() const { return pending_count; }
+    size_t getTicksOffered() const { return ticks_offered; }
+    size_t getRowsEmitted() const { return rows_emitted; }
+    size_t getTicksConflated() const { return ticks_conflated; }
+
+private:
+    size_t productFor(const std::string& product_id);
+    bool isDue(const ProductState& state, const TickerData& ticker) const;
+    
+    void countConflated() {
+        ticks_conflated.fetch_add(1, std::memory_order_relaxed);
+        conflated_metric.increment();
+    }
+    
+    template <typename Emit>
+    void emitRow(ProductState* state, const TickerData& ticker, Emit& emit) {
+        if (state) {
+            state->last_emit = ticker.timestamp;
+            state->last_emitted_price = ticker.price;
+            state->emitted = true;
+        }
+        emit(ticker);
+        rows_emitted.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Only runs once the earliest deadline has passed, so a burst of ticks
+    // within the interval costs one comparison each
+    template <typename Emit>
+    void emitExpired(TimePoint now, Emit& emit) {
+        bool have_next = false;
+        for (auto& state : products) {
+            if (!state.has_pending) continue;
+            TimePoint due_at = state.last_emit + options.interval;
+            if (due_at <= now) {
+                state.has_pending = false;
+                pending_count--;
+                emitRow(&state, state.pending, emit);
+            } else if (!have_next || due_at < next_deadline) {
+                next_deadline = due_at;
+                have_next = true;
+            }
+        }
+    }
+};
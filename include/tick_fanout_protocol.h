@@ -0,0 +1,18 @@
+#pragma once
+#include "shared_tick_layout.h"
+#include <cstdint>
+
+// Wire format of the local tick fan-out stream. Every message is a fixed-size
+// record in host byte order (the stream never leaves the box), so subscribers
+// can read it straight into a FanoutTickMessage.
+
+constexpr const char* TICK_FANOUT_SOCKET_PATH = "/tmp/coinbase_hft_ticks.sock";
+constexpr uint32_t TICK_FANOUT_MESSAGE_TICK = 1;
+
+struct FanoutTickMessage {
+    uint32_t length;          // sizeof(FanoutTickMessage)
+    uint32_t message_type;    // TICK_FANOUT_MESSAGE_TICK
+    SharedTickSnapshot tick;  // latest tick and EMAs, same layout as the shared-memory slots
+};
+
+static_assert(sizeof(FanoutTickMessage) % sizeof(uint64_t) == 0, "fan-out records must stay word-aligned");
@@ -0,0 +1,91 @@
+#pragma once
+#include "tick_fanout_protocol.h"
+#include "spsc_ring.h"
+#include "ticker_data.h"
+#include "logger.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct FanoutSubscriberStats {
+    int subscriber_id;
+    size_t messages_sent;
+    size_t pending_messages;    // queued plus conflated, i.e. how far behind the subscriber is
+    size_t conflated_updates;   // updates collapsed into a newer one for the same product
+    double lag_ms;              // age of the oldest update not yet sent
+};
+
+// Streams processed ticks to local subscribers over a Unix-domain socket.
+// publish() only pushes into a lock-free ring; a dedicated thread fans out to
+// each subscriber's bounded queue. A subscriber whose queue is full switches to
+// conflation, keeping just the latest update per product until it catches up,
+// so a slow reader never stalls the others or the processing thread.
+class TickFanoutServer {
+private:
+    struct Subscriber;
+    
+    Logger& logger;
+    std::string socket_path;
+    size_t subscriber_capacity;
+    SPSCRing<FanoutTickMessage> source_queue;
+    
+    std::thread server_thread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> server_sleeping{false};
+    int listen_fd;
+    int wake_pipe[2];
+    
+    // Server thread only
+    std::vector<std::unique_ptr<Subscriber>> subscribers;
+    std::unordered_map<std::string, uint32_t> product_index;
+    int next_subscriber_id;
+    std::chrono::steady_clock::time_point last_stats_update;
+    
+    // Statistics
+    std::atomic<size_t> messages_published{0};
+    std::atomic<size_t> source_overflows{0};
+    std::atomic<int64_t> drain_deadline_ns{0};      // steady clock; set by stop()
+    std::atomic<size_t> undelivered_at_stop{0};
+    mutable std::mutex stats_mutex;
+    std::vector<FanoutSubscriberStats> subscriber_stats;
+    int metrics_collector_id;
+
+public:
+    TickFanoutServer(const std::string& path, Logger& log, 
+                     size_t source_capacity = 8192, size_t per_subscriber_capacity = 1024);
+    ~TickFanoutServer();
+    
+    TickFanoutServer(const TickFanoutServer&) = delete;
+    TickFanoutServer& operator=(const TickFanoutServer&) = delete;
+    
+    bool start();
+    
+    // Keeps delivering what is already queued, for up to drain_timeout, before
+    // closing subscribers; call once nothing publishes any more
+    void stop(std::chrono::milliseconds drain_timeout = std::chrono::milliseconds(0));
+    bool isRunning() const { return running; }
+    
+    // Called from the processing thread; never blocks
+    void publish(const TickerData& ticker);
+    
+    // Statistics
+    size_t getMessagesPublished() const { return messages_published; }
+    size_t getSourceOverflows() const { return source_overflows; }
+    size_t getUndeliveredAtStop() const { return undelivered_at_stop; }     // left when the drain timed out
+    std::vector<FanoutSubscriberStats> getSubscriberStats() const;
+    
+private:
+    void serverLoop();
+    void acceptSubscribers();
+    void distribute(const FanoutTickMessage& message);
+    bool flushSubscriber(Subscriber& subscriber);
+    void updateStats(bool force);
+    void renderMetrics(std::string& out) const;
+    void closeSubscriber(size_t index);
+};
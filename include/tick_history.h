@@ -0,0 +1,161 @@
+#pragma once
+#include "ticker_data.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct HistoryTick {
+    int64_t timestamp_us;
+    double price;
+    double best_bid;
+    double best_ask;
+    
+    double midPrice() const { return (best_bid + best_ask) / 2.0; }
+};
+
+// Trade price statistics over a time range
+struct HistoryAggregate {
+    size_t count = 0;
+    int64_t first_timestamp_us = 0;
+    int64_t last_timestamp_us = 0;
+    double first_price = 0.0;
+    double last_price = 0.0;
+    double min_price = 0.0;
+    double max_price = 0.0;
+    double sum_price = 0.0;
+    
+    double meanPrice() const { return count > 0 ? sum_price / count : 0.0; }
+};
+
+// Compressed in-memory tick history per product, kept for a retention window.
+//
+// Ticks are packed into blocks of up to BLOCK_TICKS. Within a block the
+// timestamp is stored as a delta-of-delta and each price as a delta in units
+// of the product's last decimal place (TickerData::price_decimals), both in
+// variable-width bit buckets; a value that is not exact at that precision is
+// stored raw. Decoding is lossless. Realistic quote streams take 4-6 bytes per tick.
+//
+// Each block keeps its time span and price summary uncompressed, so a range
+// query binary-searches the blocks, decodes only the two at its edges and
+// aggregates the blocks in between from their summaries.
+//
+// Thread-safe: the processing thread appends while others query.
+class TickHistory {
+public:
+    static constexpr uint32_t BLOCK_TICKS = 1024;
+    
+    // Decodes one block tick by tick
+    class BlockDecoder;
+
+private:
+    struct Block {
+        int64_t first_timestamp_us = 0;
+        int64_t last_timestamp_us = 0;
+        uint32_t count = 0;
+        double first_price = 0.0;
+        double last_price = 0.0;
+        double min_price = 0.0;
+        double max_price = 0.0;
+        double sum_price = 0.0;
+        std::vector<uint64_t> bits;
+        size_t bit_count = 0;
+        
+        // Encoder state for the next append
+        int64_t previous_timestamp_us = 0;
+        int64_t previous_delta_us = 0;
+        double previous_values[3] = {0.0, 0.0, 0.0};
+    };
+    
+    struct ProductHistory {
+        std::deque<Block> blocks;
+        double scale = 100.0;           // 10^price_decimals
+        size_t tick_count = 0;
+    };
+    
+    std::chrono::microseconds retention;
+    mutable std::mutex history_mutex;
+    std::vector<ProductHistory> products;
+    std::unordered_map<std::string, size_t> product_index;
+    std::string last_product;
+    size_t last_index;
+    size_t evicted_blocks;
+
+public:
+    explicit TickHistory(std::chrono::seconds retention_window = std::chrono::hours(4));
+    
+    TickHistory(const TickHistory&) = delete;
+    TickHistory& operator=(const TickHistory&) = delete;
+    
+    // Timestamps are kept non-decreasing per product (an earlier one is stored
+    // as the previous tick's time) so blocks stay ordered for the range search
+    void append(const TickerData& ticker);
+    
+    // Calls visit(const HistoryTick&) for each tick of the product in
+    // [from_us, to_us], oldest first. Returns the number visited.
+    template <typename Visit>
+    size_t forEach(const std::string& product_id, int64_t from_us, int64_t to_us, Visit&& visit) const;
+    
+    HistoryAggregate aggregate(const std::string& product_id, int64_t from_us, int64_t to_us) const;
+    
+    // Statistics
+    size_t getTickCount(const std::string& product_id) const;
+    size_t getTotalTicks() const;
+    size_t getBlockCount() const;
+    size_t getMemoryBytes() const;      // block payloads and headers
+    size_t getEvictedBlocks() const;
+
+private:
+    const ProductHistory* findProduct(const std::string& product_id) const;
+    size_t firstBlockFor(const ProductHistory& product, int64_t from_us) const;
+    void evictExpired(ProductHistory& product, int64_t newest_us);
+    static void encode(Block& block, double scale, int64_t timestamp_us, const double* values);
+};
+
+class TickHistory::BlockDecoder {
+private:
+    const uint64_t* words;
+    size_t position;
+    uint32_t remaining;
+    double scale;
+    int64_t timestamp_us;
+    int64_t delta_us;
+    double values[3];
+    bool started;
+
+public:
+    BlockDecoder(const Block& block, double price_scale);
+    
+    bool next(HistoryTick& tick);
+
+private:
+    uint64_t readBits(unsigned count);
+    double readValue(double previous);
+};
+
+template <typename Visit>
+size_t TickHistory::forEach(const std::string& product_id, int64_t from_us, int64_t to_us, Visit&& visit) const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    const ProductHistory* product = findProduct(product_id);
+    if (!product || from_us > to_us) return 0;
+    
+    size_t visited = 0;
+    for (size_t b = firstBlockFor(*product, from_us); b < product->blocks.size(); ++b) {
+        const Block& block = product->blocks[b];
+        if (block.first_timestamp_us > to_us) break;
+        
+        BlockDecoder decoder(block, product->scale);
+        HistoryTick tick;
+        while (decoder.next(tick)) {
+            if (tick.timestamp_us > to_us) return visited;
+            if (tick.timestamp_us >= from_us) {
+                visit(tick);
+                visited++;
+            }
+        }
+    }
+    return visited;
+}
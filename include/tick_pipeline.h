@@ -0,0 +1,104 @@
+#pragma once
+#include "ticker_data.h"
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Tick processing chain fixed at compile time. Each stage is a callable taking
+// TickerData&; a stage returning bool can stop the chain by returning false.
+// Stages are held by value and called directly, so the compiler sees the whole
+// chain and there is no indirect call per stage.
+template <typename... Stages>
+class TickPipeline {
+private:
+    std::tuple<Stages...> stages;
+
+public:
+    explicit TickPipeline(Stages... pipeline_stages) : stages(std::move(pipeline_stages)...) {}
+    
+    void process(TickerData& ticker) { run<0>(ticker); }
+    
+    template <size_t Index>
+    auto& stage() { return std::get<Index>(stages); }
+    
+    static constexpr size_t stageCount() { return sizeof...(Stages); }
+    
+private:
+    template <size_t Index>
+    void run(TickerData& ticker) {
+        if constexpr (Index < sizeof...(Stages)) {
+            auto& current = std::get<Index>(stages);
+            if constexpr (std::is_same_v<decltype(current(ticker)), bool>) {
+                if (!current(ticker)) return;
+            } else {
+                current(ticker);
+            }
+            run<Index + 1>(ticker);
+        }
+    }
+};
+
+template <typename... Stages>
+TickPipeline<Stages...> makeTickPipeline(Stages... stages) {
+    return TickPipeline<Stages...>(std::move(stages)...);
+}
+
+// Stand-in for a stage that is compiled out; accepts and ignores the real
+// stage's constructor arguments so configurations differ only in a flag
+struct DisabledStage {
+    template <typename... Args>
+    explicit DisabledStage(Args&&...) {}
+    void operator()(TickerData&) const {}
+};
+
+template <bool Enabled, typename Stage>
+using OptionalStage = std::conditional_t<Enabled, Stage, DisabledStage>;
+
+// Parser front end: raw frame in, ticker through the pipeline. Non-ticker
+// messages are dropped; parse errors propagate to the caller.
+template <typename Parser, typename Pipeline>
+class FramePipeline {
+private:
+    Parser& parser;
+    Pipeline& pipeline;
+    TickerData scratch_ticker;
+
+public:
+    FramePipeline(Parser& frame_parser, Pipeline& tick_pipeline) 
+        : parser(frame_parser), pipeline(tick_pipeline) {}
+    
+    bool onFrame(std::string_view frame) {
+        parser.parseTickerMessage(frame, scratch_ticker);
+        if (scratch_ticker.type != "ticker") return false;
+        pipeline.process(scratch_ticker);
+        return true;
+    }
+};
+
+// Type-erased holder for tests and other places where the concrete pipeline
+// type would leak too far; costs one virtual call per tick
+class AnyTickPipeline {
+private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual void process(TickerData& ticker) = 0;
+    };
+    
+    template <typename Pipeline>
+    struct Model : Concept {
+        Pipeline pipeline;
+        explicit Model(Pipeline p) : pipeline(std::move(p)) {}
+        void process(TickerData& ticker) override { pipeline.process(ticker); }
+    };
+    
+    std::unique_ptr<Concept> impl;
+
+public:
+    template <typename Pipeline>
+    explicit AnyTickPipeline(Pipeline pipeline) 
+        : impl(std::make_unique<Model<Pipeline>>(std::move(pipeline))) {}
+    
+    void process(TickerData& ticker) { impl->process(ticker); }
+};
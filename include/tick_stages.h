@@ -0,0 +1,77 @@
+#pragma once
+#include "ema_calculator.h"
+#include "indicators.h"
+#include "ticker_data.h"
+#include "csv_writer.h"
+#include "tick_conflator.h"
+#include "tick_history.h"
+#include "shared_tick_publisher.h"
+#include "tick_fanout_server.h"
+#include "tracepoints.h"
+#include <atomic>
+
+// Adapters that plug the processor's components into a TickPipeline. They hold
+// references only; the components stay owned by whoever built the pipeline.
+
+struct SequenceStage {
+    std::atomic<size_t>& counter;
+    
+    void operator()(TickerData& ticker) const {
+        ticker.sequence_number = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+};
+
+struct EMAStage {
+    EMACalculator& price_ema;
+    EMACalculator& mid_price_ema;
+    std::atomic<size_t>& updates;
+    
+    void operator()(TickerData& ticker) const {
+        HFT_TRACE2(ema_start, ticker.sequence_number, ticker.product_id.c_str());
+        ticker.price_ema = price_ema.update(ticker.price);
+        ticker.mid_price_ema = mid_price_ema.update(ticker.mid_price);
+        updates.fetch_add(1, std::memory_order_relaxed);
+        HFT_TRACE2(ema_end, ticker.sequence_number, ticker.product_id.c_str());
+    }
+};
+
+struct IndicatorStage {
+    IndicatorEngine& engine;
+    
+    void operator()(TickerData& ticker) const { engine.update(ticker); }
+};
+
+struct HistoryStage {
+    TickHistory& history;
+    
+    void operator()(TickerData& ticker) const { history.append(ticker); }
+};
+
+struct CSVSinkStage {
+    CSVWriter& writer;
+    
+    void operator()(TickerData& ticker) const { writer.writeTickerData(ticker); }
+};
+
+// CSV output throttled per product; rows the conflator holds back are written
+// later with the product's latest state, or counted if a newer tick replaces them
+struct ConflatedCSVSinkStage {
+    TickConflator& conflator;
+    CSVWriter& writer;
+    
+    void operator()(TickerData& ticker) const {
+        conflator.offer(ticker, [this](const TickerData& row) { writer.writeTickerData(row); });
+    }
+};
+
+struct SharedTickStage {
+    SharedTickPublisher& publisher;
+    
+    void operator()(TickerData& ticker) const { publisher.publish(ticker); }
+};
+
+struct FanoutStage {
+    TickFanoutServer& server;
+    
+    void operator()(TickerData& ticker) const { server.publish(ticker); }
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <chrono>
+#include <cstdint>
 
 struct TickerData {
     std::string type;
@@ -14,9 +15,22 @@ struct TickerData {
     double price_ema;
     double mid_price_ema;
     size_t sequence_number;
+    uint64_t exchange_sequence;     // "sequence" from Coinbase, per product; 0 when absent
+    
+    // Decimals written for price, bid, ask and mid: 2 for exchange quotes,
+    // more for derived values such as ETH-BTC
+    int price_decimals;
+    
+    // Extra CSV columns filled by IndicatorEngine; NaN is written as an empty cell
+    const double* indicator_values;
+    size_t indicator_count;
     
     TickerData();
     std::string toCSVRow() const;
     std::string toLogString() const;
     void calculateMidPrice();
-};
\ No newline at end of file
+    
+    // Writes the CSV row (no newline) into buffer without allocating.
+    // Returns the full row length; nothing usable is written if that exceeds capacity.
+    size_t formatCSVRow(char* buffer, size_t capacity) const;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+// Static tracepoints (USDT) under the provider "hft", for attaching perf or
+// bpftrace to a production binary without rebuilding it:
+//
+//   bpftrace -l 'usdt:./coinbase_ticker:hft:*'
+//   bpftrace tools/bpftrace/stage_latency.bt -p $(pidof coinbase_ticker)
+//
+// Each probe compiles to one nop plus an ELF note (.note.stapsdt) saying where
+// the nop is and where its arguments live; nothing else runs unless a tracer
+// attaches. Built in when CMake finds <sys/sdt.h> (systemtap-sdt-dev) and
+// HFT_USDT is on; otherwise the macros expand to nothing.
+//
+// Each start/end pair below fires on one thread, so scripts pair them by
+// thread id. In the THREADED execution mode a whole tick, frame to CSV row, is
+// handled on the transport thread too. In COROUTINES mode frame_received and
+// parse_* fire on the transport thread but tick_start through tick_end fire on
+// event loop 0, so frame-to-tick measurements keyed by tid only work THREADED.
+//
+//
+//   frame_received   message_number, bytes           WebSocketClient
+//   parse_start      bytes                           JSONParser
+//   parse_end        product_id, path (1 scan, 2 document)
+//   tick_start       product_id                      HFTProcessor::processTick
+//   ema_start        sequence, product_id            EMAStage
+//   ema_end          sequence, product_id
+//   csv_write_start  sequence, product_id            CSVWriter::writeTickerData
+//   csv_flush_start  sequence, product_id
+//   csv_flush_end    sequence, product_id
+//   tick_end         sequence, product_id            HFTProcessor::processTick
+//
+// product_id arguments are C strings (str(argN) in bpftrace). Arguments are
+// integers and pointers only: floating-point probe arguments are not portable.
+
+#ifdef HFT_HAVE_USDT
+#include <sys/sdt.h>
+
+#define HFT_TRACE1(name, a1) STAP_PROBE1(hft, name, a1)
+#define HFT_TRACE2(name, a1, a2) STAP_PROBE2(hft, name, a1, a2)
+#else
+#define HFT_TRACE1(name, a1) do {} while (0)
+#define HFT_TRACE2(name, a1, a2) do {} while (0)
+#endif
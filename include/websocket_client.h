@@ -2,46 +2,112 @@
 #include "ticker_data.h"
 #include "logger.h"
 #include "json_parser.h"
+#include "metrics.h"
+#include "epoll_websocket.h"
 #include <ixwebsocket/IXWebSocket.h>
+#include <memory>
 #include <queue>
 #include <mutex>
 #include <functional>
 #include <atomic>
+#include <string_view>
+#include <vector>
+
+// IXWEBSOCKET copies every message into a std::string on ix's own thread;
+// EPOLL (EpollWebSocket) parses frames in place on a thread we own and
+// hands them to the parser as string_views
+enum class WebSocketTransport {
+    IXWEBSOCKET,
+    EPOLL
+};
 
 class WebSocketClient {
 private:
     ix::WebSocket webSocket;
+    std::unique_ptr<EpollWebSocket> native_socket;  // set when the EPOLL transport is in use
+    std::string ws_url;
     std::mutex data_mutex;
     std::queue<TickerData> data_queue;
     
     Logger& logger;
     JSONParser json_parser;
     std::string product_id;
+    
+    // Ticker subscription, product_id first; changed at runtime by subscribe()/unsubscribe()
+    mutable std::mutex subscription_mutex;
+    std::vector<std::string> subscribed_products;
     std::atomic<bool> running{false};
     std::atomic<bool> connected{false};
     
-    std::function<void(const TickerData&)> data_callback;
+    std::function<void(TickerData&)> data_callback;
+    std::function<void()> heartbeat_callback;      // set when the heartbeat channel is subscribed
     
-    // Statistics
-    size_t messages_received;
-    size_t parse_errors;
+    // Reused for every message so steady-state parsing does not allocate
+    TickerData scratch_ticker;
+    
+    // Statistics (written on the transport thread, read from the main loop)
+    std::atomic<size_t> messages_received;
+    std::atomic<size_t> parse_errors;
+    std::atomic<size_t> heartbeats_received{0};
+    std::atomic<size_t> reconnects{0};
+    
+    MetricCounter& messages_metric;
+    MetricCounter& heartbeats_metric;
+    MetricCounter& reconnects_metric;
+    MetricCounter& disconnects_metric;
+    MetricCounter& malformed_json_metric;
+    MetricCounter& wrong_field_type_metric;
+    MetricCounter& not_a_ticker_metric;
+    MetricCounter& other_error_metric;
+    MetricGauge& connected_metric;
 
 public:
-    WebSocketClient(const std::string& product, Logger& log);
+    // EPOLL falls back to IXWEBSOCKET when EpollWebSocket::isAvailable() is false
+    WebSocketClient(const std::string& product, Logger& log,
+                    WebSocketTransport transport = WebSocketTransport::IXWEBSOCKET,
+                    const std::string& url = "wss://ws-feed.exchange.coinbase.com",
+                    const EpollWebSocketOptions& native_options = EpollWebSocketOptions());
     ~WebSocketClient();
     
-    void setDataCallback(std::function<void(const TickerData&)> callback);
+    void setDataCallback(std::function<void(TickerData&)> callback);
+    
+    // Further products for the ticker subscription; call before start()
+    void addProducts(const std::vector<std::string>& product_ids);
+    
+    // Add or drop products at runtime. Takes effect on the open connection at
+    // once and is kept for reconnects; callable from any thread.
+    void subscribe(const std::vector<std::string>& product_ids);
+    void unsubscribe(const std::vector<std::string>& product_ids);
+    std::vector<std::string> getSubscribedProducts() const;
+    
+    // Also subscribes to the heartbeat channel (one message per product per
+    // second) and calls callback for each heartbeat; call before start()
+    void enableHeartbeats(std::function<void()> callback);
     void start();
     void stop();
+    
+    // Drops the current connection; the transport reconnects and the subscription is resent on open
+    void reconnect(const std::string& reason);
     bool isRunning() const { return running; }
     bool isConnected() const { return connected; }
+    WebSocketTransport getTransport() const {
+        return native_socket ? WebSocketTransport::EPOLL : WebSocketTransport::IXWEBSOCKET;
+    }
     
     // Statistics
-    size_t getMessagesReceived() const { return messages_received; }
-    size_t getParseErrors() const { return parse_errors; }
+    size_t getMessagesReceived() const { return messages_received.load(std::memory_order_relaxed); }
+    size_t getParseErrors() const { return parse_errors.load(std::memory_order_relaxed); }
+    size_t getHeartbeatsReceived() const { return heartbeats_received.load(std::memory_order_relaxed); }
+    size_t getReconnects() const { return reconnects.load(std::memory_order_relaxed); }
     
 private:
     void setupCallbacks();
+    void setupNativeCallbacks();
+    void onOpen();
+    void onClose(int code, const std::string& reason);
+    void onError(int http_status, const std::string& reason);
     void subscribeToTicker();
-    void handleMessage(const std::string& message);
+    bool sendChannelMessage(const char* type, const std::vector<std::string>& product_ids);
+    void handleMessage(std::string_view message);
+    void countParseError(MetricCounter& reason, const char* what, std::string_view message);
 };
\ No newline at end of file
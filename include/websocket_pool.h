@@ -0,0 +1,192 @@
+#pragma once
+#include "websocket_client.h"
+#include "spsc_ring.h"
+#include "logger.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct WebSocketPoolOptions {
+    size_t sessions = 4;
+    WebSocketTransport transport = WebSocketTransport::IXWEBSOCKET;
+    std::string url = "wss://ws-feed.exchange.coinbase.com";
+    size_t queue_capacity = 8192;                           // ticks per session, power of two
+    
+    // Every interval the per-product message rates since the last rebalance
+    // are compared; 0 = only on rebalance()
+    std::chrono::milliseconds rebalance_interval{std::chrono::minutes(5)};
+    double imbalance_tolerance = 0.25;                      // busiest session may exceed the mean by this
+    size_t max_moves_per_rebalance = 8;
+    
+    // How long a moved product waits for its first tick on the new session
+    // before the old one unsubscribes anyway (quiet products may not tick)
+    std::chrono::milliseconds handoff_timeout{5000};
+    std::chrono::milliseconds rate_window{1000};            // per-session rate reporting
+};
+
+struct PoolSessionStats {
+    size_t session;
+    size_t products;
+    size_t messages;
+    double message_rate;            // messages per second over the last rate_window
+    bool connected;
+};
+
+// Spreads a product list over several WebSocketClient sessions, so one busy
+// product's burst is absorbed by its own connection and receive thread.
+//
+// Each session parses on its own transport thread and pushes ticks into its
+// own SPSC ring; a single delivery thread drains the rings and calls the data
+// callback, so the processing stage still sees one tick at a time. A full ring
+// holds up only its session (backpressure onto that TCP stream), never drops;
+// stop() stops the sessions first and the delivery thread empties every ring
+// before it exits.
+//
+// Products start round-robin and are rebalanced by observed message rate.
+// A move subscribes on the new session first and unsubscribes on the old one
+// once the new session has delivered the product (or handoff_timeout passes).
+// During that overlap the new session's ticks for the product are held on the
+// delivery thread; when the old session lets go, what is left in its ring is
+// delivered first, then the held ticks, so each product reaches the callback
+// in exchange sequence order. Ticks both sessions deliver are dropped by
+// sequence number, as are any older than one already delivered.
+class WebSocketPool {
+public:
+    struct Move {
+        size_t product;
+        size_t from;
+        size_t to;
+    };
+
+private:
+    struct Handoff {
+        size_t product;
+        size_t from;
+        size_t to;
+        size_t seen_on_target;      // product's count on the new session at the start
+        std::chrono::steady_clock::time_point deadline;
+    };
+    
+    static constexpr size_t NO_HANDOFF = static_cast<size_t>(-1);
+    
+    // A moving product's ticks from its new session, until the old one lets go
+    struct HeldTicks {
+        size_t session = NO_HANDOFF;
+        std::vector<TickerData> ticks;
+    };
+    
+    Logger& logger;
+    WebSocketPoolOptions options;
+    std::vector<std::string> products;
+    std::unordered_map<std::string, size_t> product_index;     // read-only after construction
+    std::vector<std::unique_ptr<WebSocketClient>> sessions;
+    std::vector<std::unique_ptr<SPSCRing<TickerData>>> queues;
+    std::function<void(TickerData&)> data_callback;
+    
+    // Written on the session threads
+    std::vector<std::atomic<size_t>> product_messages;         // [session * products + product]
+    std::vector<std::atomic<size_t>> session_messages;
+    std::atomic<size_t> duplicates_dropped{0};
+    std::atomic<size_t> backpressure_waits{0};
+    std::atomic<size_t> delivered{0};
+    
+    // Set by the control thread: per product, the session whose ticks are held
+    std::vector<std::atomic<size_t>> handoff_target;
+    
+    // Delivery thread only
+    std::vector<uint64_t> last_delivered;                      // per product, highest exchange sequence
+    std::vector<HeldTicks> held;
+    size_t products_held;
+    
+    // Control thread; guarded by state_mutex for readers elsewhere
+    mutable std::mutex state_mutex;
+    std::vector<size_t> assignment;                            // product -> owning session
+    std::vector<Handoff> handoffs;
+    std::vector<double> session_rates;
+    std::vector<size_t> rate_baseline;                         // session_messages at the last rate sample
+    std::vector<size_t> rebalance_baseline;                    // per product at the last rebalance
+    std::chrono::steady_clock::time_point last_rate_sample;
+    std::chrono::steady_clock::time_point last_rebalance;
+    size_t moves_completed;
+    bool rebalance_requested;
+    
+    std::atomic<bool> running{false};
+    std::atomic<bool> delivering{false};                       // delivery thread still emptying rings
+    std::thread delivery_thread;
+    std::thread control_thread;
+    std::mutex control_mutex;
+    std::condition_variable control_cv;
+    
+    std::vector<MetricGauge*> rate_metrics;
+    std::vector<MetricGauge*> products_metrics;
+    MetricCounter& duplicates_metric;
+    MetricCounter& moves_metric;
+
+public:
+    WebSocketPool(const std::vector<std::string>& product_ids, Logger& log,
+                  const WebSocketPoolOptions& opts = WebSocketPoolOptions());
+    ~WebSocketPool();
+    
+    WebSocketPool(const WebSocketPool&) = delete;
+    WebSocketPool& operator=(const WebSocketPool&) = delete;
+    
+    // Called on the delivery thread, one tick at a time; set before start()
+    void setDataCallback(std::function<void(TickerData&)> callback);
+    void start();
+    void stop();
+    
+    // Rebalance on the control thread as soon as possible
+    void rebalance();
+    
+    // Start handing one product over to another session; false if unknown,
+    // already there or already moving
+    bool moveProduct(const std::string& product_id, size_t to_session);
+    
+    // Entry point for a session's ticks; its WebSocketClient calls this on its
+    // own thread. Public so recorded or simulated feeds can drive the pool.
+    // Waits while the session's ring is full; with no delivery thread to empty
+    // it (before start() or after stop()) a full ring throws std::logic_error.
+    void deliver(size_t session, TickerData& ticker);
+    
+    size_t getSessionCount() const { return sessions.size(); }
+    std::vector<std::string> getSessionProducts(size_t session) const { return sessions.at(session)->getSubscribedProducts(); }
+    size_t sessionOf(const std::string& product_id) const;
+    size_t getPendingHandoffs() const;
+    std::vector<PoolSessionStats> getSessionStats() const;
+    size_t getDuplicatesDropped() const { return duplicates_dropped.load(std::memory_order_relaxed); }
+    size_t getBackpressureWaits() const { return backpressure_waits.load(std::memory_order_relaxed); }
+    size_t getDelivered() const { return delivered.load(std::memory_order_relaxed); }
+    size_t getMovesCompleted() const;
+    void logStatistics() const;
+    
+    // Round-robin start: product i on session i % sessions
+    static std::vector<size_t> initialAssignment(size_t product_count, size_t session_count);
+    
+    // Moves that bring the busiest session within tolerance of the mean load,
+    // each taking from the busiest session the product that best closes its gap
+    // to the idlest one. Fewest moves first, at most max_moves.
+    static std::vector<Move> planRebalance(const std::vector<size_t>& assignment, const std::vector<double>& rates,
+                                           size_t session_count, double tolerance, size_t max_moves);
+
+private:
+    void deliveryLoop();
+    void route(size_t session, TickerData& ticker);
+    void dispatch(size_t product, TickerData& ticker);
+    void releaseHeld(size_t product);
+    void controlLoop();
+    void sampleRates(std::chrono::steady_clock::time_point now);
+    void rebalanceNow(std::chrono::steady_clock::time_point now);
+    void startHandoff(size_t product, size_t to, std::chrono::steady_clock::time_point now);
+    void advanceHandoffs(std::chrono::steady_clock::time_point now);
+    size_t productMessages(size_t session, size_t product) const {
+        return product_messages[session * products.size() + product].load(std::memory_order_relaxed);
+    }
+};
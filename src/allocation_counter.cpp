@@ -0,0 +1,228 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local size_t thread_allocations = 0;
+
+const size_t TAG_COUNT = static_cast<size_t>(AllocationTag::COUNT);
+const size_t THREAD_SLOTS = 256;
+const uint32_t UNCOUNTED = 0xFF;        // allocated before accounting was enabled
+
+// In front of every block; a multiple of max_align_t so the block stays aligned
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+    size_t size;
+    uint32_t tag;
+};
+
+struct alignas(64) Counters {
+    std::atomic<size_t> allocations[TAG_COUNT];
+    std::atomic<size_t> frees[TAG_COUNT];
+    std::atomic<size_t> bytes_allocated[TAG_COUNT];
+    std::atomic<size_t> bytes_freed[TAG_COUNT];
+};
+
+// Written only by the thread holding it, so updates are a plain load and store
+// rather than a locked add; readers may see a value one update behind
+struct ThreadSlot {
+    std::atomic<bool> in_use;
+    Counters counters;
+};
+
+// Zero-initialized before any constructor runs, so allocations during static
+// initialization find them ready
+ThreadSlot thread_slots[THREAD_SLOTS];
+Counters shared_counters;       // threads beyond THREAD_SLOTS, and those that have exited
+std::atomic<bool> accounting{false};
+
+// Trivially destructible, so it stays usable while the thread's other
+// thread_locals are destroyed (and free memory) after SlotRelease has run
+struct SlotState {
+    ThreadSlot* slot;
+    bool assigned;
+};
+thread_local SlotState slot_state = {nullptr, false};
+
+// Folds the thread's counts into shared_counters and frees its slot at thread exit
+struct SlotRelease {
+    bool armed = false;
+    ~SlotRelease() {
+        ThreadSlot* slot = slot_state.slot;
+        if (!slot) return;
+        slot_state.slot = nullptr;
+        for (size_t tag = 0; tag < TAG_COUNT; ++tag) {
+            shared_counters.allocations[tag].fetch_add(slot->counters.allocations[tag].exchange(0), std::memory_order_relaxed);
+            shared_counters.frees[tag].fetch_add(slot->counters.frees[tag].exchange(0), std::memory_order_relaxed);
+            shared_counters.bytes_allocated[tag].fetch_add(slot->counters.bytes_allocated[tag].exchange(0), std::memory_order_relaxed);
+            shared_counters.bytes_freed[tag].fetch_add(slot->counters.bytes_freed[tag].exchange(0), std::memory_order_relaxed);
+        }
+        slot->in_use.store(false, std::memory_order_release);
+    }
+};
+thread_local SlotRelease slot_release;
+
+// The calling thread's counters, or nullptr to update shared_counters
+Counters* threadCounters() {
+    if (!slot_state.assigned) {
+        slot_state.assigned = true;
+        for (auto& slot : thread_slots) {
+            bool expected = false;
+            if (!slot.in_use.load(std::memory_order_relaxed) &&
+                slot.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                slot_state.slot = &slot;
+                slot_release.armed = true;
+                break;
+            }
+        }
+    }
+    return slot_state.slot ? &slot_state.slot->counters : nullptr;
+}
+
+void add(std::atomic<size_t>* owned, std::atomic<size_t>& shared, size_t delta) {
+    if (owned) {
+        owned->store(owned->load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    } else {
+        shared.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void* countedAllocate(std::size_t size) {
+    ++thread_allocations;
+    void* raw = std::malloc(sizeof(BlockHeader) + size);
+    if (!raw) {
+        return nullptr;
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(raw);
+    header->size = size;
+    header->tag = UNCOUNTED;
+    if (accounting.load(std::memory_order_relaxed)) {
+        size_t tag = static_cast<size_t>(allocation_detail::current_tag);
+        Counters* counters = threadCounters();
+        add(counters ? &counters->allocations[tag] : nullptr, shared_counters.allocations[tag], 1);
+        add(counters ? &counters->bytes_allocated[tag] : nullptr, shared_counters.bytes_allocated[tag], size);
+        header->tag = static_cast<uint32_t>(tag);
+    }
+    return header + 1;
+}
+
+void countedFree(void* ptr) noexcept {
+    if (!ptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    if (header->tag != UNCOUNTED) {
+        size_t tag = header->tag;
+        Counters* counters = threadCounters();
+        add(counters ? &counters->frees[tag] : nullptr, shared_counters.frees[tag], 1);
+        add(counters ? &counters->bytes_freed[tag] : nullptr, shared_counters.bytes_freed[tag], header->size);
+    }
+    std::free(header);
+}
+
+void sum(const Counters& counters, size_t tag, AllocationStats& result) {
+    result.allocations += counters.allocations[tag].load(std::memory_order_relaxed);
+    result.frees += counters.frees[tag].load(std::memory_order_relaxed);
+    result.bytes_allocated += counters.bytes_allocated[tag].load(std::memory_order_relaxed);
+    result.bytes_freed += counters.bytes_freed[tag].load(std::memory_order_relaxed);
+}
+} // namespace
+
+const char* allocationTagName(AllocationTag tag) {
+    switch (tag) {
+        case AllocationTag::UNTAGGED: return "untagged";
+        case AllocationTag::RECEIVE:  return "receive";
+        case AllocationTag::PARSE:    return "parse";
+        case AllocationTag::PROCESS:  return "process";
+        case AllocationTag::CSV:      return "csv";
+        case AllocationTag::LOGGER:   return "logger";
+        case AllocationTag::COUNT:    break;
+    }
+    return "unknown";
+}
+
+size_t AllocationCounter::threadAllocations() {
+    return thread_allocations;
+}
+
+void AllocationCounter::enableAccounting() {
+    accounting.store(true, std::memory_order_relaxed);
+}
+
+void AllocationCounter::disableAccounting() {
+    accounting.store(false, std::memory_order_relaxed);
+}
+
+bool AllocationCounter::accountingEnabled() {
+    return accounting.load(std::memory_order_relaxed);
+}
+
+AllocationStats AllocationCounter::stats(AllocationTag tag) {
+    size_t index = static_cast<size_t>(tag);
+    AllocationStats result;
+    if (index >= TAG_COUNT) return result;
+    for (const auto& slot : thread_slots) {
+        sum(slot.counters, index, result);
+    }
+    sum(shared_counters, index, result);
+    return result;
+}
+
+AllocationStats AllocationCounter::total() {
+    AllocationStats result;
+    for (size_t index = 0; index < TAG_COUNT; ++index) {
+        AllocationStats tag = stats(static_cast<AllocationTag>(index));
+        result.allocations += tag.allocations;
+        result.frees += tag.frees;
+        result.bytes_allocated += tag.bytes_allocated;
+        result.bytes_freed += tag.bytes_freed;
+    }
+    return result;
+}
+
+void* operator new(std::size_t size) {
+    void* ptr = countedAllocate(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    void* ptr = countedAllocate(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
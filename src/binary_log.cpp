@@ -0,0 +1,268 @@
+#include "binary_log.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// IDs below this are reserved for the built-in templates
+const uint32_t FIRST_TEMPLATE_ID = 16;
+
+std::atomic<uint32_t>& nextTemplateId() {
+    static std::atomic<uint32_t> next{FIRST_TEMPLATE_ID};
+    return next;
+}
+
+template <typename T>
+bool readRaw(std::string_view data, size_t& pos, T& value) {
+    if (data.size() - pos < sizeof(T)) return false;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool readVarint(std::string_view data, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < data.size(); shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template <typename T>
+void appendInteger(std::string& out, T value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr - digits);
+}
+
+// Matches "{}" or "{:.Nf}" at format[open]; sets the end of the placeholder
+bool parsePlaceholder(std::string_view format, size_t open, size_t& end, int& precision) {
+    precision = -1;
+    if (format.compare(open, 2, "{}") == 0) {
+        end = open + 2;
+        return true;
+    }
+    if (format.compare(open, 3, "{:.") != 0) return false;
+    size_t pos = open + 3;
+    int digits = 0;
+    int value = 0;
+    while (pos < format.size() && format[pos] >= '0' && format[pos] <= '9' && digits < 2) {
+        value = value * 10 + (format[pos] - '0');
+        ++pos;
+        ++digits;
+    }
+    if (digits == 0 || format.compare(pos, 2, "f}") != 0) return false;
+    precision = value;
+    end = pos + 2;
+    return true;
+}
+
+} // namespace
+
+LogTemplate::LogTemplate(std::string_view text)
+    : id(nextTemplateId().fetch_add(1, std::memory_order_relaxed)), format(text) {}
+
+namespace binlog {
+
+const LogTemplate MESSAGE(0, "{}");
+const LogTemplate TEST(1, "TEST: {} - {}");
+const LogTemplate TEST_DETAILS(2, "TEST: {} - {} | Details: {}");
+
+bool appendUntilPlaceholder(std::string& out, std::string_view format, size_t& cursor, int& precision) {
+    while (cursor < format.size()) {
+        size_t open = format.find('{', cursor);
+        if (open == std::string_view::npos) {
+            break;
+        }
+        out.append(format.data() + cursor, open - cursor);
+        
+        size_t end;
+        if (parsePlaceholder(format, open, end, precision)) {
+            cursor = end;
+            return true;
+        }
+        out += '{';
+        cursor = open + 1;
+    }
+    out.append(format.data() + cursor, format.size() - cursor);
+    cursor = format.size();
+    return false;
+}
+
+void appendSigned(std::string& out, int64_t value) {
+    appendInteger(out, value);
+}
+
+void appendUnsigned(std::string& out, uint64_t value) {
+    appendInteger(out, value);
+}
+
+// std::to_string(double) is "%f"; a precision overrides the 6 decimals
+void appendDouble(std::string& out, double value, int precision) {
+    char digits[512];
+    int length = std::snprintf(digits, sizeof(digits), "%.*f", precision < 0 ? 6 : precision, value);
+    if (length > 0) {
+        out.append(digits, std::min<size_t>(length, sizeof(digits) - 1));
+    }
+}
+
+bool render(std::string& out, std::string_view format, std::string_view arguments) {
+    size_t pos = 0;
+    size_t cursor = 0;
+    int precision;
+    
+    // Once the arguments run out, the rest of the format is copied as written
+    while (pos < arguments.size() && appendUntilPlaceholder(out, format, cursor, precision)) {
+        char type = arguments[pos++];
+        switch (type) {
+            case 'i': {
+                uint64_t value;
+                if (!readVarint(arguments, pos, value)) return false;
+                appendSigned(out, unzigzag(value));
+                break;
+            }
+            case 'u': {
+                uint64_t value;
+                if (!readVarint(arguments, pos, value)) return false;
+                appendUnsigned(out, value);
+                break;
+            }
+            case 'd': {
+                double value;
+                if (!readRaw(arguments, pos, value)) return false;
+                appendDouble(out, value, precision);
+                break;
+            }
+            case 's': {
+                uint64_t length;
+                if (!readVarint(arguments, pos, length) || arguments.size() - pos < length) return false;
+                out.append(arguments.data() + pos, length);
+                pos += length;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    out.append(format.data() + cursor, format.size() - cursor);
+    return true;
+}
+
+void appendTimestamp(std::string& out, int64_t unix_micros) {
+    int64_t seconds = unix_micros / 1000000;
+    int64_t micros = unix_micros % 1000000;
+    if (micros < 0) {
+        micros += 1000000;
+        seconds -= 1;
+    }
+    
+    std::time_t time_t_val = static_cast<std::time_t>(seconds);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time_t_val);
+#else
+    localtime_r(&time_t_val, &local);
+#endif
+    char buffer[64];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    int fraction = std::snprintf(buffer + length, sizeof(buffer) - length, ".%06lld", static_cast<long long>(micros));
+    out.append(buffer, length + (fraction > 0 ? fraction : 0));
+}
+
+std::string formatTimestamp(int64_t unix_micros) {
+    std::string out;
+    appendTimestamp(out, unix_micros);
+    return out;
+}
+
+const char* levelName(uint8_t level) {
+    switch (static_cast<LogLevel>(level)) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARNING: return "WARN";
+        case LogLevel::ERROR: return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+size_t decode(std::string_view data, std::string& out) {
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a binary log (bad magic)");
+    }
+    
+    std::unordered_map<uint64_t, std::string> templates;
+    int64_t timestamp = 0;
+    size_t records = 0;
+    size_t pos = sizeof(MAGIC);
+    while (pos < data.size()) {
+        size_t record_start = pos;
+        char tag = data[pos++];
+        bool complete = true;
+        uint64_t id, length;
+        
+        if (tag == 'B') {
+            // A new session: templates are defined again from here
+            complete = readRaw(data, pos, timestamp);
+            templates.clear();
+        } else if (tag == 'T') {
+            complete = readVarint(data, pos, id) && readVarint(data, pos, length) && data.size() - pos >= length;
+            if (complete) {
+                templates[id].assign(data.data() + pos, length);
+                pos += length;
+            }
+        } else if (tag == 'L') {
+            uint64_t delta;
+            uint8_t level;
+            complete = readVarint(data, pos, delta) && readRaw(data, pos, level) && readVarint(data, pos, id) &&
+                       readVarint(data, pos, length) && data.size() - pos >= length;
+            if (complete) {
+                std::string_view arguments(data.data() + pos, length);
+                pos += length;
+                timestamp += unzigzag(delta);
+                
+                out += '[';
+                out += formatTimestamp(timestamp);
+                out += "] ";
+                if (level != TEST_LEVEL) {
+                    out += '[';
+                    out += levelName(level);
+                    out += "] ";
+                }
+                auto found = templates.find(id);
+                if (found == templates.end()) {
+                    out += "<undefined template " + std::to_string(id) + ">";
+                } else if (!render(out, found->second, arguments)) {
+                    out += " <malformed arguments>";
+                }
+                out += '\n';
+                records++;
+            }
+        } else if (tag == 'R') {
+            complete = readVarint(data, pos, length) && data.size() - pos >= length;
+            if (complete) {
+                out.append(data.data() + pos, length);
+                pos += length;
+            }
+        } else {
+            throw std::runtime_error("Corrupt binary log: unknown record at offset " + std::to_string(record_start));
+        }
+        
+        if (!complete) {
+            break;
+        }
+    }
+    return records;
+}
+
+} // namespace binlog
@@ -1,49 +1,147 @@
 #include "csv_writer.h"
+#include "allocation_counter.h"
+#include "tracepoints.h"
+#include <ctime>
+#include <filesystem>
+#include <fstream>
 
-CSVWriter::CSVWriter(const std::string& filename, Logger& log) 
-    : logger(log), header_written(false), records_written(0) {
+namespace {
+const LogTemplate RECORD_WRITTEN(" Record #{}written to sequence: {})");
+const char CSV_HEADER[] = "timestamp_microseconds,sequence_number,type,product_id,price,best_bid,best_ask,mid_price,price_ema,mid_price_ema";
+
+std::string firstLine(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    std::getline(file, line);
+    return line + "\n";
+}
+}
+
+CSVWriter::CSVWriter(const std::string& path, Logger& log, const CSVWriterOptions& opts) 
+    : logger(log), header_written(false), header(CSV_HEADER), records_written(0), filename(path), options(opts),
+      current_file_bytes(0), segments_rolled(0),
+      rows_metric(MetricsRegistry::global().counter("hft_csv_rows_written_total", "Rows written to CSV output")),
+      segments_metric(MetricsRegistry::global().counter("hft_csv_segments_rolled_total", "CSV segments closed by rollover")),
+      flush_latency_metric(MetricsRegistry::global().histogram("hft_csv_flush_latency_seconds",
+          "Time spent flushing each CSV row to the sink", latencyBucketsNs(), 1e9)) {
+    
+    if (options.compress_closed_segments) {
+        if (SegmentCompressor::isAvailable()) {
+            compressor = std::make_unique<SegmentCompressor>(logger);
+        } else {
+            logger.warning("CSV segment compression requested but zlib is not available");
+        }
+    }
+    
+    for (const auto& column : options.extra_columns) {
+        header += "," + column;
+    }
+    header += "\n";
+    // Room for the base row plus each extra column at full precision
+    row_buffer.resize(512 + 32 * options.extra_columns.size());
+    
+    std::error_code ec;
+    bool has_previous = std::filesystem::exists(filename, ec) && std::filesystem::file_size(filename, ec) > 0;
+    
+    // Appending rows with a different column set would corrupt the file
+    bool header_changed = has_previous && options.append_on_restart && firstLine(filename) != header;
+    if (header_changed) {
+        logger.warning("CSV columns changed since the last run; archiving " + filename);
+    }
     
-    csv_file.open(filename);
-    if (!csv_file.is_open()) {
+    if (has_previous && (header_changed || (!options.append_on_restart && rollingEnabled()))) {
+        // Archive the previous run's output rather than truncating it
+        std::string archived = segmentName(std::chrono::system_clock::now());
+        std::filesystem::rename(filename, archived, ec);
+        if (!ec) {
+            segments_rolled++;
+            segments_metric.increment();
+            if (compressor) {
+                compressor->enqueue(archived);
+            }
+            logger.info("Archived previous CSV output to " + archived);
+        }
+        has_previous = false;
+    }
+    
+    openActiveFile(has_previous && options.append_on_restart && !header_changed);
+    if (!csv_sink->isOpen()) {
         logger.error("Failed to open CSV file: " + filename);
         throw std::runtime_error("Cannot open CSV file");
     }
     
     writeHeader();
-    logger.info("CSV writer initialized " + filename);
+    logger.info("CSV writer initialized " + filename + " (" + csv_sink->backendName() + ")");
 }
 
 CSVWriter::~CSVWriter() {
-    if (csv_file.is_open()) {
-        flush();
-        csv_file.close();
-        logger.info("CSV file closed. Total records written: " + std::to_string(records_written));
+    close();
+}
+
+bool CSVWriter::close() {
+    AllocationScope scope(AllocationTag::CSV);
+    std::lock_guard<std::mutex> lock(csv_mutex);
+    if (!csv_sink->isOpen()) {
+        return !csv_sink->hasFailed();
     }
+    
+    csv_sink->flush();
+    csv_sink->close();
+    bool failed = csv_sink->hasFailed();
+    if (failed) {
+        logger.error("CSV output reported failed writes: " + filename);
+    }
+    logger.info("CSV file closed. Total records written: " + std::to_string(records_written));
+    return !failed;
 }
 
 void CSVWriter::writeHeader() {
     std::lock_guard<std::mutex> lock(csv_mutex);
-    
-    if (!header_written && csv_file.is_open()) {
-        csv_file << "timestamp_microseconds,sequence_number,type,product_id,price,best_bid,best_ask,mid_price,price_ema,mid_price_ema\n";
-        csv_file.flush();
+    writeHeaderLocked();
+}
+
+void CSVWriter::writeHeaderLocked() {
+    if (!header_written && csv_sink->isOpen()) {
+        csv_sink->write(header);
+        csv_sink->flush();
+        current_file_bytes += header.size();
         header_written = true;
         logger.debug("CSV header written");
     }
 }
 
 void CSVWriter::writeTickerData(const TickerData& ticker) {
+    HFT_TRACE2(csv_write_start, ticker.sequence_number, ticker.product_id.c_str());
+    AllocationScope scope(AllocationTag::CSV);
     std::lock_guard<std::mutex> lock(csv_mutex);
     
-    if (csv_file.is_open()) {
-        csv_file << ticker.toCSVRow() << "\n";
-        csv_file.flush();
+    if (csv_sink->isOpen()) {
+        size_t length = ticker.formatCSVRow(row_buffer.data(), row_buffer.size() - 1);
+        if (length < row_buffer.size()) {
+            row_buffer[length] = '\n';
+            csv_sink->write(row_buffer.data(), length + 1);
+        } else {
+            csv_sink->write(ticker.toCSVRow() + "\n");
+        }
+        auto flush_start = std::chrono::steady_clock::now();
+        HFT_TRACE2(csv_flush_start, ticker.sequence_number, ticker.product_id.c_str());
+        csv_sink->flush();
+        HFT_TRACE2(csv_flush_end, ticker.sequence_number, ticker.product_id.c_str());
+        flush_latency_metric.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - flush_start).count());
         records_written++;
+        rows_metric.increment();
+        current_file_bytes += length + 1;
         
         // Log every 25th record for verification
-        if (records_written % 25 == 0) {
-            logger.info(" Record #" + std::to_string(records_written) + 
-                       "written to sequence: " + std::to_string(ticker.sequence_number) + ")");
+        if (records_written % 25 == 0 && logger.isEnabled(LogLevel::INFO)) {
+            logger.log(LogLevel::INFO, RECORD_WRITTEN, records_written, ticker.sequence_number);
+        }
+        
+        if (rollingEnabled() &&
+            ((options.max_file_bytes > 0 && current_file_bytes >= options.max_file_bytes) ||
+             (options.max_file_age.count() > 0 && ticker.timestamp - current_file_opened >= options.max_file_age))) {
+            rollOver();
         }
     }
 }
@@ -51,8 +149,76 @@ void CSVWriter::writeTickerData(const TickerData& ticker) {
 void CSVWriter::flush() {
     std::lock_guard<std::mutex> lock(csv_mutex);
     
-    if (csv_file.is_open()) {
-        csv_file.flush();
+    if (csv_sink->isOpen()) {
+        csv_sink->flush();
         logger.info("Manual flush completed\n");
     }
 }
+
+void CSVWriter::openActiveFile(bool append) {
+    std::error_code ec;
+    current_file_bytes = 0;
+    if (append) {
+        current_file_bytes = static_cast<size_t>(std::filesystem::file_size(filename, ec));
+        if (ec) {
+            current_file_bytes = 0;
+        }
+    }
+    
+    csv_sink = openFileSink(filename, append, options.backend);
+    current_file_opened = std::chrono::system_clock::now();
+    
+    // An appended file already starts with its header
+    header_written = append && current_file_bytes > 0;
+    if (header_written) {
+        logger.info("Appending to existing CSV output " + filename);
+    }
+}
+
+void CSVWriter::rollOver() {
+    csv_sink->close();
+    if (csv_sink->hasFailed()) {
+        logger.error("CSV segment reported failed writes: " + filename);
+    }
+    
+    std::string segment = segmentName(current_file_opened);
+    std::error_code ec;
+    std::filesystem::rename(filename, segment, ec);
+    if (ec) {
+        logger.error("CSV roll-over failed to rename " + filename + ": " + ec.message());
+    } else {
+        segments_rolled++;
+        segments_metric.increment();
+        logger.info("CSV segment closed: " + segment + " (" + std::to_string(current_file_bytes) + " bytes)");
+        if (compressor) {
+            compressor->enqueue(segment);
+        }
+    }
+    
+    openActiveFile(false);
+    writeHeaderLocked();
+}
+
+std::string CSVWriter::segmentName(std::chrono::system_clock::time_point opened) const {
+    std::time_t opened_time = std::chrono::system_clock::to_time_t(opened);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &opened_time);
+#else
+    gmtime_r(&opened_time, &utc);
+#endif
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &utc);
+    
+    std::filesystem::path active(filename);
+    std::string stem = (active.parent_path() / active.stem()).string();
+    std::string extension = active.extension().string();
+    std::string candidate = stem + "_" + stamp + extension;
+    
+    // Several roll-overs within one second get a counter
+    std::error_code ec;
+    for (int suffix = 1; std::filesystem::exists(candidate, ec) || std::filesystem::exists(candidate + ".gz", ec); ++suffix) {
+        candidate = stem + "_" + stamp + "_" + std::to_string(suffix) + extension;
+    }
+    return candidate;
+}
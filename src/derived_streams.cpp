@@ -0,0 +1,204 @@
+#include "derived_streams.h"
+#include "shared_tick_layout.h"
+#include <stdexcept>
+
+namespace {
+
+// Ratios such as ETH-BTC are far below 1, so derived rows carry more decimals than quotes
+const int DERIVED_PRICE_DECIMALS = 8;
+
+// Linear streams are recomputed from their inputs after this many incremental
+// updates, so rounding in the running sums cannot drift
+const uint32_t RESYNC_INTERVAL = 4096;
+
+} // namespace
+
+DerivedSpec DerivedSpec::ratio(const std::string& name, const std::string& numerator, const std::string& denominator) {
+    return DerivedSpec{DerivedType::RATIO, name, {numerator, denominator}, {}};
+}
+
+DerivedSpec DerivedSpec::spread(const std::string& name, const std::string& long_leg, const std::string& short_leg,
+                                double hedge) {
+    return DerivedSpec{DerivedType::SPREAD, name, {long_leg, short_leg}, {1.0, -hedge}};
+}
+
+DerivedSpec DerivedSpec::basket(const std::string& name, const std::vector<std::string>& products,
+                                const std::vector<double>& weights) {
+    return DerivedSpec{DerivedType::BASKET, name, products, weights};
+}
+
+DerivedStreamEngine::DerivedStreamEngine(const std::vector<DerivedSpec>& specs, double ema_alpha)
+    : last_input(-1),
+      derived_metric(MetricsRegistry::global().counter("hft_derived_ticks_total",
+          "Synthetic ticks emitted by cross-product derived streams")) {
+    streams.reserve(specs.size());
+    for (const auto& spec : specs) {
+        if (spec.type == DerivedType::RATIO ? spec.inputs.size() != 2 : spec.inputs.size() != spec.weights.size()) {
+            throw std::invalid_argument("Derived stream " + spec.name + " has mismatched inputs and weights");
+        }
+        if (spec.inputs.empty()) {
+            throw std::invalid_argument("Derived stream " + spec.name + " has no inputs");
+        }
+        // Shared memory and fan-out records hold a NUL-terminated 16-byte product id;
+        // a longer name would be truncated there and never found by readers
+        if (spec.name.empty() || spec.name.size() > SHARED_TICK_PRODUCT_ID_SIZE - 1) {
+            throw std::invalid_argument("Derived stream name " + spec.name + " must be 1 to " +
+                                        std::to_string(SHARED_TICK_PRODUCT_ID_SIZE - 1) + " characters");
+        }
+        
+        uint32_t stream_id = static_cast<uint32_t>(streams.size());
+        streams.emplace_back(spec, ema_alpha);
+        DerivedStream& stream = streams.back();
+        stream.ticker.type = "derived";
+        stream.ticker.product_id = spec.name;
+        stream.ticker.price_decimals = DERIVED_PRICE_DECIMALS;
+        
+        for (size_t slot = 0; slot < spec.inputs.size(); ++slot) {
+            const std::string& product_id = spec.inputs[slot];
+            auto it = input_index.find(product_id);
+            if (it == input_index.end()) {
+                it = input_index.emplace(product_id, static_cast<uint32_t>(inputs.size())).first;
+                inputs.emplace_back();
+                input_names.push_back(product_id);
+            }
+            for (uint32_t existing : stream.inputs) {
+                if (existing == it->second) {
+                    throw std::invalid_argument("Derived stream " + spec.name + " lists " + product_id + " twice");
+                }
+            }
+            stream.inputs.push_back(it->second);
+            inputs[it->second].dependents.push_back(Edge{stream_id, static_cast<uint32_t>(slot)});
+        }
+        stream.missing = static_cast<uint32_t>(stream.inputs.size());
+    }
+}
+
+int DerivedStreamEngine::inputFor(const std::string& product_id) {
+    if (last_input >= 0 && product_id == last_product) {
+        return last_input;
+    }
+    
+    auto it = input_index.find(product_id);
+    if (it == input_index.end()) {
+        return -1;
+    }
+    last_product = product_id;
+    last_input = static_cast<int>(it->second);
+    return last_input;
+}
+
+void DerivedStreamEngine::recordInput(uint32_t input, const TickerData& ticker) {
+    input_ticks.fetch_add(1, std::memory_order_relaxed);
+    InputState& state = inputs[input];
+    double updated[FIELDS] = {ticker.price, ticker.best_bid, ticker.best_ask};
+    
+    for (const Edge& edge : state.dependents) {
+        DerivedStream& stream = streams[edge.stream];
+        if (!state.ticked) {
+            stream.missing--;
+        }
+        if (stream.spec.type == DerivedType::RATIO) continue;
+        
+        // A negative weight sells the leg to buy the combination, so its bid and ask swap sides
+        double weight = stream.spec.weights[edge.slot];
+        int bid_field = weight >= 0.0 ? BID : ASK;
+        int ask_field = weight >= 0.0 ? ASK : BID;
+        stream.sums[PRICE] += weight * (updated[PRICE] - state.values[PRICE]);
+        stream.sums[BID] += weight * (updated[bid_field] - state.values[bid_field]);
+        stream.sums[ASK] += weight * (updated[ask_field] - state.values[ask_field]);
+    }
+    
+    for (int field = 0; field < FIELDS; ++field) {
+        state.values[field] = updated[field];
+    }
+    state.ticked = true;
+}
+
+void DerivedStreamEngine::resync(DerivedStream& stream) {
+    double sums[FIELDS] = {0.0, 0.0, 0.0};
+    for (size_t slot = 0; slot < stream.inputs.size(); ++slot) {
+        const double* values = inputs[stream.inputs[slot]].values;
+        double weight = stream.spec.weights[slot];
+        sums[PRICE] += weight * values[PRICE];
+        sums[BID] += weight * values[weight >= 0.0 ? BID : ASK];
+        sums[ASK] += weight * values[weight >= 0.0 ? ASK : BID];
+    }
+    for (int field = 0; field < FIELDS; ++field) {
+        stream.sums[field] = sums[field];
+    }
+    stream.updates_since_resync = 0;
+}
+
+bool DerivedStreamEngine::computeStream(DerivedStream& stream, const TickerData& trigger) {
+    TickerData& out = stream.ticker;
+    
+    if (stream.spec.type == DerivedType::RATIO) {
+        const double* numerator = inputs[stream.inputs[0]].values;
+        const double* denominator = inputs[stream.inputs[1]].values;
+        if (denominator[PRICE] <= 0.0 || denominator[BID] <= 0.0 || denominator[ASK] <= 0.0) {
+            return false;
+        }
+        out.price = numerator[PRICE] / denominator[PRICE];
+        out.best_bid = numerator[BID] / denominator[ASK];
+        out.best_ask = numerator[ASK] / denominator[BID];
+    } else {
+        if (++stream.updates_since_resync >= RESYNC_INTERVAL) {
+            resync(stream);
+        }
+        out.price = stream.sums[PRICE];
+        out.best_bid = stream.sums[BID];
+        out.best_ask = stream.sums[ASK];
+    }
+    
+    out.calculateMidPrice();
+    out.time = trigger.time;
+    out.timestamp = trigger.timestamp;
+    out.indicator_values = nullptr;
+    out.indicator_count = 0;
+    out.price_ema = stream.price_ema.update(out.price);
+    out.mid_price_ema = stream.mid_price_ema.update(out.mid_price);
+    return true;
+}
+
+void DerivedStreamEngine::saveState(CheckpointWriter& out) const {
+    out.put(static_cast<uint32_t>(streams.size()));
+    for (const auto& stream : streams) {
+        out.putString(stream.spec.name);
+        out.put(stream.price_ema.getAlpha());
+        out.put(stream.price_ema.getCurrentEMA());
+        out.put(static_cast<uint8_t>(stream.price_ema.isInitialized()));
+        out.put(stream.mid_price_ema.getCurrentEMA());
+        out.put(static_cast<uint8_t>(stream.mid_price_ema.isInitialized()));
+    }
+}
+
+DerivedStreamEngine::SavedState DerivedStreamEngine::readState(CheckpointReader& in) {
+    SavedState state;
+    uint32_t count = in.get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+        SavedStream saved;
+        saved.name = in.getString();
+        saved.alpha = in.get<double>();
+        saved.price_ema = in.get<double>();
+        saved.price_initialized = in.get<uint8_t>() != 0;
+        saved.mid_price_ema = in.get<double>();
+        saved.mid_initialized = in.get<uint8_t>() != 0;
+        state.push_back(std::move(saved));
+    }
+    return state;
+}
+
+size_t DerivedStreamEngine::restoreState(const SavedState& state) {
+    size_t restored = 0;
+    for (const auto& saved : state) {
+        for (auto& stream : streams) {
+            if (stream.spec.name == saved.name && stream.price_ema.getAlpha() == saved.alpha) {
+                stream.price_ema.restore(saved.price_ema, saved.price_initialized);
+                stream.mid_price_ema.restore(saved.mid_price_ema, saved.mid_initialized);
+                restored++;
+                break;
+            }
+        }
+    }
+    return restored;
+}
@@ -29,4 +29,9 @@ bool EMACalculator::isInitialized() const {
 void EMACalculator::reset() {
     initialized = false;
     current_ema = 0.0;
+}
+
+void EMACalculator::restore(double ema, bool was_initialized) {
+    current_ema = was_initialized ? ema : 0.0;
+    initialized = was_initialized;
 }
\ No newline at end of file
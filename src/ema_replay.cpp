@@ -0,0 +1,372 @@
+#include "ema_replay.h"
+#include "ema_calculator.h"
+#include "file_sink.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+// Columns of ticker_data.csv used by the replay
+enum CSVColumn { TIMESTAMP = 0, SEQUENCE = 1, PRODUCT = 3, PRICE = 4, BEST_BID = 5, BEST_ASK = 6, PRICE_EMA = 8 };
+
+bool isHeader(std::string_view line) {
+    return line.compare(0, 9, "timestamp") == 0;
+}
+
+// Offsets of up to max_fields comma-separated fields; memchr does the scanning
+size_t splitFields(std::string_view line, std::string_view* fields, size_t max_fields) {
+    const char* cursor = line.data();
+    const char* end = line.data() + line.size();
+    size_t count = 0;
+    while (count < max_fields) {
+        const char* comma = static_cast<const char*>(std::memchr(cursor, ',', end - cursor));
+        const char* field_end = comma ? comma : end;
+        fields[count++] = std::string_view(cursor, field_end - cursor);
+        if (!comma) break;
+        cursor = comma + 1;
+    }
+    return count;
+}
+
+bool parseDouble(std::string_view text, double& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parseDigits(const char* text, size_t count, int64_t& value) {
+    value = 0;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned digit = static_cast<unsigned>(text[i] - '0');
+        if (digit > 9) return false;
+        value = value * 10 + digit;
+    }
+    return true;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+int64_t daysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// "YYYY-MM-DD HH:MM:SS.ffffff" as written by TickerData::formatCSVRow
+bool parseTimestamp(std::string_view text, int64_t& timestamp_us) {
+    if (text.size() != 26 || text[4] != '-' || text[7] != '-' || text[10] != ' ' || text[19] != '.') {
+        return false;
+    }
+    int64_t year, month, day, hour, minute, second, micros;
+    if (!parseDigits(text.data(), 4, year) || !parseDigits(text.data() + 5, 2, month) ||
+        !parseDigits(text.data() + 8, 2, day) || !parseDigits(text.data() + 11, 2, hour) ||
+        !parseDigits(text.data() + 14, 2, minute) || !parseDigits(text.data() + 17, 2, second) ||
+        !parseDigits(text.data() + 20, 6, micros)) {
+        return false;
+    }
+    int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    timestamp_us = seconds * 1000000 + micros;
+    return true;
+}
+
+void appendFixed(std::string& out, double value, int decimals) {
+    // Same formatting as the live CSV writer
+    char digits[400];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, decimals);
+    out.append(digits, result.ptr - digits);
+}
+
+// The live writer prints EMAs with 6 decimals, or with the price's decimals if
+// that is more (derived products such as ETH-BTC)
+int emaDecimals(std::string_view price) {
+    size_t dot = price.find('.');
+    int decimals = dot == std::string_view::npos ? 0 : static_cast<int>(price.size() - dot - 1);
+    return decimals > 6 ? decimals : 6;
+}
+
+template <typename Work>
+void runParallel(size_t threads, Work work) {
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+struct EMAReplay::Chunk {
+    std::string_view text;
+    std::vector<Row> rows;
+    std::vector<std::string_view> names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    size_t malformed = 0;
+};
+
+EMAReplay::EMAReplay(const EMAReplayOptions& replay_options) : options(replay_options) {
+    // Same validation as the live calculators
+    EMACalculator price_check(options.price_alpha);
+    EMACalculator mid_check(options.mid_price_alpha);
+    if (options.threads == 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+EMAReplay::~EMAReplay() = default;
+
+void EMAReplay::addInput(const std::string& path) {
+    inputs.push_back(std::make_unique<MappedFile>(path));
+}
+
+bool EMAReplay::parseRow(std::string_view line, std::string_view& product, uint64_t& sequence_number,
+                         int64_t& timestamp_us, double& price, double& mid_price) {
+    std::string_view fields[PRICE_EMA + 1];
+    if (splitFields(line, fields, PRICE_EMA + 1) <= PRICE_EMA) {
+        return false;
+    }
+    
+    double best_bid, best_ask;
+    auto sequence = std::from_chars(fields[SEQUENCE].data(), fields[SEQUENCE].data() + fields[SEQUENCE].size(), sequence_number);
+    if (sequence.ec != std::errc() || !parseTimestamp(fields[TIMESTAMP], timestamp_us) ||
+        !parseDouble(fields[PRICE], price) || !parseDouble(fields[BEST_BID], best_bid) ||
+        !parseDouble(fields[BEST_ASK], best_ask) || fields[PRODUCT].empty()) {
+        return false;
+    }
+    
+    product = fields[PRODUCT];
+    // The CSV rounds mid_price to cents; recompute it exactly as TickerData::calculateMidPrice does
+    mid_price = (best_bid + best_ask) / 2.0;
+    return true;
+}
+
+void EMAReplay::indexChunk(std::string_view text, Chunk& chunk) const {
+    chunk.rows.reserve(text.size() / 120);
+    const char* cursor = text.data();
+    const char* end = text.data() + text.size();
+    
+    while (cursor < end) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        const char* line_end = newline ? newline : end;
+        std::string_view line(cursor, line_end - cursor);
+        cursor = newline ? newline + 1 : end;
+        
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || isHeader(line)) {
+            continue;
+        }
+        
+        Row row;
+        std::string_view product;
+        if (!parseRow(line, product, row.sequence_number, row.timestamp_us, row.price, row.mid_price)) {
+            chunk.malformed++;
+            continue;
+        }
+        
+        auto id = chunk.ids.find(product);
+        if (id == chunk.ids.end()) {
+            id = chunk.ids.emplace(product, static_cast<uint32_t>(chunk.names.size())).first;
+            chunk.names.push_back(product);
+        }
+        row.line = line.data();
+        row.length = static_cast<uint32_t>(line.size());
+        row.product = id->second;
+        chunk.rows.push_back(row);
+    }
+}
+
+const EMAReplayStats& EMAReplay::run() {
+    stats = EMAReplayStats();
+    stats.threads = options.threads;
+    rows.clear();
+    products.clear();
+    header.clear();
+    
+    // Index: split every input at line boundaries into one byte range per thread
+    auto index_start = std::chrono::steady_clock::now();
+    std::vector<Chunk> chunks;
+    for (const auto& input : inputs) {
+        std::string_view text = input->view();
+        if (header.empty() && isHeader(text)) {
+            header = std::string(text.substr(0, text.find('\n') + 1));
+        }
+        size_t begin = 0;
+        for (size_t t = 0; t < options.threads && begin < text.size(); ++t) {
+            size_t end = (t + 1 == options.threads) ? text.size() : std::max(begin, text.size() * (t + 1) / options.threads);
+            size_t newline = text.find('\n', end);
+            end = (newline == std::string_view::npos || t + 1 == options.threads) ? text.size() : newline + 1;
+            chunks.emplace_back();
+            chunks.back().text = text.substr(begin, end - begin);
+            begin = end;
+        }
+    }
+    
+    std::atomic<size_t> next_chunk{0};
+    runParallel(options.threads, [&](size_t) {
+        for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+            indexChunk(chunks[c].text, chunks[c]);
+        }
+    });
+    
+    // Merge chunk-local product ids into global ones, keeping file order
+    std::unordered_map<std::string_view, uint32_t> global_ids;
+    size_t total_rows = 0;
+    for (const auto& chunk : chunks) {
+        total_rows += chunk.rows.size();
+    }
+    rows.reserve(total_rows);
+    for (auto& chunk : chunks) {
+        std::vector<uint32_t> remap(chunk.names.size());
+        for (size_t i = 0; i < chunk.names.size(); ++i) {
+            auto id = global_ids.find(chunk.names[i]);
+            if (id == global_ids.end()) {
+                id = global_ids.emplace(chunk.names[i], static_cast<uint32_t>(products.size())).first;
+                products.emplace_back(chunk.names[i]);
+            }
+            remap[i] = id->second;
+        }
+        for (Row row : chunk.rows) {
+            row.product = remap[row.product];
+            rows.push_back(row);
+        }
+        stats.malformed_rows += chunk.malformed;
+        chunk.rows = std::vector<Row>();
+    }
+    stats.rows = rows.size();
+    stats.products = products.size();
+    stats.index_seconds = secondsSince(index_start);
+    
+    // Compute: group row indices by product, then hand out products largest first
+    auto compute_start = std::chrono::steady_clock::now();
+    std::vector<size_t> offsets(products.size() + 1, 0);
+    for (const auto& row : rows) {
+        offsets[row.product + 1]++;
+    }
+    for (size_t p = 1; p < offsets.size(); ++p) {
+        offsets[p] += offsets[p - 1];
+    }
+    std::vector<uint32_t> order(rows.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        order[fill[rows[i].product]++] = static_cast<uint32_t>(i);
+    }
+    
+    std::vector<uint32_t> schedule(products.size());
+    for (size_t p = 0; p < schedule.size(); ++p) {
+        schedule[p] = static_cast<uint32_t>(p);
+    }
+    std::sort(schedule.begin(), schedule.end(), [&offsets](uint32_t a, uint32_t b) {
+        return offsets[a + 1] - offsets[a] > offsets[b + 1] - offsets[b];
+    });
+    
+    price_emas.assign(rows.size(), 0.0);
+    mid_price_emas.assign(rows.size(), 0.0);
+    std::atomic<size_t> next_product{0};
+    runParallel(std::min(options.threads, std::max<size_t>(products.size(), 1)), [&](size_t) {
+        for (size_t s = next_product++; s < schedule.size(); s = next_product++) {
+            uint32_t product = schedule[s];
+            EMACalculator price_ema(options.price_alpha);
+            EMACalculator mid_price_ema(options.mid_price_alpha);
+            for (size_t i = offsets[product]; i < offsets[product + 1]; ++i) {
+                uint32_t row = order[i];
+                price_emas[row] = price_ema.update(rows[row].price);
+                mid_price_emas[row] = mid_price_ema.update(rows[row].mid_price);
+            }
+        }
+    });
+    stats.compute_seconds = secondsSince(compute_start);
+    return stats;
+}
+
+void EMAReplay::writeCSV(const std::string& path) {
+    auto output_start = std::chrono::steady_clock::now();
+    auto sink = openFileSink(path, false);
+    if (!sink->isOpen()) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    
+    std::string buffer;
+    buffer.reserve(1 << 20);
+    buffer += header;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        std::string_view line(rows[i].line, rows[i].length);
+        std::string_view fields[PRICE_EMA + 3];
+        size_t count = splitFields(line, fields, PRICE_EMA + 3);
+        
+        // Everything before price_ema, the new EMAs, then any columns after mid_price_ema
+        buffer.append(line.data(), fields[PRICE_EMA].data() - line.data());
+        int decimals = emaDecimals(fields[PRICE]);
+        appendFixed(buffer, price_emas[i], decimals);
+        buffer += ',';
+        appendFixed(buffer, mid_price_emas[i], decimals);
+        if (count > PRICE_EMA + 2) {
+            const char* rest = fields[PRICE_EMA + 2].data() - 1;
+            buffer.append(rest, line.data() + line.size() - rest);
+        }
+        buffer += '\n';
+        
+        if (buffer.size() >= (1 << 20) - 1024) {
+            sink->write(buffer);
+            buffer.clear();
+        }
+    }
+    sink->write(buffer);
+    sink->close();
+    if (sink->hasFailed()) {
+        throw std::runtime_error("Write failed: " + path);
+    }
+    stats.output_seconds = secondsSince(output_start);
+}
+
+void EMAReplay::writeBinary(const std::string& path) {
+    auto output_start = std::chrono::steady_clock::now();
+    auto sink = openFileSink(path, false);
+    if (!sink->isOpen()) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    
+    std::string buffer = "HFTEMAB1";
+    auto putRaw = [&buffer](const void* data, size_t length) {
+        buffer.append(static_cast<const char*>(data), length);
+    };
+    uint32_t product_count = static_cast<uint32_t>(products.size());
+    putRaw(&product_count, sizeof(product_count));
+    for (const auto& product : products) {
+        uint32_t length = static_cast<uint32_t>(product.size());
+        putRaw(&length, sizeof(length));
+        putRaw(product.data(), product.size());
+    }
+    uint64_t row_count = rows.size();
+    putRaw(&row_count, sizeof(row_count));
+    
+    for (size_t i = 0; i < rows.size(); ++i) {
+        EMAReplayRecord record{rows[i].sequence_number, rows[i].timestamp_us, rows[i].product, 0,
+                               rows[i].price, rows[i].mid_price, price_emas[i], mid_price_emas[i]};
+        putRaw(&record, sizeof(record));
+        if (buffer.size() >= (1 << 20)) {
+            sink->write(buffer);
+            buffer.clear();
+        }
+    }
+    sink->write(buffer);
+    sink->close();
+    if (sink->hasFailed()) {
+        throw std::runtime_error("Write failed: " + path);
+    }
+    stats.output_seconds = secondsSince(output_start);
+}
@@ -0,0 +1,771 @@
+#include "epoll_websocket.h"
+#include "allocation_counter.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#if defined(__linux__) && defined(HFT_HAVE_OPENSSL)
+#define HFT_EPOLL_WEBSOCKET 1
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#endif
+
+namespace {
+
+enum Opcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA
+};
+
+const size_t MAX_FRAME_BYTES = 64 * 1024 * 1024;
+const char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// readSome() results besides a byte count
+const long READ_CLOSED = 0;
+const long READ_WOULD_BLOCK = -1;
+const long READ_FAILED = -2;
+
+uint64_t readBigEndian(const unsigned char* bytes, int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; ++i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+char lowerCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Value of an HTTP response header, matched case-insensitively
+std::string_view findHeader(std::string_view response, std::string_view name) {
+    size_t line = response.find("\r\n");
+    while (line != std::string_view::npos && line + 2 < response.size()) {
+        size_t start = line + 2;
+        line = response.find("\r\n", start);
+        std::string_view header = response.substr(start, line == std::string_view::npos ? std::string_view::npos : line - start);
+        size_t colon = header.find(':');
+        if (colon != name.size()) continue;
+        
+        bool match = true;
+        for (size_t i = 0; i < name.size() && match; ++i) {
+            match = lowerCase(header[i]) == name[i];
+        }
+        if (!match) continue;
+        
+        std::string_view value = header.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+        return value;
+    }
+    return std::string_view();
+}
+
+#ifdef HFT_EPOLL_WEBSOCKET
+std::string base64(const unsigned char* data, size_t length) {
+    std::string encoded(4 * ((length + 2) / 3) + 1, '\0');
+    int written = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&encoded[0]), data, static_cast<int>(length));
+    encoded.resize(written > 0 ? static_cast<size_t>(written) : 0);
+    return encoded;
+}
+
+std::string openSSLError(const std::string& what) {
+    unsigned long code = ERR_get_error();
+    char text[256];
+    ERR_error_string_n(code, text, sizeof(text));
+    return what + (code ? ": " + std::string(text) : "");
+}
+#endif
+
+} // namespace
+
+EpollWebSocket::EpollWebSocket(Logger& log, const EpollWebSocketOptions& opts)
+    : logger(log), options(opts), use_tls(false), epoll_fd(-1), wake_fd(-1), socket_fd(-1),
+      ssl_context(nullptr), ssl(nullptr), receive_buffer(std::max<size_t>(opts.receive_buffer_bytes, 4096)),
+      buffer_begin(0), buffer_end(0), fragment_opcode(0), mask_state(std::random_device()() | 1),
+      close_code(0), requested_close_code(1000) {
+}
+
+EpollWebSocket::~EpollWebSocket() {
+    stop();
+#ifdef HFT_EPOLL_WEBSOCKET
+    if (ssl_context) {
+        SSL_CTX_free(ssl_context);
+    }
+#endif
+}
+
+bool EpollWebSocket::isAvailable() {
+#ifdef HFT_EPOLL_WEBSOCKET
+    return true;
+#else
+    return false;
+#endif
+}
+
+void EpollWebSocket::setUrl(const std::string& ws_url) {
+    std::string_view rest(ws_url);
+    bool tls;
+    if (rest.substr(0, 6) == "wss://") {
+        tls = true;
+        rest.remove_prefix(6);
+    } else if (rest.substr(0, 5) == "ws://") {
+        tls = false;
+        rest.remove_prefix(5);
+    } else {
+        throw std::invalid_argument("Not a WebSocket URL: " + ws_url);
+    }
+    
+    size_t slash = rest.find('/');
+    std::string_view authority = rest.substr(0, slash);
+    size_t colon = authority.rfind(':');
+    if (authority.empty() || colon == 0) {
+        throw std::invalid_argument("WebSocket URL has no host: " + ws_url);
+    }
+    
+    url = ws_url;
+    use_tls = tls;
+    host = std::string(authority.substr(0, colon));
+    port = colon != std::string_view::npos ? std::string(authority.substr(colon + 1)) : (tls ? "443" : "80");
+    path = slash != std::string_view::npos ? std::string(rest.substr(slash)) : "/";
+}
+
+void EpollWebSocket::start() {
+    if (running) return;
+    if (!isAvailable()) {
+        logger.error("Native WebSocket transport not available in this build (needs Linux and OpenSSL)");
+        return;
+    }
+    if (host.empty()) {
+        logger.error("Native WebSocket transport started without a URL");
+        return;
+    }
+
+#ifdef HFT_EPOLL_WEBSOCKET
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || wake_fd < 0) {
+        logger.error("Native WebSocket epoll/eventfd setup failed: " + std::string(std::strerror(errno)));
+        if (epoll_fd >= 0) ::close(epoll_fd);
+        if (wake_fd >= 0) ::close(wake_fd);
+        epoll_fd = wake_fd = -1;
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+    
+    // OpenSSL writes to the socket with write(), which raises SIGPIPE on a dropped connection
+    if (use_tls) {
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+    
+    running = true;
+    io_thread = std::thread(&EpollWebSocket::ioLoop, this);
+#endif
+}
+
+void EpollWebSocket::stop() {
+    if (!running) return;
+    
+    running = false;
+    wake();
+    if (io_thread.joinable()) {
+        io_thread.join();
+    }
+#ifdef HFT_EPOLL_WEBSOCKET
+    ::close(epoll_fd);
+    ::close(wake_fd);
+    epoll_fd = wake_fd = -1;
+#endif
+}
+
+void EpollWebSocket::wake() {
+#ifdef HFT_EPOLL_WEBSOCKET
+    uint64_t one = 1;
+    if (wake_fd >= 0 && write(wake_fd, &one, sizeof(one)) < 0) {
+        // Counter saturated means the I/O thread is already due to wake
+    }
+#endif
+}
+
+bool EpollWebSocket::send(std::string_view text) {
+    if (!open) return false;
+    if (std::this_thread::get_id() == io_thread_id) {
+        return sendFrame(TEXT, text.data(), text.size());
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        pending_sends.emplace_back(text);
+    }
+    wake();
+    return true;
+}
+
+void EpollWebSocket::close(uint16_t code, const std::string& reason) {
+    {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        requested_close_code = code;
+        requested_close_reason = reason;
+    }
+    close_requested = true;
+    wake();
+}
+
+std::string EpollWebSocket::acceptKey(const std::string& client_key) {
+#ifdef HFT_EPOLL_WEBSOCKET
+    std::string input = client_key + WEBSOCKET_GUID;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    return base64(digest, sizeof(digest));
+#else
+    (void)client_key;
+    return std::string();
+#endif
+}
+
+void EpollWebSocket::emit(WebSocketEventType type, std::string_view payload, uint16_t code, const std::string& reason) {
+    if (callback) {
+        callback(WebSocketEvent{type, payload, code, reason});
+    }
+}
+
+#ifdef HFT_EPOLL_WEBSOCKET
+
+void EpollWebSocket::ioLoop() {
+    AllocationScope scope(AllocationTag::RECEIVE);
+    io_thread_id = std::this_thread::get_id();
+    if (options.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(options.cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            logger.warning("Native WebSocket could not pin its thread to CPU " + std::to_string(options.cpu));
+        }
+    }
+    
+    while (running) {
+        auto deadline = std::chrono::steady_clock::now() + options.connect_timeout;
+        last_error.clear();
+        bool connected = connectSocket(deadline) && (!use_tls || startTLS(deadline)) && upgrade(deadline);
+        
+        if (connected) {
+            connections++;
+            close_code = 1006;
+            close_reason = "Connection lost";
+            close_requested = false;
+            {
+                std::lock_guard<std::mutex> lock(send_mutex);
+                pending_sends.clear();
+            }
+            logger.info("Native WebSocket connected to " + host + ":" + port + (use_tls ? " (TLS)" : "") +
+                       (options.busy_poll ? ", busy-polling" : ""));
+            open = true;
+            emit(WebSocketEventType::OPEN);
+            readLoop();
+            open = false;
+            emit(WebSocketEventType::CLOSE, std::string_view(), close_code, close_reason);
+        } else if (running) {
+            emit(WebSocketEventType::ERROR, std::string_view(), 0, last_error);
+        }
+        disconnect();
+        
+        // Reconnect after the delay unless stopped meanwhile
+        auto retry_at = std::chrono::steady_clock::now() + options.reconnect_delay;
+        while (running && std::chrono::steady_clock::now() < retry_at) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(retry_at - std::chrono::steady_clock::now());
+            epoll_event event;
+            if (epoll_wait(epoll_fd, &event, 1, static_cast<int>(remaining.count()) + 1) > 0) {
+                uint64_t count;
+                while (read(wake_fd, &count, sizeof(count)) > 0) {
+                }
+            }
+        }
+    }
+}
+
+bool EpollWebSocket::waitFor(short events, std::chrono::steady_clock::time_point deadline) {
+    while (running) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() < 0) return false;
+        
+        pollfd fds[2] = {{socket_fd, events, 0}, {wake_fd, POLLIN, 0}};
+        int ready = poll(fds, 2, static_cast<int>(remaining.count()) + 1);
+        if (ready < 0 && errno != EINTR) return false;
+        if (ready > 0 && fds[0].revents) return true;
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            // Sends and close requests are picked up by readLoop on every pass
+            uint64_t count;
+            while (read(wake_fd, &count, sizeof(count)) > 0) {
+            }
+        }
+    }
+    return false;
+}
+
+bool EpollWebSocket::connectSocket(std::chrono::steady_clock::time_point deadline) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    int resolved = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (resolved != 0) {
+        last_error = "Cannot resolve " + host + ": " + gai_strerror(resolved);
+        return false;
+    }
+    
+    for (addrinfo* address = addresses; address && socket_fd < 0; address = address->ai_next) {
+        socket_fd = socket(address->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (socket_fd < 0) continue;
+        
+        if (connect(socket_fd, address->ai_addr, address->ai_addrlen) == 0 ||
+            (errno == EINPROGRESS && waitFor(POLLOUT, deadline))) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error == 0) break;
+            last_error = "Connect to " + host + ":" + port + " failed: " + std::strerror(error);
+        } else {
+            last_error = "Connect to " + host + ":" + port + " failed: " + (errno == EINPROGRESS ? "timed out" : std::strerror(errno));
+        }
+        ::close(socket_fd);
+        socket_fd = -1;
+    }
+    freeaddrinfo(addresses);
+    if (socket_fd < 0) return false;
+    
+    int one = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (options.socket_receive_buffer > 0) {
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &options.socket_receive_buffer, sizeof(options.socket_receive_buffer));
+    }
+#ifdef SO_BUSY_POLL
+    if (options.socket_busy_poll_us > 0) {
+        setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &options.socket_busy_poll_us, sizeof(options.socket_busy_poll_us));
+    }
+#endif
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = socket_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_fd, &event);
+    return true;
+}
+
+bool EpollWebSocket::startTLS(std::chrono::steady_clock::time_point deadline) {
+    if (!ssl_context) {
+        ssl_context = SSL_CTX_new(TLS_client_method());
+        if (!ssl_context) {
+            last_error = openSSLError("SSL_CTX_new failed");
+            return false;
+        }
+        SSL_CTX_set_min_proto_version(ssl_context, TLS1_2_VERSION);
+        SSL_CTX_set_default_verify_paths(ssl_context);
+        SSL_CTX_set_verify(ssl_context, SSL_VERIFY_PEER, nullptr);
+    }
+    
+    ssl = SSL_new(ssl_context);
+    if (!ssl || SSL_set_fd(ssl, socket_fd) != 1) {
+        last_error = openSSLError("SSL setup failed");
+        return false;
+    }
+    SSL_set_tlsext_host_name(ssl, host.c_str());
+    SSL_set1_host(ssl, host.c_str());
+    
+    while (true) {
+        int result = SSL_connect(ssl);
+        if (result == 1) return true;
+        
+        int error = SSL_get_error(ssl, result);
+        short wanted = error == SSL_ERROR_WANT_READ ? POLLIN : error == SSL_ERROR_WANT_WRITE ? POLLOUT : 0;
+        if (wanted == 0) {
+            last_error = openSSLError("TLS handshake with " + host + " failed");
+            return false;
+        }
+        if (!waitFor(wanted, deadline)) {
+            last_error = "TLS handshake with " + host + " timed out";
+            return false;
+        }
+    }
+}
+
+bool EpollWebSocket::upgrade(std::chrono::steady_clock::time_point deadline) {
+    unsigned char nonce[16];
+    RAND_bytes(nonce, sizeof(nonce));
+    std::string key = base64(nonce, sizeof(nonce));
+    bool default_port = port == (use_tls ? "443" : "80");
+    std::string request = "GET " + path + " HTTP/1.1\r\n"
+                          "Host: " + host + (default_port ? "" : ":" + port) + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + key + "\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!writeAll(request.data(), request.size())) {
+        last_error = "Sending the upgrade request failed";
+        return false;
+    }
+    
+    buffer_begin = buffer_end = 0;
+    while (true) {
+        std::string_view received(receive_buffer.data(), buffer_end);
+        size_t headers_end = received.find("\r\n\r\n");
+        if (headers_end != std::string_view::npos) {
+            std::string_view response = received.substr(0, headers_end + 2);
+            std::string_view status = response.substr(0, response.find("\r\n"));
+            if (status.substr(0, 13) != "HTTP/1.1 101 " && status != "HTTP/1.1 101") {
+                last_error = "Upgrade rejected: " + std::string(status);
+                return false;
+            }
+            if (findHeader(response, "sec-websocket-accept") != acceptKey(key)) {
+                last_error = "Upgrade response has a wrong Sec-WebSocket-Accept";
+                return false;
+            }
+            // Anything after the headers is already frame data
+            buffer_begin = headers_end + 4;
+            return true;
+        }
+        if (buffer_end == receive_buffer.size()) {
+            last_error = "Upgrade response headers too large";
+            return false;
+        }
+        
+        long count = readSome(receive_buffer.data() + buffer_end, receive_buffer.size() - buffer_end);
+        if (count > 0) {
+            buffer_end += static_cast<size_t>(count);
+        } else if (count == READ_WOULD_BLOCK) {
+            if (!waitFor(POLLIN, deadline)) {
+                last_error = "Upgrade response timed out";
+                return false;
+            }
+        } else {
+            last_error = count == READ_CLOSED ? "Connection closed during upgrade" : "Read failed during upgrade";
+            return false;
+        }
+    }
+}
+
+long EpollWebSocket::readSome(char* data, size_t length) {
+    if (ssl) {
+        int count = SSL_read(ssl, data, static_cast<int>(std::min<size_t>(length, 1 << 30)));
+        if (count > 0) return count;
+        
+        int error = SSL_get_error(ssl, count);
+        if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) return READ_WOULD_BLOCK;
+        if (error == SSL_ERROR_ZERO_RETURN) return READ_CLOSED;
+        last_error = openSSLError("TLS read failed");
+        return READ_FAILED;
+    }
+    
+    ssize_t count = recv(socket_fd, data, length, 0);
+    if (count > 0) return static_cast<long>(count);
+    if (count == 0) return READ_CLOSED;
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return READ_WOULD_BLOCK;
+    last_error = "Read failed: " + std::string(std::strerror(errno));
+    return READ_FAILED;
+}
+
+bool EpollWebSocket::writeAll(const char* data, size_t length) {
+    auto deadline = std::chrono::steady_clock::now() + options.connect_timeout;
+    while (length > 0) {
+        short wanted;
+        if (ssl) {
+            int count = SSL_write(ssl, data, static_cast<int>(std::min<size_t>(length, 1 << 30)));
+            if (count > 0) {
+                data += count;
+                length -= static_cast<size_t>(count);
+                continue;
+            }
+            int error = SSL_get_error(ssl, count);
+            if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) {
+                last_error = openSSLError("TLS write failed");
+                return false;
+            }
+            wanted = error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+        } else {
+            ssize_t count = ::send(socket_fd, data, length, MSG_NOSIGNAL);
+            if (count > 0) {
+                data += count;
+                length -= static_cast<size_t>(count);
+                continue;
+            }
+            if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                last_error = "Write failed: " + std::string(std::strerror(errno));
+                return false;
+            }
+            wanted = POLLOUT;
+        }
+        if (!waitFor(wanted, deadline)) {
+            last_error = "Write timed out";
+            return false;
+        }
+    }
+    return true;
+}
+
+void EpollWebSocket::readLoop() {
+    // Frames may have arrived together with the upgrade response
+    if (buffer_begin < buffer_end && !parseFrames()) return;
+    
+    epoll_event events[4];
+    while (running) {
+        int timeout_ms = options.busy_poll ? 0 : 100;
+        int ready = epoll_wait(epoll_fd, events, 4, timeout_ms);
+        bool readable = options.busy_poll;
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == wake_fd) {
+                uint64_t count;
+                while (read(wake_fd, &count, sizeof(count)) > 0) {
+                }
+            } else {
+                readable = true;
+            }
+        }
+        
+        if (close_requested.exchange(false)) {
+            std::string payload(2, '\0');
+            {
+                std::lock_guard<std::mutex> lock(send_mutex);
+                close_code = requested_close_code;
+                close_reason = requested_close_reason;
+            }
+            payload[0] = static_cast<char>(close_code >> 8);
+            payload[1] = static_cast<char>(close_code & 0xFF);
+            payload += close_reason.substr(0, 123);
+            sendFrame(CLOSE, payload.data(), payload.size());
+            return;
+        }
+        if (!flushPendingSends()) return;
+        if (readable && !fillBuffer()) return;
+    }
+}
+
+bool EpollWebSocket::fillBuffer() {
+    while (true) {
+        if (buffer_begin == buffer_end) {
+            buffer_begin = buffer_end = 0;
+        }
+        if (buffer_end == receive_buffer.size()) {
+            // Keep only the partial frame at the tail; parseFrames grows the
+            // buffer up front for frames larger than it
+            if (buffer_begin > 0) {
+                std::memmove(receive_buffer.data(), receive_buffer.data() + buffer_begin, buffer_end - buffer_begin);
+                buffer_end -= buffer_begin;
+                buffer_begin = 0;
+            } else {
+                receive_buffer.resize(receive_buffer.size() * 2);
+            }
+        }
+        
+        long count = readSome(receive_buffer.data() + buffer_end, receive_buffer.size() - buffer_end);
+        if (count > 0) {
+            bytes_received += static_cast<size_t>(count);
+            buffer_end += static_cast<size_t>(count);
+            if (!parseFrames()) return false;
+            continue;
+        }
+        if (count == READ_WOULD_BLOCK) return true;
+        
+        close_code = 1006;
+        close_reason = count == READ_CLOSED ? "Connection closed by peer" : last_error;
+        return false;
+    }
+}
+
+bool EpollWebSocket::parseFrames() {
+    while (buffer_end - buffer_begin >= 2) {
+        const unsigned char* frame = reinterpret_cast<const unsigned char*>(receive_buffer.data() + buffer_begin);
+        size_t available = buffer_end - buffer_begin;
+        bool final_frame = (frame[0] & 0x80) != 0;
+        uint8_t opcode = frame[0] & 0x0F;
+        size_t header = 2;
+        uint64_t length = frame[1] & 0x7F;
+        if (length == 126) {
+            header = 4;
+            if (available < header) break;
+            length = readBigEndian(frame + 2, 2);
+        } else if (length == 127) {
+            header = 10;
+            if (available < header) break;
+            length = readBigEndian(frame + 2, 8);
+        }
+        
+        // Servers never mask (RFC 6455 5.1); an oversized frame would exhaust memory
+        if ((frame[1] & 0x80) != 0 || length > MAX_FRAME_BYTES || (frame[0] & 0x70) != 0) {
+            close_code = 1002;
+            close_reason = (frame[1] & 0x80) ? "Masked frame from server" :
+                           length > MAX_FRAME_BYTES ? "Frame too large" : "Unexpected reserved bits";
+            const char code[2] = {static_cast<char>(1002 >> 8), static_cast<char>(1002 & 0xFF)};
+            sendFrame(CLOSE, code, sizeof(code));
+            return false;
+        }
+        
+        size_t frame_size = header + static_cast<size_t>(length);
+        if (available < frame_size) {
+            if (frame_size > receive_buffer.size() - buffer_begin) {
+                std::memmove(receive_buffer.data(), receive_buffer.data() + buffer_begin, available);
+                buffer_begin = 0;
+                buffer_end = available;
+                if (frame_size > receive_buffer.size()) {
+                    receive_buffer.resize(std::max(frame_size, receive_buffer.size() * 2));
+                }
+            }
+            break;
+        }
+        
+        const char* payload = receive_buffer.data() + buffer_begin + header;
+        size_t payload_length = static_cast<size_t>(length);
+        buffer_begin += frame_size;
+        
+        switch (opcode) {
+            case TEXT:
+            case BINARY:
+                if (final_frame && fragments.empty()) {
+                    messages_received++;
+                    emit(WebSocketEventType::MESSAGE, std::string_view(payload, payload_length));
+                } else {
+                    fragments.assign(payload, payload_length);
+                    fragment_opcode = opcode;
+                }
+                break;
+            
+            case CONTINUATION:
+                fragments.append(payload, payload_length);
+                if (final_frame && fragment_opcode != 0) {
+                    messages_received++;
+                    emit(WebSocketEventType::MESSAGE, std::string_view(fragments));
+                    fragments.clear();
+                    fragment_opcode = 0;
+                }
+                break;
+            
+            case PING:
+                if (!sendFrame(PONG, payload, payload_length)) return false;
+                break;
+            
+            case PONG:
+                break;
+            
+            case CLOSE:
+                close_code = payload_length >= 2 ?
+                    static_cast<uint16_t>(readBigEndian(reinterpret_cast<const unsigned char*>(payload), 2)) : 1005;
+                close_reason.assign(payload_length > 2 ? payload + 2 : payload, payload_length > 2 ? payload_length - 2 : 0);
+                sendFrame(CLOSE, payload, std::min<size_t>(payload_length, 2));
+                return false;
+            
+            default:
+                close_code = 1002;
+                close_reason = "Unknown opcode " + std::to_string(opcode);
+                return false;
+        }
+    }
+    
+    if (buffer_begin == buffer_end) {
+        buffer_begin = buffer_end = 0;
+    }
+    return true;
+}
+
+bool EpollWebSocket::sendFrame(uint8_t opcode, const char* payload, size_t length) {
+    unsigned char header[14];
+    size_t header_length = 2;
+    header[0] = static_cast<unsigned char>(0x80 | opcode);
+    if (length < 126) {
+        header[1] = static_cast<unsigned char>(0x80 | length);
+    } else if (length <= 0xFFFF) {
+        header[1] = 0x80 | 126;
+        header[2] = static_cast<unsigned char>(length >> 8);
+        header[3] = static_cast<unsigned char>(length & 0xFF);
+        header_length = 4;
+    } else {
+        header[1] = 0x80 | 127;
+        for (int i = 0; i < 8; ++i) {
+            header[2 + i] = static_cast<unsigned char>((static_cast<uint64_t>(length) >> (56 - 8 * i)) & 0xFF);
+        }
+        header_length = 10;
+    }
+    
+    // Clients mask every frame; the key only has to be unpredictable to intermediaries
+    mask_state ^= mask_state << 13;
+    mask_state ^= mask_state >> 17;
+    mask_state ^= mask_state << 5;
+    unsigned char mask[4];
+    std::memcpy(mask, &mask_state, sizeof(mask));
+    std::memcpy(header + header_length, mask, sizeof(mask));
+    header_length += sizeof(mask);
+    
+    frame_buffer.resize(header_length + length);
+    std::memcpy(frame_buffer.data(), header, header_length);
+    char* masked = frame_buffer.data() + header_length;
+    for (size_t i = 0; i < length; ++i) {
+        masked[i] = static_cast<char>(payload[i] ^ mask[i & 3]);
+    }
+    return writeAll(frame_buffer.data(), frame_buffer.size());
+}
+
+bool EpollWebSocket::flushPendingSends() {
+    std::vector<std::string> sends;
+    {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        if (pending_sends.empty()) return true;
+        sends.swap(pending_sends);
+    }
+    for (const auto& text : sends) {
+        if (!sendFrame(TEXT, text.data(), text.size())) return false;
+    }
+    return true;
+}
+
+void EpollWebSocket::disconnect() {
+    if (ssl) {
+        SSL_free(ssl);
+        ssl = nullptr;
+    }
+    if (socket_fd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket_fd, nullptr);
+        ::close(socket_fd);
+        socket_fd = -1;
+    }
+    buffer_begin = buffer_end = 0;
+    fragments.clear();
+    fragment_opcode = 0;
+}
+
+#else
+
+void EpollWebSocket::ioLoop() {}
+bool EpollWebSocket::connectSocket(std::chrono::steady_clock::time_point) { return false; }
+bool EpollWebSocket::startTLS(std::chrono::steady_clock::time_point) { return false; }
+bool EpollWebSocket::upgrade(std::chrono::steady_clock::time_point) { return false; }
+void EpollWebSocket::readLoop() {}
+void EpollWebSocket::disconnect() {}
+bool EpollWebSocket::waitFor(short, std::chrono::steady_clock::time_point) { return false; }
+long EpollWebSocket::readSome(char*, size_t) { return READ_FAILED; }
+bool EpollWebSocket::writeAll(const char*, size_t) { return false; }
+bool EpollWebSocket::fillBuffer() { return false; }
+bool EpollWebSocket::parseFrames() { return false; }
+bool EpollWebSocket::sendFrame(uint8_t, const char*, size_t) { return false; }
+bool EpollWebSocket::flushPendingSends() { return false; }
+
+#endif
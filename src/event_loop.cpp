@@ -0,0 +1,187 @@
+#include "event_loop.h"
+
+#ifdef HFT_COROUTINES
+#include <exception>
+#include <stdexcept>
+
+void Task::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    EventLoop* owner = handle.promise().loop;
+    handle.destroy();
+    owner->taskFinished();
+}
+
+void Task::promise_type::unhandled_exception() {
+    try {
+        throw;
+    } catch (const std::exception& e) {
+        loop->taskFailed(e.what());
+    } catch (...) {
+        loop->taskFailed("unknown exception");
+    }
+}
+
+EventLoop::EventLoop(Logger& log, const std::string& loop_name, const EventLoopOptions& opts)
+    : logger(log), name(loop_name), options(opts), sleeping(false), timer_order(0) {
+    // Spinning only pays when another core can post meanwhile
+    if (std::thread::hardware_concurrency() < 2) {
+        options.idle_spin = std::chrono::microseconds(0);
+    }
+}
+
+EventLoop::~EventLoop() {
+    stop();
+}
+
+void EventLoop::start() {
+    if (thread.joinable()) return;
+    stopping = false;
+    thread = std::thread(&EventLoop::run, this);
+}
+
+void EventLoop::stop() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        has_posted = true;
+        wakeup.notify_one();
+    }
+    thread.join();
+    
+    size_t unfinished = active_tasks;
+    if (unfinished > 0) {
+        logger.warning("Event loop " + name + " stopped with " + std::to_string(unfinished) + " task(s) suspended");
+    }
+}
+
+void EventLoop::spawn(Task task) {
+    std::coroutine_handle<Task::promise_type> handle = task.handle;
+    task.handle = nullptr;
+    handle.promise().loop = this;
+    active_tasks++;
+    post(handle);
+}
+
+void EventLoop::post(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    posted.push_back(handle);
+    has_posted.store(true, std::memory_order_release);
+    if (sleeping) {
+        wakeup.notify_one();
+    }
+}
+
+void EventLoop::addTimer(Clock::time_point deadline, std::coroutine_handle<> handle) {
+    if (!onLoopThread()) {
+        throw std::logic_error("EventLoop " + name + ": timers can only be awaited on the loop thread");
+    }
+    timers.push(Timer{deadline, timer_order++, handle});
+}
+
+void EventLoop::run() {
+    thread_id = std::this_thread::get_id();
+    while (true) {
+        if (takePosted()) {
+            for (auto handle : runnable) {
+                resumptions.fetch_add(1, std::memory_order_relaxed);
+                handle.resume();
+            }
+            runnable.clear();
+        }
+        
+        bool stop_requested = stopping.load(std::memory_order_acquire);
+        fireTimers(stop_requested ? Clock::time_point::max() : Clock::now());
+        
+        // Once stopping, a task still suspended waits on something that will not come
+        if (stop_requested && timers.empty() && !has_posted.load(std::memory_order_acquire)) {
+            break;
+        }
+        idle();
+    }
+}
+
+bool EventLoop::takePosted() {
+    if (!has_posted.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    // Swapped, not copied: both vectors keep their capacity
+    runnable.swap(posted);
+    has_posted.store(false, std::memory_order_relaxed);
+    return !runnable.empty();
+}
+
+void EventLoop::fireTimers(Clock::time_point now) {
+    // A resumed coroutine that sleeps again lands in the heap, not in this batch
+    while (!timers.empty() && timers.top().deadline <= now) {
+        runnable.push_back(timers.top().handle);
+        timers.pop();
+    }
+    timers_fired.fetch_add(runnable.size(), std::memory_order_relaxed);
+    for (auto handle : runnable) {
+        resumptions.fetch_add(1, std::memory_order_relaxed);
+        handle.resume();
+    }
+    runnable.clear();
+}
+
+void EventLoop::idle() {
+    if (has_posted.load(std::memory_order_acquire)) return;
+    Clock::time_point now = Clock::now();
+    if (!timers.empty() && timers.top().deadline <= now) return;
+    
+    // Poll briefly first: under a steady feed the next post is usually this close
+    if (options.idle_spin.count() > 0) {
+        Clock::time_point spin_until = now + options.idle_spin;
+        if (!timers.empty() && timers.top().deadline < spin_until) {
+            spin_until = timers.top().deadline;
+        }
+        while (!has_posted.load(std::memory_order_acquire)) {
+            now = Clock::now();
+            if (now >= spin_until) break;
+        }
+        if (has_posted.load(std::memory_order_acquire) || (!timers.empty() && timers.top().deadline <= now)) {
+            return;
+        }
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    sleeping = true;
+    sleeps.fetch_add(1, std::memory_order_relaxed);
+    auto ready = [this] { return has_posted.load(std::memory_order_relaxed); };
+    if (timers.empty()) {
+        wakeup.wait(lock, ready);
+    } else {
+        wakeup.wait_until(lock, timers.top().deadline, ready);
+    }
+    sleeping = false;
+}
+
+void EventLoop::taskFinished() {
+    active_tasks--;
+}
+
+void EventLoop::taskFailed(const char* what) {
+    logger.error("Task on event loop " + name + " failed: " + what);
+}
+
+EventLoopPool::EventLoopPool(Logger& log, size_t threads, const std::string& name, const EventLoopOptions& opts) {
+    if (threads == 0) {
+        throw std::invalid_argument("EventLoopPool needs at least one thread");
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        loops.push_back(std::make_unique<EventLoop>(log, name + "-" + std::to_string(i), opts));
+    }
+}
+
+void EventLoopPool::start() {
+    for (auto& loop : loops) {
+        loop->start();
+    }
+}
+
+void EventLoopPool::stop() {
+    for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+        (*it)->stop();
+    }
+}
+
+#endif // HFT_COROUTINES
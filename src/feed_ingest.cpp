@@ -0,0 +1,487 @@
+#include "feed_ingest.h"
+#include "json_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifdef HFT_HAVE_SIMDJSON
+#include <simdjson.h>
+#endif
+
+namespace {
+
+// Byte ranges larger than this are split further, so a few big inputs still
+// spread evenly over the threads
+const size_t MAX_CHUNK_BYTES = 64u << 20;
+
+template <typename Work>
+void runParallel(size_t threads, Work work) {
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The live client drops these before they reach the parser
+bool isControlMessage(std::string_view line) {
+    return line.find("\"type\":\"heartbeat\"") != std::string_view::npos ||
+           line.find("\"type\":\"subscriptions\"") != std::string_view::npos;
+}
+
+#ifdef HFT_HAVE_SIMDJSON
+
+enum class SIMDResult {
+    TICK,
+    SKIPPED,
+    FALLBACK
+};
+
+struct SIMDFields {
+    std::string_view type;
+    std::string_view product_id;
+    std::string_view time;
+    double price = 0.0;
+    double best_bid = 0.0;
+    double best_ask = 0.0;
+    uint64_t exchange_sequence = 0;
+    bool has_type = false;
+    bool has_product_id = false;
+    bool has_price = false;
+    bool has_best_bid = false;
+    bool has_best_ask = false;
+};
+
+std::string_view trimTrailing(std::string_view token) {
+    while (!token.empty() && (token.back() == ' ' || token.back() == '\t' || token.back() == '\n' || token.back() == '\r')) {
+        token.remove_suffix(1);
+    }
+    return token;
+}
+
+bool readString(simdjson::ondemand::value& value, std::string_view& out) {
+    simdjson::ondemand::json_type type;
+    if (value.type().get(type) || type != simdjson::ondemand::json_type::string) {
+        return false;
+    }
+    return !value.get_string().get(out);
+}
+
+// JSONParser::parsePrice: strings and numbers are read, anything else is 0. Text
+// from_chars does not take whole is left to JSONParser (std::stod rules).
+bool readPrice(simdjson::ondemand::value& value, double& out) {
+    simdjson::ondemand::json_type type;
+    if (value.type().get(type)) {
+        return false;
+    }
+    std::string_view text;
+    switch (type) {
+        case simdjson::ondemand::json_type::string:
+            if (value.get_string().get(text)) return false;
+            break;
+        case simdjson::ondemand::json_type::number:
+            text = trimTrailing(value.raw_json_token());
+            break;
+        default:
+            out = 0.0;
+            return true;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// JSONParser::parseSequence: unsigned integers only, anything else is 0
+uint64_t readSequence(simdjson::ondemand::value& value) {
+    simdjson::ondemand::json_type type;
+    if (value.type().get(type) || type != simdjson::ondemand::json_type::number) {
+        return 0;
+    }
+    std::string_view text = trimTrailing(value.raw_json_token());
+    uint64_t sequence = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), sequence);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() ? sequence : 0;
+}
+
+// Reads the fields JSONParser uses in one pass over the object; a repeated key
+// replaces the earlier value, as it does in nlohmann and the scanner
+SIMDResult parseSIMD(simdjson::ondemand::parser& parser, simdjson::padded_string_view input, SIMDFields& fields) {
+    fields = SIMDFields();
+    simdjson::ondemand::document doc;
+    simdjson::ondemand::object object;
+    if (parser.iterate(input).get(doc) || doc.get_object().get(object)) {
+        return SIMDResult::FALLBACK;
+    }
+    
+    for (auto result : object) {
+        simdjson::ondemand::field field;
+        if (std::move(result).get(field)) {
+            return SIMDResult::FALLBACK;
+        }
+        std::string_view key = field.escaped_key();
+        if (key.find('\\') != std::string_view::npos) {
+            return SIMDResult::FALLBACK;
+        }
+        simdjson::ondemand::value value = field.value();
+        
+        if (key == "type") {
+            if (!readString(value, fields.type)) return SIMDResult::FALLBACK;
+            fields.has_type = true;
+        } else if (key == "product_id") {
+            if (!readString(value, fields.product_id)) return SIMDResult::FALLBACK;
+            fields.has_product_id = true;
+        } else if (key == "time") {
+            if (!readString(value, fields.time)) return SIMDResult::FALLBACK;
+        } else if (key == "price") {
+            if (!readPrice(value, fields.price)) return SIMDResult::FALLBACK;
+            fields.has_price = true;
+        } else if (key == "best_bid") {
+            if (!readPrice(value, fields.best_bid)) return SIMDResult::FALLBACK;
+            fields.has_best_bid = true;
+        } else if (key == "best_ask") {
+            if (!readPrice(value, fields.best_ask)) return SIMDResult::FALLBACK;
+            fields.has_best_ask = true;
+        } else if (key == "sequence") {
+            fields.exchange_sequence = readSequence(value);
+        }
+    }
+    if (!doc.at_end()) {
+        return SIMDResult::FALLBACK;
+    }
+    
+    if (!fields.has_type) {
+        return SIMDResult::FALLBACK;
+    }
+    if (fields.type != "ticker") {
+        return SIMDResult::SKIPPED;
+    }
+    if (!fields.has_product_id || !fields.has_price || !fields.has_best_bid || !fields.has_best_ask) {
+        return SIMDResult::FALLBACK;
+    }
+    return SIMDResult::TICK;
+}
+
+#endif
+
+} // namespace
+
+struct FeedIngest::Chunk {
+    std::string_view text;
+    const char* readable_end;       // end of the input; bytes up to here may be read as padding
+    uint32_t index;
+    std::vector<Tick> ticks;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::string times;
+    size_t lines = 0;
+    size_t skipped = 0;
+    size_t malformed = 0;
+    size_t fallbacks = 0;
+    
+    void add(std::string_view product_id, std::string_view time, double price, double best_bid, double best_ask,
+             uint64_t exchange_sequence) {
+        uint32_t product;
+        if (!ticks.empty() && names[ticks.back().product] == product_id) {
+            product = ticks.back().product;
+        } else {
+            auto id = ids.find(std::string(product_id));
+            if (id == ids.end()) {
+                id = ids.emplace(std::string(product_id), static_cast<uint32_t>(names.size())).first;
+                names.emplace_back(product_id);
+            }
+            product = id->second;
+        }
+        
+        Tick tick;
+        tick.product = product;
+        tick.chunk = index;
+        tick.time_offset = static_cast<uint32_t>(times.size());
+        tick.time_length = static_cast<uint32_t>(time.size());
+        tick.price = price;
+        tick.best_bid = best_bid;
+        tick.best_ask = best_ask;
+        tick.exchange_sequence = exchange_sequence;
+        times.append(time.data(), time.size());
+        ticks.push_back(tick);
+    }
+};
+
+FeedIngest::FeedIngest(Logger& log, const FeedIngestOptions& ingest_options) : logger(log), options(ingest_options) {
+    if (options.threads == 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+}
+
+FeedIngest::~FeedIngest() = default;
+
+void FeedIngest::addInput(const std::string& path) {
+    inputs.push_back(std::make_unique<MappedFile>(path));
+}
+
+bool FeedIngest::simdAvailable() {
+#ifdef HFT_HAVE_SIMDJSON
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FeedIngest::parseChunk(Chunk& chunk) const {
+    JSONParser json_parser(logger);
+    TickerData scratch;
+    chunk.ticks.reserve(chunk.text.size() / 400);
+    
+    auto parseWithJSONParser = [&](std::string_view line) {
+        if (isControlMessage(line)) {
+            chunk.skipped++;
+            return;
+        }
+        // Another message type counts as skipped, as it does on the simdjson path
+        try {
+            json_parser.parseTickerMessageQuietly(line, scratch);
+        } catch (const NotATickerError&) {
+            chunk.skipped++;
+            return;
+        } catch (const std::exception&) {
+            chunk.malformed++;
+            return;
+        }
+        chunk.add(scratch.product_id, scratch.time, scratch.price, scratch.best_bid, scratch.best_ask,
+                  scratch.exchange_sequence);
+    };
+
+#ifdef HFT_HAVE_SIMDJSON
+    simdjson::ondemand::parser simd_parser;
+    SIMDFields fields;
+    std::string padded;
+#endif
+
+    const char* cursor = chunk.text.data();
+    const char* end = chunk.text.data() + chunk.text.size();
+    while (cursor < end) {
+        const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+        const char* line_end = newline ? newline : end;
+        std::string_view line(cursor, line_end - cursor);
+        cursor = newline ? newline + 1 : end;
+        
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        chunk.lines++;
+
+#ifdef HFT_HAVE_SIMDJSON
+        // Parse in place when the mapping has room for simdjson's read-ahead;
+        // only lines at the very end of an input are copied
+        simdjson::padded_string_view input;
+        if (static_cast<size_t>(chunk.readable_end - (line.data() + line.size())) >= simdjson::SIMDJSON_PADDING) {
+            input = simdjson::padded_string_view(line.data(), line.size(), line.size() + simdjson::SIMDJSON_PADDING);
+        } else {
+            padded.assign(line.data(), line.size());
+            padded.resize(line.size() + simdjson::SIMDJSON_PADDING, ' ');
+            input = simdjson::padded_string_view(padded.data(), line.size(), padded.size());
+        }
+        
+        switch (parseSIMD(simd_parser, input, fields)) {
+            case SIMDResult::TICK:
+                chunk.add(fields.product_id, fields.time, fields.price, fields.best_bid, fields.best_ask,
+                          fields.exchange_sequence);
+                break;
+            case SIMDResult::SKIPPED:
+                chunk.skipped++;
+                break;
+            case SIMDResult::FALLBACK:
+                chunk.fallbacks++;
+                parseWithJSONParser(line);
+                break;
+        }
+#else
+        parseWithJSONParser(line);
+#endif
+    }
+}
+
+const FeedIngestStats& FeedIngest::run() {
+    stats = FeedIngestStats();
+    stats.threads = options.threads;
+    stats.simd = simdAvailable();
+    products.clear();
+    time_arenas.clear();
+    ticks.clear();
+    
+    // Parse: split every input at line boundaries into byte ranges
+    auto parse_start = std::chrono::steady_clock::now();
+    std::vector<Chunk> chunks;
+    for (const auto& input : inputs) {
+        std::string_view text = input->view();
+        stats.bytes += text.size();
+        size_t pieces = std::max(options.threads, (text.size() + MAX_CHUNK_BYTES - 1) / MAX_CHUNK_BYTES);
+        size_t begin = 0;
+        for (size_t p = 0; p < pieces && begin < text.size(); ++p) {
+            size_t end = (p + 1 == pieces) ? text.size() : std::max(begin, text.size() * (p + 1) / pieces);
+            size_t newline = text.find('\n', end);
+            end = (newline == std::string_view::npos || p + 1 == pieces) ? text.size() : newline + 1;
+            chunks.emplace_back();
+            chunks.back().text = text.substr(begin, end - begin);
+            chunks.back().readable_end = text.data() + text.size();
+            chunks.back().index = static_cast<uint32_t>(chunks.size() - 1);
+            begin = end;
+        }
+    }
+    
+    std::atomic<size_t> next_chunk{0};
+    runParallel(std::min(options.threads, std::max<size_t>(chunks.size(), 1)), [&](size_t) {
+        for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+            parseChunk(chunks[c]);
+        }
+    });
+    stats.parse_seconds = secondsSince(parse_start);
+    
+    auto merge_start = std::chrono::steady_clock::now();
+    mergeChunks(chunks);
+    if (options.reorder) {
+        orderBySequence();
+    }
+    stats.ticks = ticks.size();
+    stats.products = products.size();
+    stats.merge_seconds = secondsSince(merge_start);
+    
+    if (stats.malformed > 0) {
+        logger.warning("Feed ingest skipped " + std::to_string(stats.malformed) + " malformed lines");
+    }
+    return stats;
+}
+
+void FeedIngest::mergeChunks(std::vector<Chunk>& chunks) {
+    // Chunk-local product ids become global ones; chunks are joined in file order
+    std::unordered_map<std::string, uint32_t> global_ids;
+    size_t total_ticks = 0;
+    for (const auto& chunk : chunks) {
+        total_ticks += chunk.ticks.size();
+    }
+    ticks.reserve(total_ticks);
+    time_arenas.resize(chunks.size());
+    
+    for (auto& chunk : chunks) {
+        std::vector<uint32_t> remap(chunk.names.size());
+        for (size_t i = 0; i < chunk.names.size(); ++i) {
+            auto id = global_ids.find(chunk.names[i]);
+            if (id == global_ids.end()) {
+                id = global_ids.emplace(chunk.names[i], static_cast<uint32_t>(products.size())).first;
+                products.push_back(chunk.names[i]);
+            }
+            remap[i] = id->second;
+        }
+        for (Tick tick : chunk.ticks) {
+            tick.product = remap[tick.product];
+            ticks.push_back(tick);
+        }
+        time_arenas[chunk.index] = std::move(chunk.times);
+        stats.lines += chunk.lines;
+        stats.skipped += chunk.skipped;
+        stats.malformed += chunk.malformed;
+        stats.fallbacks += chunk.fallbacks;
+        chunk.ticks = std::vector<Tick>();
+    }
+}
+
+void FeedIngest::orderBySequence() {
+    // Group tick positions by product; each product is then sorted on its own
+    // positions, so the interleaving of products stays as recorded
+    std::vector<size_t> offsets(products.size() + 1, 0);
+    for (const auto& tick : ticks) {
+        offsets[tick.product + 1]++;
+    }
+    for (size_t p = 1; p < offsets.size(); ++p) {
+        offsets[p] += offsets[p - 1];
+    }
+    std::vector<size_t> positions(ticks.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < ticks.size(); ++i) {
+        positions[fill[ticks[i].product]++] = i;
+    }
+    
+    std::vector<uint8_t> dropped(ticks.size(), 0);
+    std::atomic<size_t> next_product{0};
+    std::atomic<size_t> duplicates{0};
+    std::atomic<size_t> reordered{0};
+    runParallel(std::min(options.threads, std::max<size_t>(products.size(), 1)), [&](size_t) {
+        std::vector<size_t> slots;
+        std::vector<Tick> sorted;
+        for (size_t product = next_product++; product < products.size(); product = next_product++) {
+            // Ticks without a sequence number keep their place
+            slots.clear();
+            sorted.clear();
+            for (size_t i = offsets[product]; i < offsets[product + 1]; ++i) {
+                if (ticks[positions[i]].exchange_sequence != 0) {
+                    slots.push_back(positions[i]);
+                    sorted.push_back(ticks[positions[i]]);
+                }
+            }
+            std::stable_sort(sorted.begin(), sorted.end(), [](const Tick& a, const Tick& b) {
+                return a.exchange_sequence < b.exchange_sequence;
+            });
+            auto last = std::unique(sorted.begin(), sorted.end(), [](const Tick& a, const Tick& b) {
+                return a.exchange_sequence == b.exchange_sequence;
+            });
+            size_t kept = last - sorted.begin();
+            
+            size_t moved = 0;
+            for (size_t s = 0; s < slots.size(); ++s) {
+                if (s < kept) {
+                    moved += ticks[slots[s]].exchange_sequence != sorted[s].exchange_sequence;
+                    ticks[slots[s]] = sorted[s];
+                } else {
+                    dropped[slots[s]] = 1;
+                }
+            }
+            duplicates += slots.size() - kept;
+            reordered += moved;
+        }
+    });
+    stats.duplicates = duplicates;
+    stats.reordered = reordered;
+    
+    if (stats.duplicates > 0) {
+        size_t out = 0;
+        for (size_t i = 0; i < ticks.size(); ++i) {
+            if (!dropped[i]) {
+                ticks[out++] = ticks[i];
+            }
+        }
+        ticks.resize(out);
+    }
+}
+
+void FeedIngest::getTick(size_t index, TickerData& ticker) const {
+    const Tick& tick = ticks[index];
+    const std::string& arena = time_arenas[tick.chunk];
+    
+    // Only "ticker" messages become ticks
+    ticker.type.assign("ticker");
+    ticker.product_id = products[tick.product];
+    ticker.price = tick.price;
+    ticker.best_bid = tick.best_bid;
+    ticker.best_ask = tick.best_ask;
+    ticker.time.assign(arena.data() + tick.time_offset, tick.time_length);
+    ticker.exchange_sequence = tick.exchange_sequence;
+    ticker.timestamp = std::chrono::system_clock::now();
+    ticker.price_ema = 0.0;
+    ticker.mid_price_ema = 0.0;
+    ticker.sequence_number = 0;
+    
+    ticker.calculateMidPrice();
+}
@@ -0,0 +1,258 @@
+#include "feed_watchdog.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Slots in the timer wheel. Deadlines further out than one rotation are
+// re-filed when their slot comes round, so this only bounds wasted visits.
+const size_t WHEEL_SLOTS = 512;
+
+std::string formatSeconds(int64_t ns) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f s", static_cast<double>(ns) / 1e9);
+    return text;
+}
+
+} // namespace
+
+FeedWatchdog::FeedWatchdog(Logger& log, const WatchdogOptions& watchdog_options)
+    : logger(log), options(watchdog_options),
+      resolution_ns(std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(
+          watchdog_options.resolution).count())),
+      last_index(0), wheel(WHEEL_SLOTS), wheel_time_ns(0), running(false),
+      reconnects_metric(MetricsRegistry::global().counter("hft_feed_reconnects_requested_total",
+          "Reconnects requested by the feed watchdog after missed heartbeats")) {
+}
+
+FeedWatchdog::~FeedWatchdog() {
+    stop();
+}
+
+size_t FeedWatchdog::addWatch(const std::string& name, WatchKind kind, std::chrono::milliseconds threshold) {
+    for (size_t i = 0; i < watches.size(); ++i) {
+        if (watches[i].kind == kind && watches[i].name == name) {
+            return i;
+        }
+    }
+    
+    watches.emplace_back(name, kind, std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count());
+    Watch& watch = watches.back();
+    MetricsRegistry& registry = MetricsRegistry::global();
+    if (kind == WatchKind::PRODUCT) {
+        std::string labels = "product=\"" + name + "\"";
+        watch.stale_gauge = &registry.gauge("hft_feed_stale", "1 while a product has not updated within its threshold", labels);
+        watch.alerts_metric = &registry.counter("hft_feed_stale_total", "Times a product went without updates past its threshold", labels);
+    } else {
+        std::string labels = "connection=\"" + name + "\"";
+        watch.stale_gauge = &registry.gauge("hft_heartbeat_missing", "1 while a connection is missing heartbeats", labels);
+        watch.alerts_metric = &registry.counter("hft_heartbeat_gaps_total", "Heartbeat gaps past the threshold, by connection", labels);
+    }
+    
+    std::lock_guard<std::mutex> lock(advance_mutex);
+    unscheduled.push_back(static_cast<uint32_t>(watches.size() - 1));
+    return watches.size() - 1;
+}
+
+size_t FeedWatchdog::watchProduct(const std::string& product_id) {
+    size_t id = addWatch(product_id, WatchKind::PRODUCT, options.product_stale_after);
+    product_index.emplace(product_id, id);
+    return id;
+}
+
+size_t FeedWatchdog::watchConnection(const std::string& connection) {
+    return addWatch(connection, WatchKind::CONNECTION, options.heartbeat_gap_after);
+}
+
+void FeedWatchdog::touchProduct(const std::string& product_id, std::chrono::steady_clock::time_point now) {
+    if (last_product.empty() || product_id != last_product) {
+        auto it = product_index.find(product_id);
+        if (it == product_index.end()) return;
+        last_product = product_id;
+        last_index = it->second;
+    }
+    touch(last_index, now);
+}
+
+void FeedWatchdog::schedule(uint32_t watch_id, int64_t deadline_ns) {
+    // Nothing may land in a slot that has already expired
+    deadline_ns = std::max(deadline_ns, wheel_time_ns);
+    Watch& watch = watches[watch_id];
+    watch.deadline_ns = deadline_ns;
+    watch.scheduled = true;
+    wheel[static_cast<size_t>(deadline_ns / resolution_ns) % wheel.size()].push_back(watch_id);
+}
+
+void FeedWatchdog::advance(std::chrono::steady_clock::time_point now) {
+    int64_t now_ns = now.time_since_epoch().count();
+    std::lock_guard<std::mutex> lock(advance_mutex);
+    if (wheel_time_ns == 0) {
+        wheel_time_ns = now_ns - now_ns % resolution_ns;
+    }
+    
+    // Watches join the wheel at their first touch, so a connection still
+    // subscribing or a product yet to trade raises nothing
+    for (size_t i = 0; i < unscheduled.size();) {
+        Watch& watch = watches[unscheduled[i]];
+        int64_t last_seen = watch.last_seen_ns.load(std::memory_order_relaxed);
+        if (last_seen != 0) {
+            schedule(unscheduled[i], last_seen + watch.threshold_ns);
+            unscheduled[i] = unscheduled.back();
+            unscheduled.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    
+    checkRecovered(now_ns);
+    
+    // A slot expires once its whole span has passed; after a long pause each
+    // slot is visited once and the wheel jumps to now
+    std::vector<uint32_t> expiring;
+    for (size_t visited = 0; wheel_time_ns + resolution_ns <= now_ns && visited < wheel.size(); ++visited) {
+        expiring.swap(wheel[static_cast<size_t>(wheel_time_ns / resolution_ns) % wheel.size()]);
+        wheel_time_ns += resolution_ns;
+        for (uint32_t id : expiring) {
+            expire(id, now_ns);
+        }
+        expiring.clear();
+    }
+    if (wheel_time_ns + resolution_ns <= now_ns) {
+        wheel_time_ns = now_ns - now_ns % resolution_ns;
+    }
+}
+
+void FeedWatchdog::expire(uint32_t watch_id, int64_t now_ns) {
+    Watch& watch = watches[watch_id];
+    watch.scheduled = false;
+    if (watch.deadline_ns > now_ns) {
+        // Filed a whole rotation or more ahead
+        schedule(watch_id, watch.deadline_ns);
+        return;
+    }
+    
+    if (watch.stale_since_ns == 0) {
+        int64_t due = watch.last_seen_ns.load(std::memory_order_relaxed) + watch.threshold_ns;
+        if (due > now_ns) {
+            schedule(watch_id, due);
+            return;
+        }
+    }
+    raiseAlert(watch_id, now_ns);
+    
+    // A silent connection is retried with backoff; a stale product just waits
+    // for its next update, which checkRecovered notices
+    if (watch.kind == WatchKind::CONNECTION) {
+        int64_t max_backoff = std::chrono::duration_cast<std::chrono::nanoseconds>(options.max_reconnect_backoff).count();
+        int64_t backoff = watch.threshold_ns << std::min<uint32_t>(watch.alerts, 20);
+        schedule(watch_id, now_ns + std::min(backoff, std::max(max_backoff, watch.threshold_ns)));
+    }
+}
+
+void FeedWatchdog::raiseAlert(uint32_t watch_id, int64_t now_ns) {
+    Watch& watch = watches[watch_id];
+    int64_t age_ns = now_ns - watch.last_seen_ns.load(std::memory_order_relaxed);
+    if (watch.stale_since_ns == 0) {
+        watch.stale_since_ns = now_ns;
+        stale.push_back(watch_id);
+        watch.stale_gauge->set(1);
+        watch.alerts_metric->increment();
+        
+        if (watch.kind == WatchKind::PRODUCT) {
+            stale_events++;
+            std::string cause = connectionsHealthy() ? "quiet market, heartbeats arriving" : "connection heartbeats missing too";
+            logger.warning("Feed watchdog: " + watch.name + " has not updated for " + formatSeconds(age_ns) + " (" + cause + ")");
+            logger.logTest("FEED_STALE", "WARNING", watch.name + " silent for " + formatSeconds(age_ns) + ", " + cause);
+        } else {
+            heartbeat_gaps++;
+            logger.warning("Feed watchdog: no heartbeat on " + watch.name + " for " + formatSeconds(age_ns));
+            logger.logTest("HEARTBEAT_GAP", "WARNING", watch.name + " silent for " + formatSeconds(age_ns));
+        }
+    }
+    watch.alerts++;
+    
+    if (watch.kind == WatchKind::CONNECTION && options.reconnect_on_heartbeat_gap && stall_callback) {
+        reconnects_requested++;
+        reconnects_metric.increment();
+        logger.warning("Feed watchdog: requesting reconnect of " + watch.name + " (attempt " + std::to_string(watch.alerts) + ")");
+        stall_callback(watch.name);
+    }
+}
+
+void FeedWatchdog::checkRecovered(int64_t now_ns) {
+    for (size_t i = 0; i < stale.size();) {
+        Watch& watch = watches[stale[i]];
+        int64_t last_seen = watch.last_seen_ns.load(std::memory_order_relaxed);
+        if (last_seen <= watch.stale_since_ns) {
+            ++i;
+            continue;
+        }
+        
+        logger.info("Feed watchdog: " + watch.name + " recovered after " +
+                   formatSeconds(now_ns - watch.stale_since_ns) + " stale" +
+                   (watch.kind == WatchKind::CONNECTION ? " (" + std::to_string(watch.alerts) + " alert(s))" : ""));
+        watch.stale_gauge->set(0);
+        watch.stale_since_ns = 0;
+        watch.alerts = 0;
+        if (!watch.scheduled) {
+            schedule(stale[i], last_seen + watch.threshold_ns);
+        }
+        stale[i] = stale.back();
+        stale.pop_back();
+    }
+}
+
+bool FeedWatchdog::connectionsHealthy() const {
+    for (const auto& watch : watches) {
+        if (watch.kind == WatchKind::CONNECTION && watch.stale_since_ns != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FeedWatchdog::isStale(size_t watch_id) const {
+    std::lock_guard<std::mutex> lock(advance_mutex);
+    return watches[watch_id].stale_since_ns != 0;
+}
+
+size_t FeedWatchdog::getStaleCount() const {
+    std::lock_guard<std::mutex> lock(advance_mutex);
+    return stale.size();
+}
+
+void FeedWatchdog::start() {
+    std::lock_guard<std::mutex> lock(thread_mutex);
+    if (running) return;
+    
+    running = true;
+    watchdog_thread = std::thread(&FeedWatchdog::watchdogLoop, this);
+    logger.info("Feed watchdog started: " + std::to_string(watches.size()) + " watch(es), products stale after " +
+               formatSeconds(std::chrono::duration_cast<std::chrono::nanoseconds>(options.product_stale_after).count()) +
+               ", heartbeat gap after " +
+               formatSeconds(std::chrono::duration_cast<std::chrono::nanoseconds>(options.heartbeat_gap_after).count()));
+}
+
+void FeedWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex);
+        if (!running) return;
+        running = false;
+    }
+    thread_cv.notify_one();
+    if (watchdog_thread.joinable()) {
+        watchdog_thread.join();
+    }
+}
+
+void FeedWatchdog::watchdogLoop() {
+    std::unique_lock<std::mutex> lock(thread_mutex);
+    while (running) {
+        thread_cv.wait_for(lock, options.resolution, [this] { return !running; });
+        if (!running) break;
+        
+        lock.unlock();
+        advance(std::chrono::steady_clock::now());
+        lock.lock();
+    }
+}
@@ -0,0 +1,371 @@
+#include "file_sink.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#if defined(__linux__) && defined(HFT_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#define HFT_IO_URING_SUPPORTED 1
+#endif
+
+namespace {
+
+class OfstreamFileSink : public FileSink {
+private:
+    std::ofstream file;
+    bool failed;        // sticky: callers ask after close(), when the stream state is gone
+    
+    void check() {
+        if (file.fail()) {
+            failed = true;
+        }
+    }
+
+public:
+    OfstreamFileSink(const std::string& path, bool append) : failed(false) {
+        if (!path.empty()) {
+            file.open(path, append ? std::ios::app : std::ios::trunc);
+        }
+    }
+    
+    bool isOpen() const override { return file.is_open(); }
+    
+    void write(const char* data, size_t length) override {
+        file.write(data, length);
+        check();
+    }
+    
+    void flush() override {
+        file.flush();
+        check();
+    }
+    
+    void close() override {
+        if (!file.is_open()) return;
+        file.close();
+        check();
+    }
+    
+    const char* backendName() const override { return "ofstream"; }
+    bool hasFailed() const override { return failed; }
+};
+
+#ifdef HFT_IO_URING_SUPPORTED
+
+// Raw io_uring without liburing. Output is copied into a small set of
+// registered buffers; flush() submits whatever has accumulated as one
+// WRITE_FIXED at an explicit file offset and returns without waiting.
+// The submitting thread only waits when every buffer is still in flight.
+class IoUringFileSink : public FileSink {
+private:
+    static constexpr unsigned QUEUE_DEPTH = 64;
+    static constexpr size_t BUFFER_COUNT = 8;
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+    
+    struct Buffer {
+        char* data;
+        size_t fill;          // bytes copied in
+        size_t submitted;     // bytes handed to the kernel
+        unsigned inflight;    // outstanding requests pointing into this buffer
+    };
+    
+    struct Request {
+        unsigned buffer;
+        size_t buffer_offset;
+        size_t length;
+        uint64_t file_offset;
+    };
+    
+    int fd;
+    int ring_fd;
+    bool fixed_buffers;
+    
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+    
+    std::vector<char> storage;
+    std::vector<Buffer> buffers;
+    size_t current;
+    std::vector<Request> requests;
+    std::vector<unsigned> free_requests;
+    uint64_t file_offset;
+    unsigned inflight_total;
+    size_t failed_writes;
+
+public:
+    IoUringFileSink(const std::string& path, bool append) 
+        : fd(-1), ring_fd(-1), fixed_buffers(false), sq_ring(MAP_FAILED), sq_ring_size(0), 
+          cq_ring(MAP_FAILED), cq_ring_size(0), sqes(nullptr), sqes_size(0), current(0), 
+          file_offset(0), inflight_total(0), failed_writes(0) {
+        if (path.empty() || !setupRing()) {
+            return;
+        }
+        
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+        if (fd < 0) {
+            return;
+        }
+        
+        // Explicit offsets rather than O_APPEND, so completions may land in any order
+        struct stat info;
+        if (append && fstat(fd, &info) == 0) {
+            file_offset = static_cast<uint64_t>(info.st_size);
+        }
+        
+        storage.resize(BUFFER_COUNT * BUFFER_SIZE);
+        std::vector<iovec> iovecs(BUFFER_COUNT);
+        for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+            buffers.push_back({storage.data() + i * BUFFER_SIZE, 0, 0, 0});
+            iovecs[i].iov_base = buffers[i].data;
+            iovecs[i].iov_len = BUFFER_SIZE;
+        }
+        // Registration can fail under a tight RLIMIT_MEMLOCK; plain WRITE is still asynchronous
+        fixed_buffers = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, 
+                                iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+        
+        requests.resize(QUEUE_DEPTH);
+        for (unsigned i = QUEUE_DEPTH; i-- > 0;) {
+            free_requests.push_back(i);
+        }
+    }
+    
+    ~IoUringFileSink() override {
+        close();
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+        if (ring_fd >= 0) ::close(ring_fd);
+    }
+    
+    bool isOpen() const override { return fd >= 0; }
+    const char* backendName() const override { return fixed_buffers ? "io_uring" : "io_uring (unregistered buffers)"; }
+    bool hasFailed() const override { return failed_writes > 0; }
+    
+    void write(const char* data, size_t length) override {
+        if (fd < 0) return;
+        
+        while (length > 0) {
+            Buffer& buffer = buffers[current];
+            size_t chunk = std::min(length, BUFFER_SIZE - buffer.fill);
+            std::memcpy(buffer.data + buffer.fill, data, chunk);
+            buffer.fill += chunk;
+            data += chunk;
+            length -= chunk;
+            
+            if (buffer.fill == BUFFER_SIZE) {
+                submitPending(current);
+                advanceBuffer();
+            }
+        }
+    }
+    
+    void flush() override {
+        if (fd < 0) return;
+        submitPending(current);
+        reapCompletions();
+    }
+    
+    void close() override {
+        if (fd < 0) return;
+        
+        submitPending(current);
+        while (inflight_total > 0) {
+            waitForCompletion();
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    
+private:
+    bool setupRing() {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (ring_fd < 0) {
+            return false;
+        }
+        
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                       ring_fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) return false;
+        cq_ring = single_mmap ? sq_ring : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, 
+                                               MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) return false;
+        
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                             ring_fd, IORING_OFF_SQES);
+        if (sqe_map == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(sqe_map);
+        
+        char* sq = static_cast<char*>(sq_ring);
+        sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries = params.sq_entries;
+        
+        char* cq = static_cast<char*>(cq_ring);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+    
+    void submitPending(size_t index) {
+        Buffer& buffer = buffers[index];
+        if (buffer.fill == buffer.submitted) return;
+        
+        while (free_requests.empty()) {
+            waitForCompletion();
+        }
+        unsigned id = free_requests.back();
+        free_requests.pop_back();
+        
+        requests[id] = {static_cast<unsigned>(index), buffer.submitted, buffer.fill - buffer.submitted, file_offset};
+        file_offset += buffer.fill - buffer.submitted;
+        buffer.submitted = buffer.fill;
+        buffer.inflight++;
+        inflight_total++;
+        submitRequest(id);
+    }
+    
+    void submitRequest(unsigned id) {
+        const Request& request = requests[id];
+        unsigned tail = *sq_tail;
+        unsigned index = tail & *sq_mask;
+        
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffers[request.buffer].data + request.buffer_offset);
+        sqe.len = static_cast<uint32_t>(request.length);
+        sqe.off = request.file_offset;
+        sqe.buf_index = static_cast<uint16_t>(request.buffer);
+        sqe.user_data = id;
+        
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        
+        // Requests never outnumber SQ entries, so this only hands the entry over
+        syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0);
+    }
+    
+    void reapCompletions() {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cq_mask];
+            unsigned id = static_cast<unsigned>(cqe.user_data);
+            int result = cqe.res;
+            head++;
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            
+            Request& request = requests[id];
+            if (result == -EAGAIN || result == -EINTR) {
+                submitRequest(id);
+            } else if (result > 0 && static_cast<size_t>(result) < request.length) {
+                // Short write: resubmit the remainder at the matching offset
+                request.buffer_offset += result;
+                request.length -= result;
+                request.file_offset += result;
+                submitRequest(id);
+            } else {
+                if (result <= 0) {
+                    failed_writes++;
+                }
+                completeRequest(id);
+            }
+            tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        }
+    }
+    
+    void completeRequest(unsigned id) {
+        Buffer& buffer = buffers[requests[id].buffer];
+        buffer.inflight--;
+        inflight_total--;
+        free_requests.push_back(id);
+    }
+    
+    void waitForCompletion() {
+        syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        reapCompletions();
+    }
+    
+    void advanceBuffer() {
+        current = (current + 1) % buffers.size();
+        Buffer& next = buffers[current];
+        while (next.inflight > 0) {
+            waitForCompletion();
+        }
+        next.fill = 0;
+        next.submitted = 0;
+    }
+};
+
+#endif
+
+} // namespace
+
+bool ioUringAvailable() {
+#ifdef HFT_IO_URING_SUPPORTED
+    static const bool available = [] {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<FileSink> openFileSink(const std::string& path, bool append, FileSinkBackend backend) {
+#ifdef HFT_IO_URING_SUPPORTED
+    if (backend != FileSinkBackend::OFSTREAM && ioUringAvailable()) {
+        auto sink = std::make_unique<IoUringFileSink>(path, append);
+        if (sink->isOpen()) {
+            return sink;
+        }
+    }
+#else
+    (void)backend;
+#endif
+    return std::make_unique<OfstreamFileSink>(path, append);
+}
@@ -1,15 +1,155 @@
 #include "hft_processor.h"
+#include "allocation_counter.h"
+#include "tracepoints.h"
+#include <algorithm>
+
+namespace {
+
+const char CHECKPOINT_PATH[] = "hft_state.ckpt";
+const std::chrono::seconds CHECKPOINT_MAX_AGE(300);     // older state is worse than a cold start
+const std::chrono::milliseconds FANOUT_DRAIN_TIMEOUT(500);      // bounds shutdown behind a stuck subscriber
+const char FEED_URL[] = "wss://ws-feed.exchange.coinbase.com";
+const WebSocketTransport LIVE_TRANSPORT = WebSocketTransport::IXWEBSOCKET;    // EPOLL for the native transport
+const std::chrono::seconds PROGRESS_INTERVAL(30);
+
+// A C++20 build with HFT_COROUTINES runs on event loops; THREADED still works there
+#ifdef HFT_COROUTINES
+const ExecutionMode EXECUTION_MODE = ExecutionMode::COROUTINES;
+#else
+const ExecutionMode EXECUTION_MODE = ExecutionMode::THREADED;
+#endif
+const size_t EVENT_LOOP_THREADS = 2;            // processing, housekeeping
+const size_t TICK_CHANNEL_CAPACITY = 4096;      // the transport waits when processing is this far behind
+
+const LogTemplate EMA_PROGRESS("EMA Progress - Sequence #{} | Total calculations: {} | "
+                               "Current Price EMA: ${} | Current Mid EMA: ${}");
+const LogTemplate TICKER_SUMMARY("#{} {} - Price: ${:.2f} | Mid: ${:.2f} | Price EMA: ${:.4f} | Mid EMA: ${:.4f}");
+const LogTemplate TICKER_PROCESSING_PASSED("TEST: TICKER_PROCESSING - PASSED | Details: Processed {} tickers with individual EMAs");
+
+double millisecondsSince(std::chrono::steady_clock::time_point& phase_start) {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double, std::milli>(now - phase_start).count();
+    phase_start = now;
+    return elapsed;
+}
+
+// Indicators written after the EMA columns; products can override via per_product
+IndicatorConfig liveIndicatorConfig() {
+    IndicatorConfig config;
+    config.defaults = {
+        IndicatorSpec(IndicatorType::SMA, 20),
+        IndicatorSpec(IndicatorType::VOLATILITY, 50),
+        IndicatorSpec(IndicatorType::RSI, 14),
+        IndicatorSpec(IndicatorType::BOLLINGER, 20, 2.0),
+        IndicatorSpec(IndicatorType::SPREAD_EMA, 20)
+    };
+    return config;
+}
+
+// Roll hourly or at 256 MB, gzip closed segments and keep data across restarts
+CSVWriterOptions liveCSVOptions(const IndicatorEngine& indicators) {
+    CSVWriterOptions options;
+    options.max_file_bytes = 256 * 1024 * 1024;
+    options.max_file_age = std::chrono::hours(1);
+    options.compress_closed_segments = true;
+    options.append_on_restart = true;
+    if (HFTProcessor::INDICATORS_ENABLED) {
+        options.extra_columns = indicators.columnNames();
+    }
+    return options;
+}
+
+// At most one CSV row per product every 100 ms, sooner on a 5 bp price move.
+// The EMAs, indicators, shared memory and fan-out still see every tick.
+ConflationOptions liveConflationOptions() {
+    ConflationOptions options;
+    options.interval = std::chrono::milliseconds(100);
+    options.price_threshold = 0.0005;
+    return options;
+}
+
+// A stalled connection is noticed within 3 s of its last heartbeat and
+// reconnected; a product quiet for 30 s is reported but left alone
+WatchdogOptions liveWatchdogOptions() {
+    WatchdogOptions options;
+    options.product_stale_after = std::chrono::seconds(30);
+    options.heartbeat_gap_after = std::chrono::seconds(3);
+    options.reconnect_on_heartbeat_gap = true;
+    return options;
+}
+
+// Cross-product streams written as synthetic products. Their inputs are added to
+// the exchange subscription; only the primary product runs the main pipeline.
+std::vector<DerivedSpec> liveDerivedSpecs() {
+    return {
+        DerivedSpec::ratio("ETH-BTC-IMPLIED", "ETH-USD", "BTC-USD"),
+        DerivedSpec::ratio("SOL-ETH-IMPLIED", "SOL-USD", "ETH-USD"),
+        DerivedSpec::spread("BTC-USDT-SPRD", "BTC-USD", "BTC-USDT"),
+        DerivedSpec::basket("BTC-ETH-SOL-BSK", {"BTC-USD", "ETH-USD", "SOL-USD"}, {0.01, 0.2, 2.0})
+    };
+}
+
+} // namespace
 
 HFTProcessor::HFTProcessor(const std::string& product_id, Logger& log) 
-    : logger(log), csv_writer("ticker_data.csv", log), ws_client(product_id, log),
-      ema_interval(5), price_ema_calc(0.2), mid_price_ema_calc(0.2) {
+    : price_ema_calc(0.2), mid_price_ema_calc(0.2), logger(log), indicators(liveIndicatorConfig()), 
+      derived_streams(DERIVED_STREAMS_ENABLED ? liveDerivedSpecs() : std::vector<DerivedSpec>()), 
+      history(std::chrono::hours(4)), 
+      csv_writer("ticker_data.csv", log, liveCSVOptions(indicators)), csv_conflator(liveConflationOptions()),
+      tick_publisher(SHARED_TICK_SEGMENT_NAME, log), 
+      fanout_server(TICK_FANOUT_SOCKET_PATH, log), watchdog(log, liveWatchdogOptions()),
+      product_watch(watchdog.watchProduct(product_id)), heartbeat_watch(watchdog.watchConnection("ws-feed")),
+      ws_client(product_id, log, LIVE_TRANSPORT, FEED_URL), product(product_id),
+      checkpointer(CHECKPOINT_PATH, log),
+      ema_interval(5), execution_mode(EXECUTION_MODE),
+#ifdef HFT_COROUTINES
+      event_loops(log, EVENT_LOOP_THREADS, "hft-loop"), tick_channel(event_loops[0], TICK_CHANNEL_CAPACITY),
+#endif
+      ticks_metric(MetricsRegistry::global().counter("hft_ticks_processed_total", "Ticker updates processed")),
+      tick_latency_metric(MetricsRegistry::global().histogram("hft_tick_processing_seconds",
+          "Time from parsed ticker to CSV, shared memory and fan-out publish", latencyBucketsNs(), 1e9)),
+      pipeline(SequenceStage{last_sequence},
+               EMAStage{price_ema_calc, mid_price_ema_calc, ema_updates_count},
+               OptionalStage<INDICATORS_ENABLED, IndicatorStage>{indicators},
+               OptionalStage<HISTORY_ENABLED, HistoryStage>{history},
+               OptionalStage<CSV_OUTPUT_ENABLED, ConflatedCSVSinkStage>{csv_conflator, csv_writer},
+               OptionalStage<SHARED_MEMORY_ENABLED, SharedTickStage>{tick_publisher},
+               OptionalStage<FANOUT_ENABLED, FanoutStage>{fanout_server}),
+      derived_pipeline(SequenceStage{derived_sequence},
+                       OptionalStage<INDICATORS_ENABLED, IndicatorStage>{indicators},
+                       OptionalStage<HISTORY_ENABLED, HistoryStage>{history},
+                       OptionalStage<CSV_OUTPUT_ENABLED, ConflatedCSVSinkStage>{csv_conflator, csv_writer},
+                       OptionalStage<SHARED_MEMORY_ENABLED, SharedTickStage>{tick_publisher},
+                       OptionalStage<FANOUT_ENABLED, FanoutStage>{fanout_server}) {
     
     last_ema_update = std::chrono::system_clock::now();
     
+    std::vector<char> saved_state;
+    if (StateCheckpointer::load(CHECKPOINT_PATH, CHECKPOINT_MAX_AGE, saved_state, logger) && restoreState(saved_state)) {
+        logger.info("Warm start from checkpoint: resuming at sequence " + std::to_string(last_sequence + 1) +
+                   ", price EMA $" + std::to_string(price_ema_calc.getCurrentEMA()));
+        logger.logTest("CHECKPOINT_RESTORE", "PASSED", "Resumed at sequence " + std::to_string(last_sequence + 1));
+    }
+    
+    if (!derived_streams.empty()) {
+        ws_client.addProducts(derived_streams.inputProducts());
+        for (const auto& input : derived_streams.inputProducts()) {
+            watchdog.watchProduct(input);
+        }
+        logger.info("Derived streams: " + std::to_string(derived_streams.getStreamCount()) + 
+                   " over " + std::to_string(derived_streams.inputProducts().size()) + " input products");
+    }
+    
     // Set up WebSocket data callback
-    ws_client.setDataCallback([this](const TickerData& ticker) {
-        TickerData mutable_ticker = ticker;
-        processTickerData(mutable_ticker);
+    // The client hands over its scratch ticker; annotate it in place rather than copying
+    ws_client.setDataCallback([this](TickerData& ticker) {
+        processTickerData(ticker);
+    });
+    
+    // Heartbeats tell a quiet market from a dead connection
+    ws_client.enableHeartbeats([this]() { watchdog.touch(heartbeat_watch); });
+    watchdog.setStallCallback([this](const std::string& connection) {
+        ws_client.reconnect("no heartbeat on " + connection);
     });
     
     logger.info("HFT Processor initialized for: " + product_id);
@@ -27,6 +167,15 @@ void HFTProcessor::start() {
     }
     
     running = true;
+    started_at = std::chrono::steady_clock::now();
+    fanout_server.start();
+    if (execution_mode == ExecutionMode::COROUTINES) {
+#ifdef HFT_COROUTINES
+        startCoroutines();
+#endif
+    } else {
+        watchdog.start();
+    }
     ws_client.start();
     
     logger.info("HFT Processor started");
@@ -37,7 +186,46 @@ void HFTProcessor::stop() {
     if (!running) return;
     
     running = false;
+    auto phase_start = std::chrono::steady_clock::now();
+    
+    // 1. Stop taking frames. Ticks are processed on the ix thread, which
+    // ws_client.stop() joins, so no tick is half-way through the pipeline after this.
+    // With coroutines, loop 0 first processes what is left in the channel.
+    watchdog.stop();
     ws_client.stop();
+#ifdef HFT_COROUTINES
+    if (execution_mode == ExecutionMode::COROUTINES) {
+        stopCoroutines();
+    }
+#endif
+    shutdown_timings.stop_intake_ms = millisecondsSince(phase_start);
+    
+    // 2. Drain: rows held back by conflation carry the latest state, and
+    // subscribers get what was already queued for them
+    shutdown_timings.rows_drained = 0;
+    if (CSV_OUTPUT_ENABLED) {
+        csv_conflator.flush([this](const TickerData& row) {
+            csv_writer.writeTickerData(row);
+            shutdown_timings.rows_drained++;
+        });
+    }
+    fanout_server.stop(FANOUT_DRAIN_TIMEOUT);
+    shutdown_timings.fanout_undelivered = fanout_server.getUndeliveredAtStop();
+    shutdown_timings.drain_ms = millisecondsSince(phase_start);
+    
+    // 3. Flush: wait for outstanding CSV writes and sync the final checkpoint
+    shutdown_timings.csv_complete = csv_writer.close();
+    captureState(checkpoint_buffer);
+    checkpointer.writeNow(checkpoint_buffer);
+    shutdown_timings.flush_ms = millisecondsSince(phase_start);
+    
+    std::string phases = "stop intake " + std::to_string(shutdown_timings.stop_intake_ms) + " ms | drain " +
+                         std::to_string(shutdown_timings.drain_ms) + " ms (" + std::to_string(shutdown_timings.rows_drained) +
+                         " CSV rows, " + std::to_string(shutdown_timings.fanout_undelivered) + " fan-out undelivered) | flush " +
+                         std::to_string(shutdown_timings.flush_ms) + " ms";
+    logger.info("Shutdown phases: " + phases);
+    bool lossless = shutdown_timings.csv_complete && shutdown_timings.fanout_undelivered == 0;
+    logger.logTest("SHUTDOWN_PHASES", lossless ? "PASSED" : "WARNING", phases);
     
     logStatistics();
     logger.info("HFT Processor stopped gracefully");
@@ -45,30 +233,147 @@ void HFTProcessor::stop() {
 }
 
 void HFTProcessor::processTickerData(TickerData& ticker) {
-    total_messages_processed++;
+#ifdef HFT_COROUTINES
+    if (execution_mode == ExecutionMode::COROUTINES) {
+        tick_channel.send(ticker);
+        return;
+    }
+#endif
+    processTick(ticker);
+}
+
+void HFTProcessor::processTick(TickerData& ticker) {
+    AllocationScope scope(AllocationTag::PROCESS);
+    if (ticker.product_id != product) {
+        // Subscribed only as an input to derived streams
+        derived_input_ticks++;
+        watchdog.touchProduct(ticker.product_id);
+        updateDerivedStreams(ticker);
+        return;
+    }
     
-    ticker.sequence_number = total_messages_processed;
+    HFT_TRACE1(tick_start, ticker.product_id.c_str());
+    auto processing_start = std::chrono::steady_clock::now();
+    watchdog.touch(product_watch, processing_start);
+    total_messages_processed++;
+    ticks_metric.increment();
     
-    ticker.price_ema = price_ema_calc.update(ticker.price);
-    ticker.mid_price_ema = mid_price_ema_calc.update(ticker.mid_price);
-    ema_updates_count++;
+    pipeline.process(ticker);
+    HFT_TRACE2(tick_end, ticker.sequence_number, ticker.product_id.c_str());
+    updateDerivedStreams(ticker);
     
-    csv_writer.writeTickerData(ticker);
+    // The coroutine mode checkpoints from a timer instead of checking every tick
+    if (execution_mode == ExecutionMode::THREADED && checkpointer.due(processing_start)) {
+        captureState(checkpoint_buffer);
+        checkpointer.submit(checkpoint_buffer, processing_start);
+    }
+    tick_latency_metric.observe(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - processing_start).count());
     
-    // Log every 25th processed message with EMA details
-    if (total_messages_processed % 25 == 0) {
-        logger.info(ticker.toLogString());
-        logger.logTest("TICKER_PROCESSING", "PASSED", 
-                      "Processed " + std::to_string(total_messages_processed) + 
-                      " tickers with individual EMAs");
+    // Log every 25th processed message with EMA details; the line's own
+    // timestamp stands in for the receive time toLogString() prints
+    if (ticker.sequence_number % 25 == 0) {
+        logger.log(LogLevel::INFO, TICKER_SUMMARY, ticker.sequence_number, ticker.product_id, ticker.price,
+                   ticker.mid_price, ticker.price_ema, ticker.mid_price_ema);
+        logger.logTest(TICKER_PROCESSING_PASSED, total_messages_processed.load());
     }
     
     // Log periodic EMA progress every 100 messages
-    if (total_messages_processed % 100 == 0) {
-        logger.info("EMA Progress - Sequence #" + std::to_string(ticker.sequence_number) +
-                   " | Total calculations: " + std::to_string(ema_updates_count) + 
-                   " | Current Price EMA: $" + std::to_string(ticker.price_ema) +
-                   " | Current Mid EMA: $" + std::to_string(ticker.mid_price_ema));
+    if (ticker.sequence_number % 100 == 0 && logger.isEnabled(LogLevel::INFO)) {
+        logger.log(LogLevel::INFO, EMA_PROGRESS, ticker.sequence_number, ema_updates_count.load(),
+                   ticker.price_ema, ticker.mid_price_ema);
+    }
+}
+
+#ifdef HFT_COROUTINES
+void HFTProcessor::startCoroutines() {
+    event_loops.start();
+    event_loops[0].spawn(receiveTicks());
+    if (CSV_OUTPUT_ENABLED && csv_conflator.enabled()) {
+        event_loops[0].spawn(flushConflatedRows());
+    }
+    event_loops[0].spawn(snapshotState());
+    event_loops[1].spawn(runWatchdog());
+    event_loops[1].spawn(reportProgress());
+    
+    logger.info("Coroutine execution: " + std::to_string(event_loops.size()) + " event loops, tick channel of " +
+               std::to_string(TICK_CHANNEL_CAPACITY));
+}
+
+void HFTProcessor::stopCoroutines() {
+    // The receiver drains the channel and returns; the timers end when the loops stop
+    tick_channel.close();
+    event_loops.stop();
+}
+
+Task HFTProcessor::receiveTicks() {
+    // Copied out of the channel slot; its strings keep their capacity between ticks
+    TickerData ticker;
+    while (true) {
+        bool open = co_await tick_channel.wait();
+        if (!open) break;
+        while (tick_channel.tryReceive(ticker)) {
+            processTick(ticker);
+        }
+    }
+}
+
+// A held row is written when its interval is up even if no later tick comes.
+// Deadlines are exchange timestamps; the wait is measured on the local clock.
+Task HFTProcessor::flushConflatedRows() {
+    EventLoop& loop = event_loops[0];
+    while (true) {
+        EventLoop::Clock::duration wait = csv_conflator.getInterval();
+        if (csv_conflator.getPendingCount() > 0) {
+            auto until_due = csv_conflator.getNextDeadline() - std::chrono::system_clock::now();
+            wait = std::max(std::chrono::duration_cast<EventLoop::Clock::duration>(until_due),
+                            EventLoop::Clock::duration::zero());
+        }
+        bool expired = co_await loop.sleepFor(wait);
+        if (!expired) break;
+        
+        csv_conflator.flushDue(std::chrono::system_clock::now(), [this](const TickerData& row) {
+            csv_writer.writeTickerData(row);
+        });
+    }
+}
+
+Task HFTProcessor::snapshotState() {
+    EventLoop& loop = event_loops[0];
+    while (true) {
+        bool expired = co_await loop.sleepFor(checkpointer.getInterval());
+        if (!expired) break;
+        
+        auto now = std::chrono::steady_clock::now();
+        if (checkpointer.due(now)) {
+            captureState(checkpoint_buffer);
+            checkpointer.submit(checkpoint_buffer, now);
+        }
+    }
+}
+
+Task HFTProcessor::runWatchdog() {
+    EventLoop& loop = event_loops[1];
+    while (true) {
+        bool expired = co_await loop.sleepFor(watchdog.getResolution());
+        if (!expired) break;
+        watchdog.advance(std::chrono::steady_clock::now());
+    }
+}
+
+Task HFTProcessor::reportProgress() {
+    EventLoop& loop = event_loops[1];
+    while (true) {
+        bool expired = co_await loop.sleepFor(PROGRESS_INTERVAL);
+        if (!expired) break;
+        logProgress();
+    }
+}
+#endif
+
+void HFTProcessor::updateDerivedStreams(const TickerData& ticker) {
+    if (DERIVED_STREAMS_ENABLED) {
+        derived_streams.update(ticker, [this](TickerData& derived) { derived_pipeline.process(derived); });
     }
 }
 
@@ -82,8 +387,46 @@ void HFTProcessor::logStatistics() const {
     logger.info("Total messages processed: " + std::to_string(total_messages_processed));
     logger.info("EMA calculations performed: " + std::to_string(ema_updates_count));
     logger.info("CSV records written: " + std::to_string(csv_writer.getRecordsWritten()));
-    logger.info("WebSocket messages received: " + std::to_string(ws_client.getMessagesReceived()));
-    logger.info("Final sequence number: " + std::to_string(total_messages_processed));
+    logger.info("CSV segments rolled: " + std::to_string(csv_writer.getSegmentsRolled()) + 
+               " | Compressed: " + std::to_string(csv_writer.getSegmentsCompressed()));
+    logger.info("CSV ticks conflated: " + std::to_string(csv_conflator.getTicksConflated()) +
+               " of " + std::to_string(csv_conflator.getTicksOffered()) +
+               " | Rows emitted: " + std::to_string(csv_conflator.getRowsEmitted()));
+    if (!derived_streams.empty()) {
+        logger.info("Derived streams: " + std::to_string(derived_streams.getStreamCount()) +
+                   " | Input ticks: " + std::to_string(derived_streams.getInputTicks()) +
+                   " | Derived ticks: " + std::to_string(derived_streams.getDerivedTicks()) +
+                   " | Other-product ticks: " + std::to_string(derived_input_ticks));
+    }
+    if (HISTORY_ENABLED) {
+        size_t history_ticks = history.getTotalTicks();
+        size_t history_bytes = history.getMemoryBytes();
+        logger.info("Tick history: " + std::to_string(history_ticks) + " ticks in " +
+                   std::to_string(history.getBlockCount()) + " blocks | " + std::to_string(history_bytes / 1024) + " KiB" +
+                   (history_ticks > 0 ? " | " + std::to_string(double(history_bytes) / history_ticks) + " bytes/tick" : ""));
+    }
+    logger.info("Shared-memory ticks published: " + std::to_string(tick_publisher.getTicksPublished()));
+    logFanoutStatistics();
+    logAllocationStatistics();
+    logger.info("WebSocket messages received: " + std::to_string(ws_client.getMessagesReceived()) +
+               " | Heartbeats: " + std::to_string(ws_client.getHeartbeatsReceived()) +
+               " | Reconnects: " + std::to_string(ws_client.getReconnects()));
+    logger.info("Feed watchdog: " + std::to_string(watchdog.getStaleEvents()) + " stale product event(s) | " +
+               std::to_string(watchdog.getHeartbeatGaps()) + " heartbeat gap(s) | " +
+               std::to_string(watchdog.getReconnectsRequested()) + " reconnect(s) requested");
+#ifdef HFT_COROUTINES
+    if (execution_mode == ExecutionMode::COROUTINES) {
+        const EventLoop& processing_loop = event_loops[0];
+        logger.info("Event loops: " + std::to_string(event_loops.size()) + " | Loop 0 resumptions: " +
+                   std::to_string(processing_loop.getResumptions()) + " | Sleeps: " + std::to_string(processing_loop.getSleeps()) +
+                   " | Channel ticks: " + std::to_string(tick_channel.getItemsSent()) + " in " +
+                   std::to_string(tick_channel.getConsumerWakeups()) + " wake-up(s) | Producer stalls: " +
+                   std::to_string(tick_channel.getProducerStalls()));
+    }
+#endif
+    logger.info("Checkpoints written: " + std::to_string(checkpointer.getCheckpointsWritten()) +
+               " | Failed: " + std::to_string(checkpointer.getWriteFailures()));
+    logger.info("Final sequence number: " + std::to_string(last_sequence));
     
     // Calculate EMA efficiency
     double ema_efficiency = (total_messages_processed > 0) ? 
@@ -96,4 +439,108 @@ void HFTProcessor::logStatistics() const {
                   ", EMAs: " + std::to_string(ema_updates_count) + 
                   ", CSV records: " + std::to_string(csv_writer.getRecordsWritten()) +
                   ", Efficiency: " + std::to_string(ema_efficiency) + "%");
+}
+
+void HFTProcessor::logProgress() const {
+    auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(std::chrono::steady_clock::now() - started_at).count();
+    logger.info("Runtime: " + std::to_string(elapsed) + " minutes | " +
+               product + " messages processed: " + std::to_string(total_messages_processed) + " | " +
+               "EMA updates: " + std::to_string(ema_updates_count));
+    logFanoutStatistics();
+    logAllocationStatistics();
+}
+
+void HFTProcessor::logFanoutStatistics() const {
+    logger.info("Fan-out messages published: " + std::to_string(fanout_server.getMessagesPublished()) +
+               " | Source overflows: " + std::to_string(fanout_server.getSourceOverflows()));
+    
+    for (const auto& stats : fanout_server.getSubscriberStats()) {
+        logger.info("  Subscriber #" + std::to_string(stats.subscriber_id) + 
+                   " - Sent: " + std::to_string(stats.messages_sent) +
+                   " | Pending: " + std::to_string(stats.pending_messages) +
+                   " | Conflated: " + std::to_string(stats.conflated_updates) +
+                   " | Lag: " + std::to_string(stats.lag_ms) + " ms");
+    }
+}
+
+void HFTProcessor::logAllocationStatistics() const {
+    if (!AllocationCounter::accountingEnabled()) return;
+    
+    // Untagged work (metrics scrapes, startup) is not on the tick path
+    AllocationStats total = AllocationCounter::total();
+    AllocationStats untagged = AllocationCounter::stats(AllocationTag::UNTAGGED);
+    size_t ticks = total_messages_processed + derived_input_ticks;
+    double per_tick = ticks > 0 ? double(total.allocations - untagged.allocations) / ticks : 0.0;
+    logger.info("Heap allocations: " + std::to_string(total.allocations) + " | Per tick: " + std::to_string(per_tick) +
+               " | Live: " + std::to_string(total.liveBytes() / 1024) + " KiB in " + std::to_string(total.liveBlocks()) + " blocks");
+    
+    for (size_t index = 0; index < static_cast<size_t>(AllocationTag::COUNT); ++index) {
+        AllocationTag tag = static_cast<AllocationTag>(index);
+        AllocationStats stats = AllocationCounter::stats(tag);
+        logger.info("  " + std::string(allocationTagName(tag)) + " - Allocations: " + std::to_string(stats.allocations) +
+                   " | Allocated: " + std::to_string(stats.bytes_allocated / 1024) + " KiB" +
+                   " | Live: " + std::to_string(stats.liveBytes() / 1024) + " KiB in " + std::to_string(stats.liveBlocks()) + " blocks");
+    }
+}
+
+void HFTProcessor::captureState(std::vector<char>& payload) const {
+    AllocationScope scope(AllocationTag::PROCESS);
+    payload.clear();
+    CheckpointWriter out(payload);
+    out.putString(product);
+    out.put(static_cast<uint64_t>(last_sequence.load()));
+    out.put(price_ema_calc.getAlpha());
+    out.put(price_ema_calc.getCurrentEMA());
+    out.put(static_cast<uint8_t>(price_ema_calc.isInitialized()));
+    out.put(mid_price_ema_calc.getAlpha());
+    out.put(mid_price_ema_calc.getCurrentEMA());
+    out.put(static_cast<uint8_t>(mid_price_ema_calc.isInitialized()));
+    indicators.saveState(out);
+    derived_streams.saveState(out);
+    out.put(static_cast<uint64_t>(derived_sequence.load()));
+}
+
+bool HFTProcessor::restoreState(const std::vector<char>& payload) {
+    try {
+        CheckpointReader in(payload.data(), payload.size());
+        if (in.getString() != product) {
+            logger.info("Checkpoint belongs to another product; starting cold");
+            return false;
+        }
+        uint64_t sequence = in.get<uint64_t>();
+        double price_alpha = in.get<double>();
+        double price_ema = in.get<double>();
+        bool price_initialized = in.get<uint8_t>() != 0;
+        double mid_alpha = in.get<double>();
+        double mid_price_ema = in.get<double>();
+        bool mid_initialized = in.get<uint8_t>() != 0;
+        
+        // Everything is parsed before any of it is applied, so a payload that
+        // turns out truncated leaves the cold state untouched
+        IndicatorEngine::SavedState saved_indicators = IndicatorEngine::readState(in);
+        DerivedStreamEngine::SavedState saved_streams;
+        if (!in.atEnd()) {
+            saved_streams = DerivedStreamEngine::readState(in);
+        }
+        uint64_t derived = in.atEnd() ? 0 : in.get<uint64_t>();
+        
+        size_t products_restored = indicators.restoreState(saved_indicators);
+        size_t streams_restored = derived_streams.restoreState(saved_streams);
+        // An EMA taken with a different smoothing factor would be misleading
+        if (price_alpha == price_ema_calc.getAlpha() && mid_alpha == mid_price_ema_calc.getAlpha()) {
+            price_ema_calc.restore(price_ema, price_initialized);
+            mid_price_ema_calc.restore(mid_price_ema, mid_initialized);
+        } else {
+            logger.warning("EMA smoothing factor changed since the checkpoint; EMAs start cold");
+        }
+        last_sequence = static_cast<size_t>(sequence);
+        derived_sequence = static_cast<size_t>(derived);
+        
+        logger.info("Restored indicator state for " + std::to_string(products_restored) + " product(s), EMAs for " +
+                   std::to_string(streams_restored) + " derived stream(s)");
+        return true;
+    } catch (const std::exception& e) {
+        logger.warning("Checkpoint could not be applied: " + std::string(e.what()));
+        return false;
+    }
 }
\ No newline at end of file
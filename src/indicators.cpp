@@ -0,0 +1,290 @@
+#include "indicators.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+const double NOT_READY = std::numeric_limits<double>::quiet_NaN();
+
+// Rolling mean and sum of squared deviations over a fixed window, updated in
+// place. Header layout: [mean, m2, count, head]; ring holds the window.
+enum RollingField { MEAN = 0, M2 = 1, COUNT = 2, HEAD = 3, ROLLING_FIELDS = 4 };
+
+void rollingPush(double* header, double* ring, size_t window, double value) {
+    size_t count = static_cast<size_t>(header[COUNT]);
+    size_t head = static_cast<size_t>(header[HEAD]);
+    double mean = header[MEAN];
+    
+    if (count < window) {
+        // Welford add while the window fills
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        header[M2] += delta * (value - mean);
+    } else {
+        // Replace the oldest sample: the add and remove steps folded together
+        double oldest = ring[head];
+        double new_mean = mean + (value - oldest) / window;
+        header[M2] += (value - oldest) * (value - new_mean + oldest - mean);
+        mean = new_mean;
+    }
+    ring[head] = value;
+    head = (head + 1 == window) ? 0 : head + 1;
+    
+    if (head == 0 && count == window) {
+        // Once per full lap, recompute from the window so rounding can't drift
+        double sum = 0.0;
+        for (size_t i = 0; i < window; ++i) {
+            sum += ring[i];
+        }
+        mean = sum / window;
+        double m2 = 0.0;
+        for (size_t i = 0; i < window; ++i) {
+            m2 += (ring[i] - mean) * (ring[i] - mean);
+        }
+        header[M2] = m2;
+    }
+    if (header[M2] < 0.0) {
+        header[M2] = 0.0;
+    }
+    
+    header[MEAN] = mean;
+    header[COUNT] = static_cast<double>(count);
+    header[HEAD] = static_cast<double>(head);
+}
+
+double rollingStdDev(const double* header) {
+    double count = header[COUNT];
+    return count > 1 ? std::sqrt(header[M2] / (count - 1)) : 0.0;
+}
+
+// Header sizes in doubles; volatility keeps the previous mid in front of its window
+enum VolatilityField { LAST_MID = 0, VOLATILITY_WINDOW = 1 };
+enum RSIField { LAST_PRICE = 0, AVG_GAIN = 1, AVG_LOSS = 2, CHANGES = 3, RSI_FIELDS = 4 };
+enum SpreadField { SPREAD_EMA_VALUE = 0, SPREAD_INITIALIZED = 1, SPREAD_FIELDS = 2 };
+
+size_t headerSize(IndicatorType type) {
+    switch (type) {
+        case IndicatorType::SMA:
+        case IndicatorType::BOLLINGER:  return ROLLING_FIELDS;
+        case IndicatorType::VOLATILITY: return VOLATILITY_WINDOW + static_cast<size_t>(ROLLING_FIELDS);
+        case IndicatorType::RSI:        return RSI_FIELDS;
+        case IndicatorType::SPREAD_EMA: return SPREAD_FIELDS;
+    }
+    return 0;
+}
+
+bool hasWindow(IndicatorType type) {
+    return type == IndicatorType::SMA || type == IndicatorType::BOLLINGER || type == IndicatorType::VOLATILITY;
+}
+
+} // namespace
+
+const std::vector<IndicatorSpec>& IndicatorConfig::specsFor(const std::string& product_id) const {
+    auto it = per_product.find(product_id);
+    return it != per_product.end() ? it->second : defaults;
+}
+
+IndicatorEngine::IndicatorEngine(const IndicatorConfig& indicator_config)
+    : config(indicator_config), last_index(0) {
+    auto addSpecs = [this](const std::vector<IndicatorSpec>& specs) {
+        for (const auto& spec : specs) {
+            if (spec.window == 0 || spec.window > 1000000) {
+                throw std::invalid_argument("Indicator window must be between 1 and 1000000");
+            }
+            if (spec.type == IndicatorType::VOLATILITY && spec.window < 2) {
+                throw std::invalid_argument("Volatility window needs at least 2 returns");
+            }
+            for (const auto& name : outputNames(spec)) {
+                addColumn(name);
+            }
+        }
+    };
+    addSpecs(config.defaults);
+    for (const auto& entry : config.per_product) {
+        addSpecs(entry.second);
+    }
+}
+
+std::vector<std::string> IndicatorEngine::outputNames(const IndicatorSpec& spec) {
+    std::string window = std::to_string(spec.window);
+    switch (spec.type) {
+        case IndicatorType::SMA:        return {"sma_" + window};
+        case IndicatorType::VOLATILITY: return {"mid_volatility_" + window};
+        case IndicatorType::RSI:        return {"rsi_" + window};
+        case IndicatorType::BOLLINGER:  return {"bollinger_upper_" + window, "bollinger_lower_" + window};
+        case IndicatorType::SPREAD_EMA: return {"spread_ema_" + window};
+    }
+    return {};
+}
+
+void IndicatorEngine::addColumn(const std::string& name) {
+    if (column_index.emplace(name, columns.size()).second) {
+        columns.push_back(name);
+    }
+}
+
+size_t IndicatorEngine::productFor(const std::string& product_id) {
+    if (!products.empty() && product_id == last_product) {
+        return last_index;
+    }
+    
+    auto it = product_index.find(product_id);
+    if (it == product_index.end()) {
+        // First tick for this product: lay out its block once
+        ProductIndicators product;
+        size_t offset = columns.size();
+        for (const auto& spec : config.specsFor(product_id)) {
+            Indicator indicator{spec.type, static_cast<uint32_t>(spec.window), spec.width,
+                                static_cast<uint32_t>(offset), 0,
+                                static_cast<uint32_t>(column_index.at(outputNames(spec).front()))};
+            offset += headerSize(spec.type);
+            product.indicators.push_back(indicator);
+        }
+        for (auto& indicator : product.indicators) {
+            if (hasWindow(indicator.type)) {
+                indicator.ring = static_cast<uint32_t>(offset);
+                offset += indicator.window;
+            }
+        }
+        product.block.assign(offset, 0.0);
+        for (size_t column = 0; column < columns.size(); ++column) {
+            product.block[column] = NOT_READY;
+        }
+        
+        it = product_index.emplace(product_id, products.size()).first;
+        products.push_back(std::move(product));
+    }
+    
+    last_product = product_id;
+    last_index = it->second;
+    return last_index;
+}
+
+void IndicatorEngine::update(TickerData& ticker) {
+    if (columns.empty()) {
+        ticker.indicator_values = nullptr;
+        ticker.indicator_count = 0;
+        return;
+    }
+    
+    ProductIndicators& product = products[productFor(ticker.product_id)];
+    double* block = product.block.data();
+    
+    for (const auto& indicator : product.indicators) {
+        double* header = block + indicator.state;
+        double* output = block + indicator.column;
+        size_t window = indicator.window;
+        
+        switch (indicator.type) {
+            case IndicatorType::SMA:
+                rollingPush(header, block + indicator.ring, window, ticker.price);
+                output[0] = header[COUNT] == window ? header[MEAN] : NOT_READY;
+                break;
+            
+            case IndicatorType::BOLLINGER:
+                rollingPush(header, block + indicator.ring, window, ticker.mid_price);
+                if (header[COUNT] == window) {
+                    double band = indicator.width * rollingStdDev(header);
+                    output[0] = header[MEAN] + band;
+                    output[1] = header[MEAN] - band;
+                }
+                break;
+            
+            case IndicatorType::VOLATILITY: {
+                double last_mid = header[LAST_MID];
+                if (last_mid > 0.0 && ticker.mid_price > 0.0) {
+                    double* rolling = header + VOLATILITY_WINDOW;
+                    rollingPush(rolling, block + indicator.ring, window, ticker.mid_price / last_mid - 1.0);
+                    output[0] = rolling[COUNT] == window ? rollingStdDev(rolling) : NOT_READY;
+                }
+                header[LAST_MID] = ticker.mid_price;
+                break;
+            }
+            
+            case IndicatorType::RSI: {
+                if (header[LAST_PRICE] > 0.0) {
+                    double change = ticker.price - header[LAST_PRICE];
+                    double gain = change > 0 ? change : 0.0;
+                    double loss = change < 0 ? -change : 0.0;
+                    double changes = header[CHANGES] + 1;
+                    // Simple average over the first period, Wilder smoothing after
+                    double divisor = changes < window ? changes : static_cast<double>(window);
+                    header[AVG_GAIN] += (gain - header[AVG_GAIN]) / divisor;
+                    header[AVG_LOSS] += (loss - header[AVG_LOSS]) / divisor;
+                    header[CHANGES] = changes;
+                    if (changes >= window) {
+                        double avg_gain = header[AVG_GAIN];
+                        double avg_loss = header[AVG_LOSS];
+                        output[0] = avg_loss > 0.0 ? 100.0 - 100.0 / (1.0 + avg_gain / avg_loss)
+                                                   : (avg_gain > 0.0 ? 100.0 : 50.0);
+                    }
+                }
+                header[LAST_PRICE] = ticker.price;
+                break;
+            }
+            
+            case IndicatorType::SPREAD_EMA: {
+                double spread = ticker.best_ask - ticker.best_bid;
+                if (header[SPREAD_INITIALIZED] == 0.0) {
+                    header[SPREAD_EMA_VALUE] = spread;
+                    header[SPREAD_INITIALIZED] = 1.0;
+                } else {
+                    double alpha = 2.0 / (window + 1.0);
+                    header[SPREAD_EMA_VALUE] = spread * alpha + header[SPREAD_EMA_VALUE] * (1.0 - alpha);
+                }
+                output[0] = header[SPREAD_EMA_VALUE];
+                break;
+            }
+        }
+    }
+    
+    ticker.indicator_values = block;
+    ticker.indicator_count = columns.size();
+}
+
+std::string IndicatorEngine::layoutSignature(const ProductIndicators& product) {
+    std::string signature;
+    for (const auto& indicator : product.indicators) {
+        signature += std::to_string(static_cast<int>(indicator.type)) + ":" + std::to_string(indicator.window) + ":" +
+                     std::to_string(indicator.width) + "@" + std::to_string(indicator.column) + ";";
+    }
+    return signature;
+}
+
+void IndicatorEngine::saveState(CheckpointWriter& out) const {
+    out.put(static_cast<uint32_t>(products.size()));
+    for (const auto& entry : product_index) {
+        const ProductIndicators& product = products[entry.second];
+        out.putString(entry.first);
+        out.putString(layoutSignature(product));
+        out.putDoubles(product.block.data(), product.block.size());
+    }
+}
+
+IndicatorEngine::SavedState IndicatorEngine::readState(CheckpointReader& in) {
+    SavedState state;
+    uint32_t count = in.get<uint32_t>();
+    for (uint32_t i = 0; i < count; ++i) {
+        SavedProduct saved;
+        saved.product_id = in.getString();
+        saved.signature = in.getString();
+        saved.block = in.getDoubles();
+        state.push_back(std::move(saved));
+    }
+    return state;
+}
+
+size_t IndicatorEngine::restoreState(const SavedState& state) {
+    size_t restored = 0;
+    for (const auto& saved : state) {
+        ProductIndicators& product = products[productFor(saved.product_id)];
+        if (saved.signature == layoutSignature(product) && saved.block.size() == product.block.size()) {
+            std::copy(saved.block.begin(), saved.block.end(), product.block.begin());
+            restored++;
+        }
+    }
+    return restored;
+}
\ No newline at end of file
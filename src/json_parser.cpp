@@ -1,33 +1,291 @@
 #include "json_parser.h"
+#include "allocation_counter.h"
+#include "tracepoints.h"
 #include <stdexcept>
+#include <charconv>
+
+namespace {
+
+enum class ValueKind {
+    STRING,
+    NUMBER,
+    LITERAL
+};
+
+struct FieldView {
+    std::string_view value;
+    ValueKind kind = ValueKind::LITERAL;
+    bool present = false;
+};
+
+struct TickerFieldViews {
+    FieldView type;
+    FieldView product_id;
+    FieldView price;
+    FieldView best_bid;
+    FieldView best_ask;
+    FieldView time;
+    FieldView sequence;
+};
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void skipWhitespace(std::string_view s, size_t& pos) {
+    while (pos < s.size() && isWhitespace(s[pos])) {
+        ++pos;
+    }
+}
+
+// Reads a string token starting at the opening quote. Escaped strings are left to nlohmann.
+bool scanString(std::string_view s, size_t& pos, std::string_view& out) {
+    size_t start = ++pos;
+    while (pos < s.size()) {
+        char c = s[pos];
+        if (c == '"') {
+            out = s.substr(start, pos - start);
+            ++pos;
+            return true;
+        }
+        if (c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        }
+        ++pos;
+    }
+    return false;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+bool isJSONNumber(std::string_view token) {
+    size_t pos = 0;
+    if (pos < token.size() && token[pos] == '-') ++pos;
+    if (pos >= token.size()) return false;
+    if (token[pos] == '0') {
+        ++pos;
+    } else if (isDigit(token[pos])) {
+        while (pos < token.size() && isDigit(token[pos])) ++pos;
+    } else {
+        return false;
+    }
+    if (pos < token.size() && token[pos] == '.') {
+        size_t digits_start = ++pos;
+        while (pos < token.size() && isDigit(token[pos])) ++pos;
+        if (pos == digits_start) return false;
+    }
+    if (pos < token.size() && (token[pos] == 'e' || token[pos] == 'E')) {
+        ++pos;
+        if (pos < token.size() && (token[pos] == '+' || token[pos] == '-')) ++pos;
+        size_t digits_start = pos;
+        while (pos < token.size() && isDigit(token[pos])) ++pos;
+        if (pos == digits_start) return false;
+    }
+    return pos == token.size();
+}
+
+bool scanScalar(std::string_view s, size_t& pos, FieldView& out) {
+    size_t start = pos;
+    while (pos < s.size() && s[pos] != ',' && s[pos] != '}' && !isWhitespace(s[pos])) {
+        ++pos;
+    }
+    out.value = s.substr(start, pos - start);
+    
+    if (out.value == "true" || out.value == "false" || out.value == "null") {
+        out.kind = ValueKind::LITERAL;
+        return true;
+    }
+    out.kind = ValueKind::NUMBER;
+    return isJSONNumber(out.value);
+}
+
+FieldView* fieldFor(TickerFieldViews& fields, std::string_view key) {
+    if (key == "type") return &fields.type;
+    if (key == "product_id") return &fields.product_id;
+    if (key == "price") return &fields.price;
+    if (key == "best_bid") return &fields.best_bid;
+    if (key == "best_ask") return &fields.best_ask;
+    if (key == "time") return &fields.time;
+    if (key == "sequence") return &fields.sequence;
+    return nullptr;
+}
+
+// Walks a flat object of scalar values without building a DOM. Anything else
+// (nesting, escapes, malformed input) returns false so the caller can fall back.
+bool scanFlatObject(std::string_view s, TickerFieldViews& fields) {
+    size_t pos = 0;
+    skipWhitespace(s, pos);
+    if (pos >= s.size() || s[pos] != '{') return false;
+    ++pos;
+    skipWhitespace(s, pos);
+    
+    if (pos < s.size() && s[pos] == '}') {
+        ++pos;
+    } else {
+        while (true) {
+            std::string_view key;
+            if (pos >= s.size() || s[pos] != '"' || !scanString(s, pos, key)) return false;
+            
+            skipWhitespace(s, pos);
+            if (pos >= s.size() || s[pos] != ':') return false;
+            ++pos;
+            skipWhitespace(s, pos);
+            if (pos >= s.size()) return false;
+            
+            FieldView value;
+            if (s[pos] == '"') {
+                if (!scanString(s, pos, value.value)) return false;
+                value.kind = ValueKind::STRING;
+            } else if (!scanScalar(s, pos, value)) {
+                return false;
+            }
+            value.present = true;
+            
+            if (FieldView* field = fieldFor(fields, key)) {
+                *field = value;
+            }
+            
+            skipWhitespace(s, pos);
+            if (pos >= s.size()) return false;
+            if (s[pos] == ',') {
+                ++pos;
+                skipWhitespace(s, pos);
+                continue;
+            }
+            if (s[pos] != '}') return false;
+            ++pos;
+            break;
+        }
+    }
+    
+    skipWhitespace(s, pos);
+    return pos == s.size();
+}
+
+bool toDouble(std::string_view text, double& out) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// Same rules as JSONParser::parseSequence: unsigned integers only, anything else is 0
+uint64_t toSequence(const FieldView& field) {
+    uint64_t value = 0;
+    if (field.kind != ValueKind::NUMBER) return 0;
+    auto result = std::from_chars(field.value.data(), field.value.data() + field.value.size(), value);
+    return result.ec == std::errc() && result.ptr == field.value.data() + field.value.size() ? value : 0;
+}
+
+// Same rules as JSONParser::parsePrice; unusual text is left to the std::stod path
+bool toPrice(const FieldView& field, double& out) {
+    switch (field.kind) {
+        case ValueKind::STRING:
+        case ValueKind::NUMBER:
+            return toDouble(field.value, out);
+        case ValueKind::LITERAL:
+            out = 0.0;
+            return true;
+    }
+    return false;
+}
+
+} // namespace
 
 JSONParser::JSONParser(Logger& log) : logger(log) {}
 
-TickerData JSONParser::parseTickerMessage(const std::string& json_string) {
+TickerData JSONParser::parseTickerMessage(std::string_view json_string) {
+    TickerData ticker;
+    parseTickerMessage(json_string, ticker);
+    return ticker;
+}
+
+void JSONParser::parseTickerMessage(std::string_view json_string, TickerData& ticker) {
+    AllocationScope scope(AllocationTag::PARSE);
+    HFT_TRACE1(parse_start, json_string.size());
+    if (scanTickerMessage(json_string, ticker)) {
+        HFT_TRACE2(parse_end, ticker.product_id.c_str(), 1);
+        return;
+    }
+    
     try {
-        nlohmann::json j = nlohmann::json::parse(json_string);
-        
-        if (!validateTickerJSON(j)) {
-            throw std::invalid_argument("Invalid ticker JSON structure");
-        }
-        
-        TickerData ticker;
-        ticker.type = parseString(j, "type");
-        ticker.product_id = parseString(j, "product_id");
-        ticker.price = parsePrice(j, "price");
-        ticker.best_bid = parsePrice(j, "best_bid");
-        ticker.best_ask = parsePrice(j, "best_ask");
-        ticker.time = parseString(j, "time");
-        ticker.timestamp = std::chrono::system_clock::now();
-        
-        ticker.calculateMidPrice();
-        
-        return ticker;
-        
+        parseTickerDocument(json_string, ticker);
     } catch (const std::exception& e) {
         logger.error("JSON parsing failed: " + std::string(e.what()));
         throw;
     }
+    HFT_TRACE2(parse_end, ticker.product_id.c_str(), 2);
+}
+
+void JSONParser::parseTickerMessageQuietly(std::string_view json_string, TickerData& ticker) {
+    AllocationScope scope(AllocationTag::PARSE);
+    if (!scanTickerMessage(json_string, ticker)) {
+        parseTickerDocument(json_string, ticker);
+    }
+}
+
+bool JSONParser::scanTickerMessage(std::string_view json_string, TickerData& ticker) const {
+    TickerFieldViews fields;
+    if (!scanFlatObject(json_string, fields)) {
+        return false;
+    }
+    
+    // Anything the document path would reject or treat specially is left to it
+    if (!fields.type.present || !fields.product_id.present || !fields.price.present ||
+        !fields.best_bid.present || !fields.best_ask.present) {
+        return false;
+    }
+    if (fields.type.kind != ValueKind::STRING || fields.type.value != "ticker" ||
+        fields.product_id.kind != ValueKind::STRING ||
+        (fields.time.present && fields.time.kind != ValueKind::STRING)) {
+        return false;
+    }
+    
+    double price = 0.0;
+    double best_bid = 0.0;
+    double best_ask = 0.0;
+    if (!toPrice(fields.price, price) || !toPrice(fields.best_bid, best_bid) ||
+        !toPrice(fields.best_ask, best_ask)) {
+        return false;
+    }
+    
+    ticker.type.assign(fields.type.value.data(), fields.type.value.size());
+    ticker.product_id.assign(fields.product_id.value.data(), fields.product_id.value.size());
+    ticker.price = price;
+    ticker.best_bid = best_bid;
+    ticker.best_ask = best_ask;
+    ticker.time.assign(fields.time.value.data(), fields.time.value.size());
+    ticker.exchange_sequence = toSequence(fields.sequence);
+    ticker.timestamp = std::chrono::system_clock::now();
+    ticker.price_ema = 0.0;
+    ticker.mid_price_ema = 0.0;
+    ticker.sequence_number = 0;
+    
+    ticker.calculateMidPrice();
+    return true;
+}
+
+void JSONParser::parseTickerDocument(std::string_view json_string, TickerData& ticker) {
+    nlohmann::json j = nlohmann::json::parse(json_string.begin(), json_string.end());
+    
+    if (!validateTickerJSON(j)) {
+        throw NotATickerError("Invalid ticker JSON structure");
+    }
+    
+    ticker.type = parseString(j, "type");
+    ticker.product_id = parseString(j, "product_id");
+    ticker.price = parsePrice(j, "price");
+    ticker.best_bid = parsePrice(j, "best_bid");
+    ticker.best_ask = parsePrice(j, "best_ask");
+    ticker.time = parseString(j, "time");
+    ticker.exchange_sequence = parseSequence(j);
+    ticker.timestamp = std::chrono::system_clock::now();
+    ticker.price_ema = 0.0;
+    ticker.mid_price_ema = 0.0;
+    ticker.sequence_number = 0;
+    
+    ticker.calculateMidPrice();
 }
 
 bool JSONParser::validateTickerJSON(const nlohmann::json& j) const {
@@ -45,7 +303,13 @@ double JSONParser::parsePrice(const nlohmann::json& j, const std::string& field)
     }
     
     if (j[field].is_string()) {
-        return std::stod(j[field].get<std::string>());
+        const std::string& text = j[field].get_ref<const std::string&>();
+        try {
+            return std::stod(text);
+        } catch (const std::logic_error&) {
+            // std::stod throws invalid_argument or out_of_range
+            throw FieldTypeError("Field " + field + " is not a number: " + text);
+        }
     } else if (j[field].is_number()) {
         return j[field].get<double>();
     }
@@ -53,10 +317,15 @@ double JSONParser::parsePrice(const nlohmann::json& j, const std::string& field)
     return 0.0;
 }
 
+uint64_t JSONParser::parseSequence(const nlohmann::json& j) const {
+    auto it = j.find("sequence");
+    return it != j.end() && it->is_number_unsigned() ? it->get<uint64_t>() : 0;
+}
+
 std::string JSONParser::parseString(const nlohmann::json& j, const std::string& field) const {
     if (!j.contains(field)) {
         return "";
     }
     
     return j[field].get<std::string>();
-}
\ No newline at end of file
+}
@@ -3,90 +3,220 @@
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <cstdint>
+#include <filesystem>
 #include <sstream>
 
-Logger::Logger(const std::string& log_filename, const std::string& test_log_filename, LogLevel level)
-    : min_level(level) {
+namespace {
+
+int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+Logger::Logger(const std::string& log_filename, const std::string& test_log_filename, LogLevel level,
+               FileSinkBackend backend, LogFormat log_format)
+    : min_level(level), format(log_format) {
+    
+    // The application log is appended to; a new binary file starts with the magic
+    std::error_code ec;
+    bool log_file_empty = log_filename.empty() || !std::filesystem::exists(log_filename, ec) ||
+                          std::filesystem::file_size(log_filename, ec) == 0;
+    log_file = openFileSink(log_filename, true, backend);
+    test_log_file = openFileSink(test_log_filename, false, backend);
     
-    log_file.open(log_filename, std::ios::app);
-    test_log_file.open(test_log_filename, std::ios::out);
+    if (format == LogFormat::BINARY) {
+        if (log_file->isOpen()) {
+            startSession(*log_file, log_session, log_file_empty);
+        }
+        if (test_log_file->isOpen()) {
+            startSession(*test_log_file, test_session, true);
+        }
+    }
     
-    if (log_file.is_open()) {
+    if (log_file->isOpen()) {
         log(LogLevel::INFO, "=== HFT Application Started ===");
     }
     
-    if (test_log_file.is_open()) {
-        test_log_file << "=== TEST VERIFICATION LOG ===\n";
-        test_log_file << "Generated at: " << getCurrentTimestampMicroseconds() << "\n";
-        test_log_file << "Application: Coinbase HFT Ticker\n";
-        test_log_file << "================================\n\n";
-        test_log_file.flush();
+    if (test_log_file->isOpen()) {
+        writeText(*test_log_file, "=== TEST VERIFICATION LOG ===\n"
+                                  "Generated at: " + getCurrentTimestampMicroseconds() + "\n"
+                                  "Application: Coinbase HFT Ticker\n"
+                                  "================================\n\n");
+        test_log_file->flush();
     }
 }
 
 Logger::~Logger() {
-    if (log_file.is_open()) {
+    if (log_file->isOpen()) {
         log(LogLevel::INFO, "=== HFT Application Ended ===");
-        log_file.close();
+        log_file->close();
     }
     
-    if (test_log_file.is_open()) {
-        test_log_file << "\n=== END OF TEST LOG ===\n";
-        test_log_file.close();
+    if (test_log_file->isOpen()) {
+        writeText(*test_log_file, "\n=== END OF TEST LOG ===\n");
+        test_log_file->close();
     }
 }
 
 void Logger::log(LogLevel level, const std::string& message) {
     if (level < min_level) return;
+    AllocationScope scope(AllocationTag::LOGGER);
     
-    std::lock_guard<std::mutex> lock(log_mutex);
+    if (format == LogFormat::BINARY) {
+        std::string& arguments = argumentBuffer();
+        arguments.clear();
+        binlog::encodeArgument(arguments, message);
+        logEncoded(level, binlog::MESSAGE, arguments);
+        return;
+    }
+    
+    writeLine(level, message);
+}
+
+void Logger::logTest(const std::string& test_name, const std::string& result, const std::string& details) {
+    AllocationScope scope(AllocationTag::LOGGER);
+    std::string& buffer = argumentBuffer();
+    buffer.clear();
+    if (format == LogFormat::BINARY) {
+        binlog::encodeArguments(buffer, test_name, result);
+        if (!details.empty()) {
+            binlog::encodeArgument(buffer, details);
+        }
+        logTestEncoded(details.empty() ? binlog::TEST : binlog::TEST_DETAILS, buffer);
+        return;
+    }
     
-    std::string timestamp = getCurrentTimestampMicroseconds();
-    std::string level_str = levelToString(level);
-    std::string log_line = "[" + timestamp + "] [" + level_str + "] " + message;
+    buffer += "TEST: ";
+    buffer += test_name;
+    buffer += " - ";
+    buffer += result;
+    if (!details.empty()) {
+        buffer += " | Details: ";
+        buffer += details;
+    }
+    writeTestLine(buffer);
+}
+
+void Logger::writeLine(LogLevel level, std::string_view message) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    line_buffer.clear();
+    line_buffer += '[';
+    binlog::appendTimestamp(line_buffer, nowMicros());
+    line_buffer += "] [";
+    line_buffer += binlog::levelName(static_cast<uint8_t>(level));
+    line_buffer += "] ";
+    line_buffer.append(message.data(), message.size());
+    line_buffer += '\n';
     
     // Log to file
-    if (log_file.is_open()) {
-        log_file << log_line << std::endl;
-        log_file.flush();
+    if (log_file->isOpen()) {
+        log_file->write(line_buffer.data(), line_buffer.size());
+        log_file->flush();
     }
     
     // Log to console
-    std::cout << log_line << std::endl;
+    std::cout.write(line_buffer.data(), static_cast<std::streamsize>(line_buffer.size()));
+    std::cout.flush();
 }
 
-void Logger::logTest(const std::string& test_name, const std::string& result, const std::string& details) {
+void Logger::writeTestLine(std::string_view line) {
     std::lock_guard<std::mutex> lock(log_mutex);
+    if (!test_log_file->isOpen()) return;
     
-    if (test_log_file.is_open()) {
-        test_log_file << "[" << getCurrentTimestampMicroseconds() << "] ";
-        test_log_file << "TEST: " << test_name << " - " << result;
-        if (!details.empty()) {
-            test_log_file << " | Details: " << details;
-        }
-        test_log_file << std::endl;
-        test_log_file.flush();
+    line_buffer.clear();
+    line_buffer += '[';
+    binlog::appendTimestamp(line_buffer, nowMicros());
+    line_buffer += "] ";
+    line_buffer.append(line.data(), line.size());
+    line_buffer += '\n';
+    test_log_file->write(line_buffer.data(), line_buffer.size());
+    test_log_file->flush();
+}
+
+void Logger::logTestEncoded(const LogTemplate& line, const std::string& arguments) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (test_log_file->isOpen()) {
+        writeRecord(*test_log_file, test_session, binlog::TEST_LEVEL, line, arguments);
+    }
+}
+
+void Logger::logEncoded(LogLevel level, const LogTemplate& message, const std::string& arguments) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (log_file->isOpen()) {
+        writeRecord(*log_file, log_session, static_cast<uint8_t>(level), message, arguments);
+    }
+    
+    // Only what needs attention is formatted for the console
+    if (level >= LogLevel::WARNING) {
+        std::string text;
+        binlog::render(text, message.getFormat(), arguments);
+        std::cout << "[" << getCurrentTimestampMicroseconds() << "] [" << levelToString(level) << "] " << text << std::endl;
     }
 }
 
+void Logger::startSession(FileSink& sink, BinarySession& session, bool write_magic) {
+    std::string header;
+    if (write_magic) {
+        binlog::putRaw(header, binlog::MAGIC, sizeof(binlog::MAGIC));
+    }
+    session.last_timestamp = nowMicros();
+    header += 'B';
+    binlog::putRaw(header, &session.last_timestamp, sizeof(session.last_timestamp));
+    sink.write(header);
+}
 
-std::string Logger::getCurrentTimestampMicroseconds() const {
-    auto now = std::chrono::system_clock::now();
+void Logger::writeRecord(FileSink& sink, BinarySession& session, uint8_t level, const LogTemplate& message,
+                         const std::string& arguments) {
+    record_buffer.clear();
     
-    auto time_since_epoch = now.time_since_epoch();
-    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time_since_epoch);
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(time_since_epoch) - 
-                       std::chrono::duration_cast<std::chrono::microseconds>(seconds);
+    uint32_t id = message.getId();
+    if (id >= session.defined.size()) {
+        session.defined.resize(id + 1, false);
+    }
+    if (!session.defined[id]) {
+        std::string_view text = message.getFormat();
+        record_buffer += 'T';
+        binlog::putVarint(record_buffer, id);
+        binlog::putVarint(record_buffer, text.size());
+        record_buffer.append(text.data(), text.size());
+        session.defined[id] = true;
+    }
     
-    auto time_t_val = std::chrono::system_clock::to_time_t(now);
+    int64_t timestamp = nowMicros();
+    record_buffer += 'L';
+    binlog::putVarint(record_buffer, binlog::zigzag(timestamp - session.last_timestamp));
+    record_buffer += static_cast<char>(level);
+    binlog::putVarint(record_buffer, id);
+    binlog::putVarint(record_buffer, arguments.size());
+    record_buffer += arguments;
+    session.last_timestamp = timestamp;
     
-    char buffer[64];
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&time_t_val));
+    sink.write(record_buffer);
+    sink.flush();
+}
 
-    std::ostringstream oss;
-    oss << buffer << "." << std::setfill('0') << std::setw(6) << microseconds.count();
-    
-    return oss.str();
+void Logger::writeText(FileSink& sink, const std::string& text) {
+    if (format == LogFormat::TEXT) {
+        sink.write(text);
+        return;
+    }
+    std::string record(1, 'R');
+    binlog::putVarint(record, text.size());
+    record += text;
+    sink.write(record);
+}
+
+std::string& Logger::argumentBuffer() {
+    // Reused per thread so a templated message costs no allocation once warm
+    thread_local std::string buffer;
+    return buffer;
+}
+
+std::string Logger::getCurrentTimestampMicroseconds() const {
+    return binlog::formatTimestamp(nowMicros());
 }
 
 std::string Logger::getCurrentTimestamp() const {
@@ -94,11 +224,5 @@ std::string Logger::getCurrentTimestamp() const {
 }
 
 std::string Logger::levelToString(LogLevel level) const {
-    switch (level) {
-        case LogLevel::DEBUG: return "DEBUG";
-        case LogLevel::INFO: return "INFO";
-        case LogLevel::WARNING: return "WARN";
-        case LogLevel::ERROR: return "ERROR";
-        default: return "UNKNOWN";
-    }
-}
\ No newline at end of file
+    return binlog::levelName(static_cast<uint8_t>(level));
+}
@@ -1,9 +1,11 @@
 #include "logger.h"
+#include "allocation_counter.h"
 #include "test_runner.h"
 #include "hft_processor.h"
+#include "metrics_server.h"
+#include "shutdown_signal.h"
 #include <iostream>
 #include <thread>
-#include <csignal>
 #include <chrono>
 
 #ifdef _WIN32
@@ -12,18 +14,6 @@
 #pragma comment(lib, "ws2_32.lib")
 #endif
 
-// Global variables for signal handling
-static bool g_running = true;
-static HFTProcessor* g_processor = nullptr;
-
-void signalHandler(int signal) {
-    std::cout << "\nReceived signal " << signal << ". Shutting down..." << std::endl;
-    g_running = false;
-    if (g_processor) {
-        g_processor->stop();
-    }
-}
-
 #ifdef _WIN32
 class WSAInitializer {
 public:
@@ -50,10 +40,13 @@ int main() {
         WSAInitializer wsa_init;
 #endif
         
-        std::signal(SIGINT, signalHandler);
-        std::signal(SIGTERM, signalHandler);
-        
-        Logger logger("hft_app.log", "test_verification.log", LogLevel::INFO);
+        // LogFormat::BINARY writes template IDs and raw arguments instead of text
+        // lines; read hft_app.blog and test_verification.blog with tools/log_decode
+        const LogFormat log_format = LogFormat::TEXT;
+        const bool binary_log = log_format == LogFormat::BINARY;
+        Logger logger(binary_log ? "hft_app.blog" : "hft_app.log",
+                      binary_log ? "test_verification.blog" : "test_verification.log",
+                      LogLevel::INFO, FileSinkBackend::AUTO, log_format);
         
         logger.info("=== Coinbase HFT Ticker Application ===");
         
@@ -63,6 +56,19 @@ int main() {
             TestRunner test_runner(logger);
             test_runner.runAllTests();
             
+            // From here SIGINT/SIGTERM only wake the loop below; shutdown runs on this thread.
+            // During the tests there is nothing to drain, so the default action is fine.
+            ShutdownSignal shutdown;
+            
+            // Charges heap use to receive/parse/process/CSV/logger from here on; logged with
+            // the periodic and final statistics. Costs a plain load and store to a per-thread
+            // counter per allocation and free (the 16-byte block header is there either way),
+            // and a warm tick path barely allocates.
+            const bool allocation_accounting = true;
+            if (allocation_accounting) {
+                AllocationCounter::enableAccounting();
+            }
+            
             // DEFINE PRODUCT HERE
             std::string target_product = "BTC-USD";  //CHANGE THIS LINE FOR DIFFERENT PRODUCTS
             // std::string target_product = "ETH-USD";  // Uncomment for Ethereum
@@ -71,7 +77,10 @@ int main() {
             // Initialize HFT processor
             logger.info("Initializing HFT processor for " + target_product + " trading pair");
             HFTProcessor processor(target_product, logger);
-            g_processor = &processor;
+            
+            // Prometheus scrape endpoint on loopback
+            MetricsServer metrics_server(9464, logger);
+            metrics_server.start();
             
             // Display startup information with dynamic product name
             logger.info("=== APPLICATION STARTUP ===");
@@ -80,8 +89,11 @@ int main() {
             logger.info("EMA calculation: With every message (Option B)");
             logger.info("Output files:");
             logger.info("  - ticker_data.csv (" + target_product + " market data)");
+            logger.info("    rolled hourly or at 256 MB into ticker_data_<UTC time>.csv.gz");
             logger.info("  - hft_app.log (application logs)");
             logger.info("  - test_verification.log (test results)");
+            logger.info("  - hft_state.ckpt (EMA/indicator checkpoint, restored if under 5 minutes old)");
+            logger.info("Metrics: http://127.0.0.1:" + std::to_string(metrics_server.getPort()) + "/metrics");
             logger.info("Press Ctrl+C for graceful shutdown");
             logger.info("================================");
             
@@ -89,30 +101,38 @@ int main() {
             logger.info("Starting real-time market data processing for " + target_product + "..."); 
             processor.start();
             
-            // Keep main thread alive and log periodic statistics
+            // Log periodic statistics every 30 seconds until a shutdown signal arrives;
+            // in the coroutine mode the processor reports them from a timer of its own
             auto start_time = std::chrono::steady_clock::now();
-            while (g_running) {
-                std::this_thread::sleep_for(std::chrono::seconds(30));
-                
-                // Log periodic statistics every 30 seconds
-                if (g_running) {
-                    auto elapsed = std::chrono::duration_cast<std::chrono::minutes>(
-                        std::chrono::steady_clock::now() - start_time).count();
-                    
-                    logger.info("Runtime: " + std::to_string(elapsed) + " minutes | " +
-                               target_product + " messages processed: " + std::to_string(processor.getTotalMessagesProcessed()) + " | " +  // ✅ Dynamic!
-                               "EMA updates: " + std::to_string(processor.getEMAUpdatesCount()));
+            while (!shutdown.wait(std::chrono::seconds(30))) {
+                if (!processor.reportsProgress()) {
+                    processor.logProgress();
                 }
             }
             
-            // Graceful shutdown
-            logger.info("Initiating graceful shutdown for " + target_product + "...");
+            // Graceful shutdown: stop intake, drain, flush
+            std::cout << "\nReceived signal " << shutdown.getSignal() << ". Shutting down..." << std::endl;
+            logger.info("Received signal " + std::to_string(shutdown.getSignal()) + 
+                       "; initiating graceful shutdown for " + target_product + "...");
             processor.stop();
+            metrics_server.stop();
+            
+            const ShutdownTimings& timings = processor.getShutdownTimings();
+            double signal_to_stopped_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - shutdown.getRequestedAt()).count();
+            logger.info("Shutdown took " + std::to_string(signal_to_stopped_ms) + " ms from the signal (phases " +
+                       std::to_string(timings.totalMs()) + " ms)");
+            logger.logTest("SHUTDOWN_LATENCY", "INFO", std::to_string(signal_to_stopped_ms) + " ms from signal to stopped");
             
             // Final statistics for verification
             logger.info("=== FINAL STATISTICS FOR " + target_product + " ==="); 
             logger.info("Total messages processed: " + std::to_string(processor.getTotalMessagesProcessed()));
             logger.info("EMA updates performed: " + std::to_string(processor.getEMAUpdatesCount()));
+            if (AllocationCounter::accountingEnabled()) {
+                AllocationStats heap = AllocationCounter::total();
+                logger.info("Heap allocations since startup: " + std::to_string(heap.allocations) + " | Still live: " +
+                           std::to_string(heap.liveBytes() / 1024) + " KiB in " + std::to_string(heap.liveBlocks()) + " blocks");
+            }
             
             auto end_time = std::chrono::steady_clock::now();
             auto total_runtime = std::chrono::duration_cast<std::chrono::minutes>(end_time - start_time).count();
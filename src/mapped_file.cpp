@@ -0,0 +1,90 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifdef HFT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::string& path) : data(nullptr), length(0), mapping(nullptr) {
+    if (endsWith(path, ".gz")) {
+#ifdef HFT_HAVE_ZLIB
+        gzFile input = gzopen(path.c_str(), "rb");
+        if (!input) {
+            throw std::runtime_error("Cannot open " + path);
+        }
+        gzbuffer(input, 1 << 17);
+        char buffer[1 << 16];
+        int n;
+        while ((n = gzread(input, buffer, sizeof(buffer))) > 0) {
+            inflated.insert(inflated.end(), buffer, buffer + n);
+        }
+        gzclose(input);
+        if (n < 0) {
+            throw std::runtime_error("Corrupt gzip file " + path);
+        }
+        data = inflated.data();
+        length = inflated.size();
+        return;
+#else
+        throw std::runtime_error("Built without zlib; decompress " + path + " first");
+#endif
+    }
+    
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat " + path);
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        // One sequential pass; let the kernel read ahead aggressively
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        mapping = mapped;
+        data = static_cast<const char*>(mapped);
+    }
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    inflated.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = inflated.data();
+    length = inflated.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapping) {
+        munmap(mapping, length);
+    }
+#endif
+}
@@ -0,0 +1,182 @@
+#include "metrics.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+
+const char* typeName(int type) {
+    switch (type) {
+        case 0: return "counter";
+        case 1: return "gauge";
+        default: return "histogram";
+    }
+}
+
+std::string formatValue(double value) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+std::string withLabels(const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+} // namespace
+
+MetricHistogram::MetricHistogram(std::vector<uint64_t> upper_bounds, double value_scale)
+    : bounds(std::move(upper_bounds)), scale(value_scale) {
+    if (bounds.size() > METRIC_MAX_BUCKETS) {
+        throw std::invalid_argument("Too many histogram buckets");
+    }
+}
+
+std::vector<uint64_t> MetricHistogram::cumulativeCounts() const {
+    std::vector<uint64_t> counts(bounds.size() + 1, 0);
+    for (const auto& shard : shards) {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    for (size_t i = 1; i < counts.size(); ++i) {
+        counts[i] += counts[i - 1];
+    }
+    return counts;
+}
+
+uint64_t MetricHistogram::sum() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard.sum.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricsRegistry::MetricsRegistry() : next_collector_id(1) {}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry* MetricsRegistry::find(const std::string& name, const std::string& labels, MetricType type) {
+    for (auto& entry : entries) {
+        if (entry.name == name && entry.labels == labels) {
+            if (entry.type != type) {
+                throw std::invalid_argument("Metric " + name + " registered with a different type");
+            }
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (Entry* entry = find(name, labels, MetricType::COUNTER)) {
+        return *static_cast<MetricCounter*>(entry->metric);
+    }
+    counters.emplace_back();
+    entries.push_back({name, help, labels, MetricType::COUNTER, &counters.back()});
+    return counters.back();
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (Entry* entry = find(name, labels, MetricType::GAUGE)) {
+        return *static_cast<MetricGauge*>(entry->metric);
+    }
+    gauges.emplace_back();
+    entries.push_back({name, help, labels, MetricType::GAUGE, &gauges.back()});
+    return gauges.back();
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                            const std::vector<uint64_t>& upper_bounds, double scale,
+                                            const std::string& labels) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (Entry* entry = find(name, labels, MetricType::HISTOGRAM)) {
+        return *static_cast<MetricHistogram*>(entry->metric);
+    }
+    histograms.emplace_back(upper_bounds, scale);
+    entries.push_back({name, help, labels, MetricType::HISTOGRAM, &histograms.back()});
+    return histograms.back();
+}
+
+int MetricsRegistry::addCollector(std::function<void(std::string&)> collector) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int id = next_collector_id++;
+    collectors.emplace_back(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::removeCollector(int id) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto it = collectors.begin(); it != collectors.end(); ++it) {
+        if (it->first == id) {
+            collectors.erase(it);
+            return;
+        }
+    }
+}
+
+std::string MetricsRegistry::render() const {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::string out;
+    
+    // Prometheus wants each family's samples together, under one HELP/TYPE header
+    std::vector<bool> rendered(entries.size(), false);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (rendered[i]) continue;
+        const Entry& family = entries[i];
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + typeName(static_cast<int>(family.type)) + "\n";
+        
+        for (size_t j = i; j < entries.size(); ++j) {
+            const Entry& entry = entries[j];
+            if (rendered[j] || entry.name != family.name) continue;
+            rendered[j] = true;
+            
+            switch (entry.type) {
+                case MetricType::COUNTER:
+                    out += entry.name + withLabels(entry.labels) + " " +
+                           std::to_string(static_cast<const MetricCounter*>(entry.metric)->value()) + "\n";
+                    break;
+                case MetricType::GAUGE:
+                    out += entry.name + withLabels(entry.labels) + " " +
+                           formatValue(static_cast<const MetricGauge*>(entry.metric)->value()) + "\n";
+                    break;
+                case MetricType::HISTOGRAM: {
+                    const auto* histogram = static_cast<const MetricHistogram*>(entry.metric);
+                    std::vector<uint64_t> counts = histogram->cumulativeCounts();
+                    const auto& bounds = histogram->upperBounds();
+                    for (size_t b = 0; b < bounds.size(); ++b) {
+                        out += entry.name + "_bucket" + 
+                               withLabels(entry.labels, "le=\"" + formatValue(bounds[b] / histogram->getScale()) + "\"") +
+                               " " + std::to_string(counts[b]) + "\n";
+                    }
+                    out += entry.name + "_bucket" + withLabels(entry.labels, "le=\"+Inf\"") + " " + 
+                           std::to_string(counts.back()) + "\n";
+                    out += entry.name + "_sum" + withLabels(entry.labels) + " " + 
+                           formatValue(histogram->sum() / histogram->getScale()) + "\n";
+                    out += entry.name + "_count" + withLabels(entry.labels) + " " + 
+                           std::to_string(counts.back()) + "\n";
+                    break;
+                }
+            }
+        }
+    }
+    
+    for (const auto& collector : collectors) {
+        collector.second(out);
+    }
+    return out;
+}
+
+std::vector<uint64_t> latencyBucketsNs() {
+    return {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+            1000000, 2500000, 5000000, 10000000, 50000000, 100000000, 1000000000};
+}
@@ -0,0 +1,151 @@
+#include "metrics_server.h"
+#include <cstring>
+#include <string>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+MetricsServer::MetricsServer(uint16_t listen_port, Logger& log, MetricsRegistry& metrics)
+    : logger(log), registry(metrics), port(listen_port), listen_fd(-1), wake_pipe{-1, -1} {}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start() {
+    if (running) return true;
+    
+#ifndef _WIN32
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        logger.error("Metrics server socket() failed: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 8) != 0) {
+        logger.error("Metrics server bind/listen failed on port " + std::to_string(port) + ": " + std::strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    
+    socklen_t length = sizeof(address);
+    getsockname(listen_fd, reinterpret_cast<sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+    
+    if (pipe(wake_pipe) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    
+    running = true;
+    server_thread = std::thread(&MetricsServer::serverLoop, this);
+    logger.info("Metrics endpoint: http://127.0.0.1:" + std::to_string(port) + "/metrics");
+    return true;
+#else
+    logger.info("Metrics endpoint not available on this platform");
+    return false;
+#endif
+}
+
+void MetricsServer::stop() {
+    if (!running) return;
+    running = false;
+    
+#ifndef _WIN32
+    char wake_byte = 1;
+    if (write(wake_pipe[1], &wake_byte, 1) < 0) {
+        // The server is already awake
+    }
+    if (server_thread.joinable()) {
+        server_thread.join();
+    }
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = -1;
+    wake_pipe[0] = wake_pipe[1] = -1;
+#endif
+}
+
+void MetricsServer::serverLoop() {
+#ifndef _WIN32
+    while (running) {
+        pollfd fds[2] = {{wake_pipe[0], POLLIN, 0}, {listen_fd, POLLIN, 0}};
+        if (poll(fds, 2, 1000) <= 0) continue;
+        if (fds[0].revents & POLLIN) break;
+        
+        if (fds[1].revents & POLLIN) {
+            int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (client_fd >= 0) {
+                handleClient(client_fd);
+                close(client_fd);
+            }
+        }
+    }
+#endif
+}
+
+void MetricsServer::handleClient(int client_fd) {
+#ifndef _WIN32
+    // A stalled client must not hold up the next scrape for long
+    timeval timeout{1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, n);
+    }
+    
+    std::string status = "200 OK";
+    std::string content_type = "text/plain; version=0.0.4; charset=utf-8";
+    std::string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+        body = registry.render();
+        scrapes++;
+    } else if (request.compare(0, 4, "GET ") == 0) {
+        status = "404 Not Found";
+        body = "Try /metrics\n";
+    } else {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    }
+    
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: " + content_type + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client_fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += static_cast<size_t>(n);
+    }
+#else
+    (void)client_fd;
+#endif
+}
@@ -0,0 +1,115 @@
+#include "segment_compressor.h"
+#include "allocation_counter.h"
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#ifdef HFT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+SegmentCompressor::SegmentCompressor(Logger& log) : logger(log), stopping(false) {
+    worker = std::thread(&SegmentCompressor::workerLoop, this);
+}
+
+SegmentCompressor::~SegmentCompressor() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_one();
+    
+    // Pending segments are finished first so nothing is left uncompressed
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool SegmentCompressor::isAvailable() {
+#ifdef HFT_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SegmentCompressor::enqueue(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        pending.push_back(path);
+    }
+    queue_cv.notify_one();
+}
+
+void SegmentCompressor::workerLoop() {
+    AllocationScope scope(AllocationTag::CSV);
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            path = std::move(pending.front());
+            pending.pop_front();
+        }
+        
+        if (compressFile(path)) {
+            segments_compressed++;
+        }
+    }
+}
+
+bool SegmentCompressor::compressFile(const std::string& path) {
+#ifdef HFT_HAVE_ZLIB
+    const std::string gz_path = path + ".gz";
+    
+    FILE* input = std::fopen(path.c_str(), "rb");
+    if (!input) {
+        logger.error("Cannot open segment for compression: " + path);
+        return false;
+    }
+    
+    gzFile output = gzopen(gz_path.c_str(), "wb6");
+    if (!output) {
+        std::fclose(input);
+        logger.error("Cannot create compressed segment: " + gz_path);
+        return false;
+    }
+    
+    std::vector<char> buffer(1 << 16);
+    size_t total_in = 0;
+    bool ok = true;
+    size_t read_bytes;
+    while ((read_bytes = std::fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+        if (gzwrite(output, buffer.data(), static_cast<unsigned>(read_bytes)) != static_cast<int>(read_bytes)) {
+            ok = false;
+            break;
+        }
+        total_in += read_bytes;
+    }
+    ok = ok && !std::ferror(input);
+    std::fclose(input);
+    ok = (gzclose(output) == Z_OK) && ok;
+    
+    std::error_code ec;
+    if (!ok) {
+        std::filesystem::remove(gz_path, ec);
+        logger.error("Compression failed, keeping uncompressed segment: " + path);
+        return false;
+    }
+    
+    size_t total_out = static_cast<size_t>(std::filesystem::file_size(gz_path, ec));
+    std::filesystem::remove(path, ec);
+    bytes_in += total_in;
+    bytes_out += total_out;
+    
+    logger.info("Compressed segment " + gz_path + " (" + std::to_string(total_in) + " -> " + 
+               std::to_string(total_out) + " bytes)");
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
@@ -0,0 +1,120 @@
+#include "shared_tick_publisher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedTickPublisher::SharedTickPublisher(const std::string& name, Logger& log)
+    : logger(log), segment_name(name), segment(nullptr), 
+      last_slot(0), ticks_published(0) {
+    
+#ifndef _WIN32
+    // Start from a fresh segment so readers never see a previous run's slots
+    shm_unlink(segment_name.c_str());
+    int fd = shm_open(segment_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        logger.warning("Shared-memory publisher disabled, shm_open failed for " + segment_name + 
+                       ": " + std::strerror(errno));
+        return;
+    }
+    
+    if (ftruncate(fd, sizeof(SharedTickSegment)) != 0) {
+        logger.warning("Shared-memory publisher disabled, ftruncate failed: " + std::string(std::strerror(errno)));
+        close(fd);
+        shm_unlink(segment_name.c_str());
+        return;
+    }
+    
+    void* mapped = mmap(nullptr, sizeof(SharedTickSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        logger.warning("Shared-memory publisher disabled, mmap failed: " + std::string(std::strerror(errno)));
+        shm_unlink(segment_name.c_str());
+        return;
+    }
+    
+    // ftruncate zero-fills, so every slot starts at version 0 (never written)
+    segment = new (mapped) SharedTickSegment;
+    segment->header.layout_version = SHARED_TICK_LAYOUT_VERSION;
+    segment->header.capacity = SHARED_TICK_MAX_PRODUCTS;
+    segment->header.product_count.store(0, std::memory_order_relaxed);
+    segment->header.magic.store(SHARED_TICK_MAGIC, std::memory_order_release);
+    
+    logger.info("Shared-memory tick publisher ready: " + segment_name);
+#else
+    logger.info("Shared-memory tick publisher not available on this platform");
+#endif
+}
+
+SharedTickPublisher::~SharedTickPublisher() {
+#ifndef _WIN32
+    if (segment) {
+        munmap(segment, sizeof(SharedTickSegment));
+        shm_unlink(segment_name.c_str());
+        segment = nullptr;
+    }
+#endif
+}
+
+void SharedTickPublisher::publish(const TickerData& ticker) {
+    if (!segment) return;
+    
+    SharedTickSlot* slot = slotFor(ticker.product_id);
+    if (!slot) return;
+    
+    SharedTickSnapshot snapshot;
+    fillSnapshot(ticker, snapshot);
+    storeSharedTick(*slot, snapshot);
+    ticks_published++;
+}
+
+void SharedTickPublisher::fillSnapshot(const TickerData& ticker, SharedTickSnapshot& snapshot) {
+    std::memset(snapshot.product_id, 0, sizeof(snapshot.product_id));
+    std::memcpy(snapshot.product_id, ticker.product_id.data(),
+                std::min(ticker.product_id.size(), SHARED_TICK_PRODUCT_ID_SIZE - 1));
+    snapshot.sequence_number = ticker.sequence_number;
+    snapshot.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        ticker.timestamp.time_since_epoch()).count();
+    snapshot.publish_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    snapshot.price = ticker.price;
+    snapshot.best_bid = ticker.best_bid;
+    snapshot.best_ask = ticker.best_ask;
+    snapshot.mid_price = ticker.mid_price;
+    snapshot.price_ema = ticker.price_ema;
+    snapshot.mid_price_ema = ticker.mid_price_ema;
+}
+
+SharedTickSlot* SharedTickPublisher::slotFor(const std::string& product_id) {
+    // Most feeds repeat the same product, so check the previous slot first
+    if (!last_product.empty() && product_id == last_product) {
+        return &segment->slots[last_slot];
+    }
+    
+    auto it = slot_index.find(product_id);
+    if (it == slot_index.end()) {
+        size_t count = slot_index.size();
+        if (count >= SHARED_TICK_MAX_PRODUCTS) {
+            return nullptr;
+        }
+        
+        it = slot_index.emplace(product_id, count).first;
+        segment->header.product_count.store(static_cast<uint32_t>(count + 1), std::memory_order_release);
+        
+        if (count + 1 == SHARED_TICK_MAX_PRODUCTS) {
+            logger.warning("Shared-memory segment full, further products will not be published");
+        }
+    }
+    
+    last_product = product_id;
+    last_slot = it->second;
+    return &segment->slots[last_slot];
+}
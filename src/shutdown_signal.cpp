@@ -0,0 +1,132 @@
+#include "shutdown_signal.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const int SHUTDOWN_SIGNALS[] = {SIGINT, SIGTERM};
+
+bool g_installed = false;
+#ifndef _WIN32
+int g_signal_pipe[2] = {-1, -1};
+#else
+volatile std::sig_atomic_t g_pending_signal = 0;   // -1 for request()
+#endif
+
+// Runs in signal context: one write() and nothing else
+void onShutdownSignal(int signal) {
+#ifndef _WIN32
+    int saved_errno = errno;
+    unsigned char byte = static_cast<unsigned char>(signal);
+    if (write(g_signal_pipe[1], &byte, 1) < 0) {
+        // Pipe full means a request is already pending
+    }
+    errno = saved_errno;
+#else
+    g_pending_signal = signal;
+#endif
+}
+
+} // namespace
+
+ShutdownSignal::ShutdownSignal() : requested(false), signal_number(0) {
+    if (g_installed) {
+        throw std::runtime_error("Shutdown signal handlers are already installed");
+    }
+
+#ifndef _WIN32
+    if (pipe(g_signal_pipe) != 0) {
+        throw std::runtime_error("Shutdown signal pipe() failed: " + std::string(std::strerror(errno)));
+    }
+    for (int fd : g_signal_pipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = onShutdownSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_RESETHAND;
+    for (int signal : SHUTDOWN_SIGNALS) {
+        sigaction(signal, &action, nullptr);
+    }
+#else
+    g_pending_signal = 0;
+    for (int signal : SHUTDOWN_SIGNALS) {
+        std::signal(signal, onShutdownSignal);
+    }
+#endif
+    g_installed = true;
+}
+
+ShutdownSignal::~ShutdownSignal() {
+    for (int signal : SHUTDOWN_SIGNALS) {
+        std::signal(signal, SIG_DFL);
+    }
+#ifndef _WIN32
+    close(g_signal_pipe[0]);
+    close(g_signal_pipe[1]);
+    g_signal_pipe[0] = g_signal_pipe[1] = -1;
+#endif
+    g_installed = false;
+}
+
+bool ShutdownSignal::wait(std::chrono::milliseconds timeout) {
+    if (requested) return true;
+
+#ifndef _WIN32
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    pollfd read_end{g_signal_pipe[0], POLLIN, 0};
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        int ready = poll(&read_end, 1, static_cast<int>(std::max<int64_t>(0, remaining.count())));
+        if (ready > 0) {
+            unsigned char byte = 0;
+            if (read(g_signal_pipe[0], &byte, 1) == 1) {
+                signal_number = byte;
+                break;
+            }
+        }
+        // EINTR is usually our own signal arriving; poll again to pick up its byte
+        if (ready == 0 || (ready < 0 && errno != EINTR)) {
+            return false;
+        }
+    }
+#else
+    // No self-pipe on Windows: poll the flag the handler sets
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (g_pending_signal == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    signal_number = g_pending_signal > 0 ? static_cast<int>(g_pending_signal) : 0;
+#endif
+
+    requested = true;
+    requested_at = std::chrono::steady_clock::now();
+    return true;
+}
+
+void ShutdownSignal::request() {
+#ifndef _WIN32
+    unsigned char byte = 0;
+    if (write(g_signal_pipe[1], &byte, 1) < 0) {
+        // Pipe full means a request is already pending
+    }
+#else
+    g_pending_signal = -1;
+#endif
+}
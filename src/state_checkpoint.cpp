@@ -0,0 +1,200 @@
+#include "state_checkpoint.h"
+#include "allocation_counter.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'H', 'F', 'T', 'C', 'K', 'P', 'T', '1'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t saved_at_us;       // system clock, so age survives a reboot
+    uint64_t payload_size;
+    uint64_t checksum;          // FNV-1a over the payload
+};
+
+uint64_t fnv1a(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+StateCheckpointer::StateCheckpointer(const std::string& checkpoint_path, Logger& log,
+                                     std::chrono::milliseconds write_interval)
+    : logger(log), path(checkpoint_path), interval(write_interval),
+      next_due(std::chrono::steady_clock::now() + write_interval), has_pending(false), stopping(false),
+      submitted_generation(0), written_generation(0) {
+    writer = std::thread(&StateCheckpointer::writerLoop, this);
+}
+
+StateCheckpointer::~StateCheckpointer() {
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        stopping = true;
+    }
+    writer_cv.notify_one();
+    
+    // A pending checkpoint is still written before the thread exits
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+void StateCheckpointer::submit(std::vector<char>& payload, std::chrono::steady_clock::time_point now) {
+    next_due = now + interval;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        pending_payload.swap(payload);
+        has_pending = true;
+        submitted_generation++;
+    }
+    writer_cv.notify_one();
+    payload.clear();
+}
+
+bool StateCheckpointer::writeNow(const std::vector<char>& payload) {
+    uint64_t generation;
+    {
+        // Anything queued is older than this
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        has_pending = false;
+        generation = ++submitted_generation;
+    }
+    if (!writeFile(payload, generation)) {
+        write_failures++;
+        return false;
+    }
+    checkpoints_written++;
+    return true;
+}
+
+void StateCheckpointer::writerLoop() {
+    AllocationScope scope(AllocationTag::PROCESS);
+    std::vector<char> payload;
+    while (true) {
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex);
+            writer_cv.wait(lock, [this] { return stopping || has_pending; });
+            if (!has_pending) {
+                return;
+            }
+            payload.swap(pending_payload);
+            has_pending = false;
+            generation = submitted_generation;
+        }
+        
+        if (writeFile(payload, generation)) {
+            checkpoints_written++;
+        } else {
+            write_failures++;
+        }
+    }
+}
+
+bool StateCheckpointer::writeFile(const std::vector<char>& payload, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    if (generation <= written_generation) {
+        return true;
+    }
+    
+    CheckpointFileHeader header{};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.saved_at_us = nowMicros();
+    header.payload_size = payload.size();
+    header.checksum = fnv1a(payload.data(), payload.size());
+    
+    const std::string tmp_path = path + ".tmp";
+#ifndef _WIN32
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logger.error("Cannot create checkpoint file: " + tmp_path);
+        return false;
+    }
+    auto writeAll = [fd](const char* data, size_t length) {
+        while (length > 0) {
+            ssize_t n = ::write(fd, data, length);
+            if (n <= 0) return false;
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+    bool ok = writeAll(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+              writeAll(payload.data(), payload.size()) &&
+              ::fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+#else
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    file.close();
+    bool ok = !file.fail();
+#endif
+    
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp_path, path, ec);
+        ok = !ec;
+    }
+    if (ok) {
+        written_generation = generation;
+    } else {
+        logger.error("Checkpoint write failed: " + path);
+        std::filesystem::remove(tmp_path, ec);
+    }
+    return ok;
+}
+
+bool StateCheckpointer::load(const std::string& path, std::chrono::seconds max_age,
+                             std::vector<char>& payload, Logger& log) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    
+    CheckpointFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CHECKPOINT_VERSION || header.payload_size > (64u << 20)) {
+        log.warning("Ignoring unreadable checkpoint " + path);
+        return false;
+    }
+    
+    uint64_t now = nowMicros();
+    uint64_t age_us = now > header.saved_at_us ? now - header.saved_at_us : 0;
+    if (age_us > static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(max_age).count())) {
+        log.info("Checkpoint " + path + " is " + std::to_string(age_us / 1000000) + "s old; starting cold");
+        return false;
+    }
+    
+    payload.resize(header.payload_size);
+    file.read(payload.data(), static_cast<std::streamsize>(payload.size()));
+    if (!file || fnv1a(payload.data(), payload.size()) != header.checksum) {
+        log.warning("Ignoring corrupt checkpoint " + path);
+        payload.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#include "tick_conflator.h"
+#include <cmath>
+
+TickConflator::TickConflator(const ConflationOptions& conflation_options)
+    : options(conflation_options), last_index(0), pending_count(0),
+      conflated_metric(MetricsRegistry::global().counter("hft_ticks_conflated_total",
+          "Ticks superseded before reaching the CSV sink")) {
+}
+
+size_t TickConflator::productFor(const std::string& product_id) {
+    if (!products.empty() && product_id == last_product) {
+        return last_index;
+    }
+    
+    auto it = product_index.find(product_id);
+    if (it == product_index.end()) {
+        it = product_index.emplace(product_id, products.size()).first;
+        products.emplace_back();
+    }
+    
+    last_product = product_id;
+    last_index = it->second;
+    return last_index;
+}
+
+bool TickConflator::isDue(const ProductState& state, const TickerData& ticker) const {
+    if (!state.emitted || ticker.timestamp - state.last_emit >= options.interval) {
+        return true;
+    }
+    return options.price_threshold > 0.0 && state.last_emitted_price > 0.0 &&
+           std::fabs(ticker.price - state.last_emitted_price) >= options.price_threshold * state.last_emitted_price;
+}
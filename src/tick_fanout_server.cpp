@@ -0,0 +1,424 @@
+#include "tick_fanout_server.h"
+#include "allocation_counter.h"
+#include "shared_tick_publisher.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Bounded per-subscriber queue plus the conflation table it falls back to when full
+struct TickFanoutServer::Subscriber {
+    int fd;
+    int id;
+    std::vector<FanoutTickMessage> queue;
+    size_t head;
+    size_t count;
+    size_t head_bytes_sent;     // partial send of the message at head
+    
+    std::vector<FanoutTickMessage> latest;      // by product index
+    std::vector<uint8_t> has_latest;
+    std::vector<uint32_t> conflated_products;   // products with a pending latest, oldest first
+    
+    size_t messages_sent;
+    size_t conflated_updates;
+    
+    Subscriber(int socket_fd, int subscriber_id, size_t capacity)
+        : fd(socket_fd), id(subscriber_id), queue(capacity), head(0), count(0), head_bytes_sent(0),
+          messages_sent(0), conflated_updates(0) {}
+    
+    bool hasPending() const { return count > 0 || !conflated_products.empty(); }
+    
+    void enqueue(const FanoutTickMessage& message, uint32_t product) {
+        // Stay in conflation mode until the backlog clears so updates can't overtake each other
+        if (conflated_products.empty() && count < queue.size()) {
+            queue[(head + count) % queue.size()] = message;
+            count++;
+            return;
+        }
+        
+        if (product >= latest.size()) {
+            latest.resize(product + 1);
+            has_latest.resize(product + 1, 0);
+        }
+        if (has_latest[product]) {
+            conflated_updates++;
+        } else {
+            has_latest[product] = 1;
+            conflated_products.push_back(product);
+        }
+        latest[product] = message;
+    }
+    
+    // Moves conflated updates back into the queue once it has drained
+    void refill() {
+        size_t moved = 0;
+        while (moved < conflated_products.size() && count < queue.size()) {
+            uint32_t product = conflated_products[moved++];
+            queue[(head + count) % queue.size()] = latest[product];
+            count++;
+            has_latest[product] = 0;
+        }
+        conflated_products.erase(conflated_products.begin(), conflated_products.begin() + moved);
+    }
+    
+    int64_t oldestPendingNs() const {
+        if (count > 0) {
+            return queue[head].tick.publish_time_ns;
+        }
+        if (!conflated_products.empty()) {
+            return latest[conflated_products.front()].tick.publish_time_ns;
+        }
+        return 0;
+    }
+};
+
+TickFanoutServer::TickFanoutServer(const std::string& path, Logger& log, 
+                                   size_t source_capacity, size_t per_subscriber_capacity)
+    : logger(log), socket_path(path), subscriber_capacity(per_subscriber_capacity),
+      source_queue(source_capacity), listen_fd(-1), wake_pipe{-1, -1}, next_subscriber_id(1),
+      metrics_collector_id(-1) {}
+
+TickFanoutServer::~TickFanoutServer() {
+    stop();
+}
+
+bool TickFanoutServer::start() {
+    if (running) {
+        logger.warning("Tick fan-out server is already running");
+        return true;
+    }
+    
+#ifndef _WIN32
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        logger.error("Tick fan-out socket path too long: " + socket_path);
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        logger.error("Tick fan-out socket() failed: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || 
+        listen(listen_fd, 16) != 0) {
+        logger.error("Tick fan-out bind/listen failed on " + socket_path + ": " + std::strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    
+    if (pipe(wake_pipe) != 0) {
+        logger.error("Tick fan-out pipe() failed: " + std::string(std::strerror(errno)));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    fcntl(wake_pipe[0], F_SETFL, fcntl(wake_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, fcntl(wake_pipe[1], F_GETFL) | O_NONBLOCK);
+    
+    running = true;
+    server_thread = std::thread(&TickFanoutServer::serverLoop, this);
+    metrics_collector_id = MetricsRegistry::global().addCollector([this](std::string& out) { renderMetrics(out); });
+    
+    logger.info("Tick fan-out server listening on " + socket_path);
+    return true;
+#else
+    logger.info("Tick fan-out server not available on this platform");
+    return false;
+#endif
+}
+
+void TickFanoutServer::stop(std::chrono::milliseconds drain_timeout) {
+    if (!running) return;
+    
+    drain_deadline_ns = (std::chrono::steady_clock::now() + drain_timeout).time_since_epoch().count();
+    running = false;
+    MetricsRegistry::global().removeCollector(metrics_collector_id);
+    metrics_collector_id = -1;
+#ifndef _WIN32
+    char wake_byte = 1;
+    if (write(wake_pipe[1], &wake_byte, 1) < 0) {
+        // Pipe full means the server is already awake
+    }
+    if (server_thread.joinable()) {
+        server_thread.join();
+    }
+    
+    while (!subscribers.empty()) {
+        closeSubscriber(subscribers.size() - 1);
+    }
+    close(listen_fd);
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    listen_fd = -1;
+    wake_pipe[0] = wake_pipe[1] = -1;
+    unlink(socket_path.c_str());
+#endif
+    
+    logger.info("Tick fan-out server stopped. Published: " + std::to_string(messages_published) + 
+               ", source overflows: " + std::to_string(source_overflows) +
+               ", undelivered at stop: " + std::to_string(undelivered_at_stop));
+}
+
+void TickFanoutServer::publish(const TickerData& ticker) {
+    if (!running) return;
+    
+    FanoutTickMessage message;
+    message.length = sizeof(FanoutTickMessage);
+    message.message_type = TICK_FANOUT_MESSAGE_TICK;
+    SharedTickPublisher::fillSnapshot(ticker, message.tick);
+    
+    if (!source_queue.push(message)) {
+        // The fan-out thread is far behind; the latest state is still in shared memory
+        source_overflows++;
+        return;
+    }
+    messages_published++;
+    
+#ifndef _WIN32
+    // Pairs with the fence in serverLoop so a wakeup can't be lost
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (server_sleeping.load(std::memory_order_relaxed) && server_sleeping.exchange(false)) {
+        char wake_byte = 1;
+        if (write(wake_pipe[1], &wake_byte, 1) < 0) {
+            // Pipe full means a wakeup is already pending
+        }
+    }
+#endif
+}
+
+std::vector<FanoutSubscriberStats> TickFanoutServer::getSubscriberStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return subscriber_stats;
+}
+
+void TickFanoutServer::renderMetrics(std::string& out) const {
+    out += "# HELP hft_fanout_messages_published_total Ticks queued for fan-out subscribers\n"
+           "# TYPE hft_fanout_messages_published_total counter\n"
+           "hft_fanout_messages_published_total " + std::to_string(messages_published.load()) + "\n"
+           "# HELP hft_fanout_source_overflows_total Ticks dropped because the fan-out thread fell behind\n"
+           "# TYPE hft_fanout_source_overflows_total counter\n"
+           "hft_fanout_source_overflows_total " + std::to_string(source_overflows.load()) + "\n"
+           "# HELP hft_fanout_source_queue_depth Ticks waiting for the fan-out thread\n"
+           "# TYPE hft_fanout_source_queue_depth gauge\n"
+           "hft_fanout_source_queue_depth " + std::to_string(source_queue.size()) + "\n";
+    
+    std::vector<FanoutSubscriberStats> stats = getSubscriberStats();
+    if (stats.empty()) return;
+    
+    std::string pending = "# HELP hft_fanout_subscriber_pending Messages queued for a subscriber\n"
+                          "# TYPE hft_fanout_subscriber_pending gauge\n";
+    std::string lag = "# HELP hft_fanout_subscriber_lag_ms Age of the oldest message queued for a subscriber\n"
+                      "# TYPE hft_fanout_subscriber_lag_ms gauge\n";
+    std::string conflated = "# HELP hft_fanout_subscriber_conflated_total Updates replaced before a slow subscriber read them\n"
+                            "# TYPE hft_fanout_subscriber_conflated_total counter\n";
+    for (const auto& subscriber : stats) {
+        std::string label = "{subscriber=\"" + std::to_string(subscriber.subscriber_id) + "\"} ";
+        pending += "hft_fanout_subscriber_pending" + label + std::to_string(subscriber.pending_messages) + "\n";
+        lag += "hft_fanout_subscriber_lag_ms" + label + std::to_string(subscriber.lag_ms) + "\n";
+        conflated += "hft_fanout_subscriber_conflated_total" + label + std::to_string(subscriber.conflated_updates) + "\n";
+    }
+    out += pending + lag + conflated;
+}
+
+void TickFanoutServer::serverLoop() {
+    AllocationScope scope(AllocationTag::PROCESS);
+#ifndef _WIN32
+    std::vector<pollfd> poll_fds;
+    FanoutTickMessage message;
+    
+    while (true) {
+        bool stopping = !running;
+        while (source_queue.pop(message)) {
+            distribute(message);
+        }
+        
+        bool pending = false;
+        for (size_t i = subscribers.size(); i-- > 0;) {
+            if (subscribers[i]->hasPending() && !flushSubscriber(*subscribers[i])) {
+                closeSubscriber(i);
+            } else {
+                pending = pending || subscribers[i]->hasPending();
+            }
+        }
+        updateStats(false);
+        
+        // Once stopped, run until every queued tick is sent or the drain deadline passes
+        if (stopping && (!pending || std::chrono::steady_clock::now().time_since_epoch().count() >= drain_deadline_ns)) {
+            size_t undelivered = source_queue.size();
+            for (const auto& subscriber : subscribers) {
+                undelivered += subscriber->count + subscriber->conflated_products.size();
+            }
+            undelivered_at_stop = undelivered;
+            break;
+        }
+        
+        poll_fds.clear();
+        poll_fds.push_back({wake_pipe[0], POLLIN, 0});
+        poll_fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& subscriber : subscribers) {
+            short events = POLLIN;
+            if (subscriber->hasPending()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back({subscriber->fd, events, 0});
+        }
+        
+        server_sleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!source_queue.empty() || stopping != !running) {
+            server_sleeping.store(false);
+            continue;
+        }
+        
+        // While draining only writability matters; wake often to check the deadline
+        int ready = poll(poll_fds.data(), poll_fds.size(), stopping ? 5 : 100);
+        server_sleeping.store(false);
+        if (ready <= 0) continue;
+        
+        if (poll_fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (poll_fds[1].revents & POLLIN) {
+            acceptSubscribers();
+        }
+        
+        // Subscribers only ever close their end; anything they send is discarded
+        for (size_t i = poll_fds.size(); i-- > 2;) {
+            size_t index = i - 2;
+            if (index >= subscribers.size()) continue;
+            
+            bool closed = (poll_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+            if (!closed && (poll_fds[i].revents & POLLIN)) {
+                char discard[256];
+                ssize_t n = recv(subscribers[index]->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                closed = (n == 0) || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+            }
+            if (closed) {
+                closeSubscriber(index);
+            }
+        }
+    }
+    updateStats(true);
+#endif
+}
+
+void TickFanoutServer::acceptSubscribers() {
+#ifndef _WIN32
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) break;
+        
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        subscribers.push_back(std::make_unique<Subscriber>(fd, next_subscriber_id++, subscriber_capacity));
+        logger.info("Tick fan-out subscriber #" + std::to_string(subscribers.back()->id) + " connected");
+    }
+    updateStats(true);
+#endif
+}
+
+void TickFanoutServer::distribute(const FanoutTickMessage& message) {
+    if (subscribers.empty()) return;
+    
+    std::string product(message.tick.product_id);
+    auto it = product_index.find(product);
+    if (it == product_index.end()) {
+        it = product_index.emplace(product, static_cast<uint32_t>(product_index.size())).first;
+    }
+    
+    for (auto& subscriber : subscribers) {
+        subscriber->enqueue(message, it->second);
+    }
+}
+
+bool TickFanoutServer::flushSubscriber(Subscriber& subscriber) {
+#ifndef _WIN32
+    const size_t message_size = sizeof(FanoutTickMessage);
+    
+    while (subscriber.hasPending()) {
+        if (subscriber.count == 0) {
+            subscriber.refill();
+        }
+        
+        // Send the contiguous run up to the end of the ring in one call
+        size_t run = std::min(subscriber.count, subscriber.queue.size() - subscriber.head);
+        const char* data = reinterpret_cast<const char*>(&subscriber.queue[subscriber.head]) + subscriber.head_bytes_sent;
+        size_t bytes = run * message_size - subscriber.head_bytes_sent;
+        
+        ssize_t sent = send(subscriber.fd, data, bytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        
+        size_t total = subscriber.head_bytes_sent + static_cast<size_t>(sent);
+        size_t completed = total / message_size;
+        subscriber.head_bytes_sent = total % message_size;
+        subscriber.head = (subscriber.head + completed) % subscriber.queue.size();
+        subscriber.count -= completed;
+        subscriber.messages_sent += completed;
+        
+        if (static_cast<size_t>(sent) < bytes) {
+            return true;
+        }
+    }
+#endif
+    return true;
+}
+
+void TickFanoutServer::updateStats(bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (!force && now - last_stats_update < std::chrono::milliseconds(100)) {
+        return;
+    }
+    last_stats_update = now;
+    
+    int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    subscriber_stats.clear();
+    for (const auto& subscriber : subscribers) {
+        FanoutSubscriberStats stats;
+        stats.subscriber_id = subscriber->id;
+        stats.messages_sent = subscriber->messages_sent;
+        stats.pending_messages = subscriber->count + subscriber->conflated_products.size();
+        stats.conflated_updates = subscriber->conflated_updates;
+        int64_t oldest = subscriber->oldestPendingNs();
+        stats.lag_ms = oldest > 0 ? (now_ns - oldest) / 1e6 : 0.0;
+        subscriber_stats.push_back(stats);
+    }
+}
+
+void TickFanoutServer::closeSubscriber(size_t index) {
+#ifndef _WIN32
+    const Subscriber& subscriber = *subscribers[index];
+    close(subscriber.fd);
+    logger.info("Tick fan-out subscriber #" + std::to_string(subscriber.id) + " disconnected. Sent: " + 
+               std::to_string(subscriber.messages_sent) + ", conflated: " + 
+               std::to_string(subscriber.conflated_updates));
+#endif
+    subscribers.erase(subscribers.begin() + index);
+    updateStats(true);
+}
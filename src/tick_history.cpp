@@ -0,0 +1,323 @@
+#include "tick_history.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Field order in the bit stream after each timestamp
+enum HistoryField { PRICE = 0, BEST_BID = 1, BEST_ASK = 2, FIELDS = 3 };
+
+uint64_t lowBits(unsigned count) {
+    return count >= 64 ? ~0ULL : (1ULL << count) - 1;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// True if value is exactly q / scale for an integer q, i.e. has no more
+// decimals than the product's quotes. Decoding q / scale gives value back bit for bit.
+bool toFixed(double value, double scale, int64_t& fixed) {
+    double scaled = value * scale;
+    if (!(std::fabs(scaled) < 9.0e15)) return false;
+    fixed = std::llround(scaled);
+    return static_cast<double>(fixed) / scale == value;
+}
+
+void writeBits(std::vector<uint64_t>& words, size_t& bit_count, uint64_t value, unsigned count) {
+    value &= lowBits(count);
+    unsigned offset = static_cast<unsigned>(bit_count % 64);
+    if (offset == 0) {
+        words.push_back(0);
+    }
+    unsigned space = 64 - offset;
+    if (count <= space) {
+        words.back() |= value << (space - count);
+    } else {
+        unsigned spill = count - space;
+        words.back() |= value >> spill;
+        words.push_back(value << (64 - spill));
+    }
+    bit_count += count;
+}
+
+// Variable-width buckets: a unary prefix picks the width. Timestamps are
+// microseconds, so their buckets are wider than the price ones.
+struct Bucket {
+    uint64_t prefix;
+    unsigned prefix_bits;
+    unsigned value_bits;
+};
+
+const Bucket TIMESTAMP_BUCKETS[] = {{0b10, 2, 8}, {0b110, 3, 14}, {0b1110, 4, 20}};
+const Bucket PRICE_BUCKETS[] = {{0b10, 2, 6}, {0b110, 3, 13}, {0b1110, 4, 20}};
+const uint64_t RAW_PREFIX = 0b1111;
+
+// Writes '0' for zero, the smallest fitting bucket, or false if none fits
+bool writeBucketed(std::vector<uint64_t>& words, size_t& bit_count, const Bucket* buckets, int64_t value) {
+    if (value == 0) {
+        writeBits(words, bit_count, 0, 1);
+        return true;
+    }
+    uint64_t encoded = zigzag(value);
+    for (int i = 0; i < 3; ++i) {
+        if (encoded <= lowBits(buckets[i].value_bits)) {
+            writeBits(words, bit_count, buckets[i].prefix, buckets[i].prefix_bits);
+            writeBits(words, bit_count, encoded, buckets[i].value_bits);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+TickHistory::TickHistory(std::chrono::seconds retention_window)
+    : retention(retention_window), last_index(0), evicted_blocks(0) {
+}
+
+void TickHistory::encode(Block& block, double scale, int64_t timestamp_us, const double* values) {
+    if (block.count == 0) {
+        block.first_timestamp_us = timestamp_us;
+        block.previous_timestamp_us = timestamp_us;
+        block.previous_delta_us = 0;
+    } else {
+        int64_t delta = timestamp_us - block.previous_timestamp_us;
+        int64_t delta_of_delta = delta - block.previous_delta_us;
+        if (!writeBucketed(block.bits, block.bit_count, TIMESTAMP_BUCKETS, delta_of_delta)) {
+            writeBits(block.bits, block.bit_count, RAW_PREFIX, 4);
+            writeBits(block.bits, block.bit_count, zigzag(delta_of_delta), 64);
+        }
+        block.previous_timestamp_us = timestamp_us;
+        block.previous_delta_us = delta;
+    }
+    
+    for (int field = 0; field < FIELDS; ++field) {
+        int64_t current = 0, previous = 0;
+        bool written = toFixed(values[field], scale, current) &&
+                       toFixed(block.previous_values[field], scale, previous) &&
+                       writeBucketed(block.bits, block.bit_count, PRICE_BUCKETS, current - previous);
+        if (!written) {
+            uint64_t raw;
+            std::memcpy(&raw, &values[field], sizeof(raw));
+            writeBits(block.bits, block.bit_count, RAW_PREFIX, 4);
+            writeBits(block.bits, block.bit_count, raw, 64);
+        }
+        block.previous_values[field] = values[field];
+    }
+    
+    double price = values[PRICE];
+    if (block.count == 0) {
+        block.first_price = block.min_price = block.max_price = price;
+    }
+    block.min_price = std::min(block.min_price, price);
+    block.max_price = std::max(block.max_price, price);
+    block.sum_price += price;
+    block.last_price = price;
+    block.last_timestamp_us = timestamp_us;
+    block.count++;
+}
+
+void TickHistory::append(const TickerData& ticker) {
+    int64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        ticker.timestamp.time_since_epoch()).count();
+    double values[FIELDS] = {ticker.price, ticker.best_bid, ticker.best_ask};
+    
+    std::lock_guard<std::mutex> lock(history_mutex);
+    if (products.empty() || ticker.product_id != last_product) {
+        auto it = product_index.find(ticker.product_id);
+        if (it == product_index.end()) {
+            it = product_index.emplace(ticker.product_id, products.size()).first;
+            products.emplace_back();
+            products.back().scale = std::pow(10.0, ticker.price_decimals);
+        }
+        last_product = ticker.product_id;
+        last_index = it->second;
+    }
+    ProductHistory& product = products[last_index];
+    
+    if (!product.blocks.empty()) {
+        timestamp_us = std::max(timestamp_us, product.blocks.back().last_timestamp_us);
+    }
+    if (product.blocks.empty() || product.blocks.back().count == BLOCK_TICKS) {
+        if (!product.blocks.empty()) {
+            product.blocks.back().bits.shrink_to_fit();
+        }
+        product.blocks.emplace_back();
+        product.blocks.back().bits.reserve(BLOCK_TICKS / 2);
+    }
+    encode(product.blocks.back(), product.scale, timestamp_us, values);
+    product.tick_count++;
+    evictExpired(product, timestamp_us);
+}
+
+void TickHistory::evictExpired(ProductHistory& product, int64_t newest_us) {
+    // Whole blocks only, so up to one block older than the window stays
+    while (product.blocks.size() > 1 && product.blocks.front().last_timestamp_us < newest_us - retention.count()) {
+        product.tick_count -= product.blocks.front().count;
+        product.blocks.pop_front();
+        evicted_blocks++;
+    }
+}
+
+const TickHistory::ProductHistory* TickHistory::findProduct(const std::string& product_id) const {
+    auto it = product_index.find(product_id);
+    return it != product_index.end() ? &products[it->second] : nullptr;
+}
+
+size_t TickHistory::firstBlockFor(const ProductHistory& product, int64_t from_us) const {
+    auto it = std::partition_point(product.blocks.begin(), product.blocks.end(),
+                                   [from_us](const Block& block) { return block.last_timestamp_us < from_us; });
+    return static_cast<size_t>(it - product.blocks.begin());
+}
+
+HistoryAggregate TickHistory::aggregate(const std::string& product_id, int64_t from_us, int64_t to_us) const {
+    HistoryAggregate result;
+    auto add = [&result](int64_t first_us, int64_t last_us, double first, double last,
+                         double low, double high, double sum, size_t count) {
+        if (result.count == 0) {
+            result.first_timestamp_us = first_us;
+            result.first_price = first;
+            result.min_price = low;
+            result.max_price = high;
+        }
+        result.last_timestamp_us = last_us;
+        result.last_price = last;
+        result.min_price = std::min(result.min_price, low);
+        result.max_price = std::max(result.max_price, high);
+        result.sum_price += sum;
+        result.count += count;
+    };
+    
+    std::lock_guard<std::mutex> lock(history_mutex);
+    const ProductHistory* product = findProduct(product_id);
+    if (!product || from_us > to_us) return result;
+    
+    for (size_t b = firstBlockFor(*product, from_us); b < product->blocks.size(); ++b) {
+        const Block& block = product->blocks[b];
+        if (block.first_timestamp_us > to_us) break;
+        
+        if (block.first_timestamp_us >= from_us && block.last_timestamp_us <= to_us) {
+            // Fully inside the range: the summary is enough
+            add(block.first_timestamp_us, block.last_timestamp_us, block.first_price, block.last_price,
+                block.min_price, block.max_price, block.sum_price, block.count);
+            continue;
+        }
+        BlockDecoder decoder(block, product->scale);
+        HistoryTick tick;
+        while (decoder.next(tick) && tick.timestamp_us <= to_us) {
+            if (tick.timestamp_us >= from_us) {
+                add(tick.timestamp_us, tick.timestamp_us, tick.price, tick.price, tick.price, tick.price, tick.price, 1);
+            }
+        }
+    }
+    return result;
+}
+
+size_t TickHistory::getTickCount(const std::string& product_id) const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    const ProductHistory* product = findProduct(product_id);
+    return product ? product->tick_count : 0;
+}
+
+size_t TickHistory::getTotalTicks() const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    size_t total = 0;
+    for (const auto& product : products) {
+        total += product.tick_count;
+    }
+    return total;
+}
+
+size_t TickHistory::getBlockCount() const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    size_t total = 0;
+    for (const auto& product : products) {
+        total += product.blocks.size();
+    }
+    return total;
+}
+
+size_t TickHistory::getMemoryBytes() const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    size_t total = 0;
+    for (const auto& product : products) {
+        for (const auto& block : product.blocks) {
+            total += sizeof(Block) + block.bits.capacity() * sizeof(uint64_t);
+        }
+    }
+    return total;
+}
+
+size_t TickHistory::getEvictedBlocks() const {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    return evicted_blocks;
+}
+
+TickHistory::BlockDecoder::BlockDecoder(const Block& block, double price_scale)
+    : words(block.bits.data()), position(0), remaining(block.count), scale(price_scale),
+      timestamp_us(block.first_timestamp_us), delta_us(0), values{0.0, 0.0, 0.0}, started(false) {
+}
+
+uint64_t TickHistory::BlockDecoder::readBits(unsigned count) {
+    size_t word = position / 64;
+    unsigned offset = static_cast<unsigned>(position % 64);
+    unsigned space = 64 - offset;
+    position += count;
+    if (count <= space) {
+        return (words[word] >> (space - count)) & lowBits(count);
+    }
+    unsigned spill = count - space;
+    return ((words[word] & lowBits(space)) << spill) | (words[word + 1] >> (64 - spill));
+}
+
+double TickHistory::BlockDecoder::readValue(double previous) {
+    if (readBits(1) == 0) return previous;
+    
+    unsigned bucket = 0;
+    while (bucket < 3 && readBits(1) == 1) {
+        bucket++;
+    }
+    if (bucket == 3) {
+        uint64_t raw = readBits(64);
+        double value;
+        std::memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+    int64_t fixed = 0;
+    toFixed(previous, scale, fixed);
+    return static_cast<double>(fixed + unzigzag(readBits(PRICE_BUCKETS[bucket].value_bits))) / scale;
+}
+
+bool TickHistory::BlockDecoder::next(HistoryTick& tick) {
+    if (remaining == 0) return false;
+    remaining--;
+    
+    if (started) {
+        int64_t delta_of_delta = 0;
+        if (readBits(1) == 1) {
+            unsigned bucket = 0;
+            while (bucket < 3 && readBits(1) == 1) {
+                bucket++;
+            }
+            delta_of_delta = unzigzag(readBits(bucket == 3 ? 64 : TIMESTAMP_BUCKETS[bucket].value_bits));
+        }
+        delta_us += delta_of_delta;
+        timestamp_us += delta_us;
+    }
+    started = true;
+    
+    for (int field = 0; field < FIELDS; ++field) {
+        values[field] = readValue(values[field]);
+    }
+    tick.timestamp_us = timestamp_us;
+    tick.price = values[PRICE];
+    tick.best_bid = values[BEST_BID];
+    tick.best_ask = values[BEST_ASK];
+    return true;
+}
@@ -2,35 +2,145 @@
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <ctime>
 
 TickerData::TickerData() 
     : price(0.0), best_bid(0.0), best_ask(0.0), mid_price(0.0), 
-      price_ema(0.0), mid_price_ema(0.0), sequence_number(0) {}
+      price_ema(0.0), mid_price_ema(0.0), sequence_number(0), exchange_sequence(0), price_decimals(2),
+      indicator_values(nullptr), indicator_count(0) {}
 
-std::string TickerData::toCSVRow() const {
-    std::ostringstream oss;
+namespace {
+
+// Appends to a caller-supplied buffer, tracking the length it would need even when it does not fit
+class RowBuilder {
+private:
+    char* out;
+    size_t capacity;
+    size_t length;
+
+public:
+    RowBuilder(char* buffer, size_t cap) : out(buffer), capacity(cap), length(0) {}
+    
+    size_t size() const { return length; }
+    
+    void put(const char* data, size_t count) {
+        if (length + count <= capacity) {
+            std::memcpy(out + length, data, count);
+        }
+        length += count;
+    }
+    
+    void put(const std::string& value) { put(value.data(), value.size()); }
+    void put(char c) { put(&c, 1); }
+    
+    void putPadded(unsigned value, int width) {
+        char digits[16];
+        int pos = sizeof(digits);
+        do {
+            digits[--pos] = static_cast<char>('0' + value % 10);
+            value /= 10;
+            --width;
+        } while (value != 0 && pos > 0);
+        while (width-- > 0 && pos > 0) {
+            digits[--pos] = '0';
+        }
+        put(digits + pos, sizeof(digits) - pos);
+    }
+    
+    void putUnsigned(size_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        put(digits, result.ptr - digits);
+    }
+    
+    void putFixed(double value, int precision) {
+        // Large enough for any finite double in fixed notation
+        char digits[400];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+        put(digits, result.ptr - digits);
+    }
+};
+
+std::tm toUtc(std::time_t time_val) {
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &time_val);
+#else
+    gmtime_r(&time_val, &utc);
+#endif
+    return utc;
+}
+
+} // namespace
+
+size_t TickerData::formatCSVRow(char* buffer, size_t capacity) const {
+    RowBuilder row(buffer, capacity);
     
     auto time_since_epoch = timestamp.time_since_epoch();
     auto seconds = std::chrono::duration_cast<std::chrono::seconds>(time_since_epoch);
     auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(time_since_epoch) - 
                        std::chrono::duration_cast<std::chrono::microseconds>(seconds);
     
-    auto time_t_val = std::chrono::system_clock::to_time_t(timestamp);
+    std::tm utc = toUtc(std::chrono::system_clock::to_time_t(timestamp));
     
     // Format: YYYY-MM-DD HH:MM:SS.microseconds
-    oss << std::put_time(std::gmtime(&time_t_val), "%Y-%m-%d %H:%M:%S");
-    oss << "." << std::setfill('0') << std::setw(6) << microseconds.count();
-    oss << "," << sequence_number
-        << "," << type
-        << "," << product_id
-        << "," << std::fixed << std::setprecision(2) << price
-        << "," << best_bid
-        << "," << best_ask
-        << "," << mid_price
-        << "," << std::setprecision(6) << price_ema
-        << "," << mid_price_ema;
+    row.putPadded(utc.tm_year + 1900, 4);
+    row.put('-');
+    row.putPadded(utc.tm_mon + 1, 2);
+    row.put('-');
+    row.putPadded(utc.tm_mday, 2);
+    row.put(' ');
+    row.putPadded(utc.tm_hour, 2);
+    row.put(':');
+    row.putPadded(utc.tm_min, 2);
+    row.put(':');
+    row.putPadded(utc.tm_sec, 2);
+    row.put('.');
+    row.putPadded(static_cast<unsigned>(microseconds.count()), 6);
     
-    return oss.str();
+    row.put(',');
+    row.putUnsigned(sequence_number);
+    row.put(',');
+    row.put(type);
+    row.put(',');
+    row.put(product_id);
+    row.put(',');
+    row.putFixed(price, price_decimals);
+    row.put(',');
+    row.putFixed(best_bid, price_decimals);
+    row.put(',');
+    row.putFixed(best_ask, price_decimals);
+    row.put(',');
+    row.putFixed(mid_price, price_decimals);
+    row.put(',');
+    int ema_decimals = price_decimals > 6 ? price_decimals : 6;
+    row.putFixed(price_ema, ema_decimals);
+    row.put(',');
+    row.putFixed(mid_price_ema, ema_decimals);
+    
+    for (size_t i = 0; i < indicator_count; ++i) {
+        row.put(',');
+        if (!std::isnan(indicator_values[i])) {
+            row.putFixed(indicator_values[i], 6);
+        }
+    }
+    
+    return row.size();
+}
+
+std::string TickerData::toCSVRow() const {
+    char buffer[512];
+    size_t length = formatCSVRow(buffer, sizeof(buffer));
+    if (length <= sizeof(buffer)) {
+        return std::string(buffer, length);
+    }
+    
+    std::string row(length, '\0');
+    formatCSVRow(&row[0], row.size());
+    return row;
 }
 
 std::string TickerData::toLogString() const {
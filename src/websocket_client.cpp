@@ -1,25 +1,67 @@
 #include "websocket_client.h"
+#include "allocation_counter.h"
+#include "tracepoints.h"
+#include <algorithm>
 
-WebSocketClient::WebSocketClient(const std::string& product, Logger& log) 
-    : logger(log), json_parser(log), product_id(product), 
-      messages_received(0), parse_errors(0) {
+namespace {
+
+const LogTemplate PROCESSING_TICKER("Processing ticker: {} - Price: ${} - Mid: ${}");
+const LogTemplate MESSAGE_PROGRESS("Progress: {} messages processed");
+const LogTemplate MESSAGE_PROCESSING_PASSED("TEST: MESSAGE_PROCESSING - PASSED | Details: Processed {} messages");
+
+} // namespace
+
+WebSocketClient::WebSocketClient(const std::string& product, Logger& log, WebSocketTransport transport,
+                                 const std::string& url, const EpollWebSocketOptions& native_options)
+    : ws_url(url), logger(log), json_parser(log), product_id(product), 
+      messages_received(0), parse_errors(0),
+      messages_metric(MetricsRegistry::global().counter("hft_messages_received_total",
+          "WebSocket messages received")),
+      heartbeats_metric(MetricsRegistry::global().counter("hft_heartbeats_received_total",
+          "Heartbeat channel messages received")),
+      reconnects_metric(MetricsRegistry::global().counter("hft_websocket_reconnects_total",
+          "Connections dropped on purpose to reconnect a stalled feed")),
+      disconnects_metric(MetricsRegistry::global().counter("hft_websocket_disconnects_total",
+          "WebSocket connections closed by either side")),
+      malformed_json_metric(MetricsRegistry::global().counter("hft_parse_errors_total",
+          "Messages that could not be parsed, by reason", "reason=\"malformed_json\"")),
+      wrong_field_type_metric(MetricsRegistry::global().counter("hft_parse_errors_total",
+          "Messages that could not be parsed, by reason", "reason=\"wrong_field_type\"")),
+      not_a_ticker_metric(MetricsRegistry::global().counter("hft_parse_errors_total",
+          "Messages that could not be parsed, by reason", "reason=\"not_a_ticker\"")),
+      other_error_metric(MetricsRegistry::global().counter("hft_parse_errors_total",
+          "Messages that could not be parsed, by reason", "reason=\"other\"")),
+      connected_metric(MetricsRegistry::global().gauge("hft_websocket_connected",
+          "1 while the exchange connection is open")) {
     
-    //Coinbase WebSocket URL
-    std::string ws_url = "wss://ws-feed.exchange.coinbase.com";
-    webSocket.setUrl(ws_url);
+    if (!product_id.empty()) {
+        subscribed_products.push_back(product_id);
+    }
+    
+    if (transport == WebSocketTransport::EPOLL && !EpollWebSocket::isAvailable()) {
+        logger.warning("Native epoll WebSocket transport not built in, using ixwebsocket");
+        transport = WebSocketTransport::IXWEBSOCKET;
+    }
     
-    setupCallbacks();
+    if (transport == WebSocketTransport::EPOLL) {
+        native_socket = std::make_unique<EpollWebSocket>(logger, native_options);
+        native_socket->setUrl(ws_url);
+        setupNativeCallbacks();
+    } else {
+        webSocket.setUrl(ws_url);
+        setupCallbacks();
+    }
     
     logger.info("WebSocket client initialized for product: " + product_id);
-    logger.info("Using WebSocket URL: " + ws_url);
+    logger.info("Using WebSocket URL: " + ws_url + (native_socket ? " (native epoll transport)" : ""));
 }
 
 WebSocketClient::~WebSocketClient() {
     stop();
 }
 
-void WebSocketClient::setDataCallback(std::function<void(const TickerData&)> callback) {
-    data_callback = callback;
+void WebSocketClient::setDataCallback(std::function<void(TickerData&)> callback) {
+    data_callback = std::move(callback);
 }
 
 void WebSocketClient::start() {
@@ -30,7 +72,11 @@ void WebSocketClient::start() {
     
     running = true;
     logger.info("Starting WebSocket connection to Coinbase Exchange");
-    webSocket.start();
+    if (native_socket) {
+        native_socket->start();
+    } else {
+        webSocket.start();
+    }
 }
 
 void WebSocketClient::stop() {
@@ -38,46 +84,43 @@ void WebSocketClient::stop() {
     
     running = false;
     connected = false;
-    webSocket.stop();
+    connected_metric.set(0);
+    if (native_socket) {
+        native_socket->stop();
+    } else {
+        webSocket.stop();
+    }
     
     logger.info("WebSocket client stopped");
-    logger.info("Final statistics - Messages received: " + std::to_string(messages_received) + 
-               ", Parse errors: " + std::to_string(parse_errors));
+    logger.info("Final statistics - Messages received: " + std::to_string(getMessagesReceived()) + 
+               ", Parse errors: " + std::to_string(getParseErrors()) +
+               ", Heartbeats: " + std::to_string(getHeartbeatsReceived()) +
+               ", Reconnects: " + std::to_string(getReconnects()));
 }
 
 void WebSocketClient::setupCallbacks() {
     // Set the main callback handler
     webSocket.setOnMessageCallback([this](const ix::WebSocketMessagePtr& msg) {
+        // ix owns the thread; from here on its frame buffers are charged to receive too
+        AllocationScope::tagThread(AllocationTag::RECEIVE);
         switch (msg->type) {
             case ix::WebSocketMessageType::Message:
-                logger.debug("Received message: " + msg->str.substr(0, 100) + "...");
+                if (logger.isEnabled(LogLevel::DEBUG)) {
+                    logger.debug("Received message: " + msg->str.substr(0, 100) + "...");
+                }
                 handleMessage(msg->str);
                 break;
                 
             case ix::WebSocketMessageType::Open:
-                connected = true;
-                logger.info("WebSocket connection opened successfully!");
-                logger.logTest("WEBSOCKET_CONNECTION", "PASSED", "Connected to ws-feed.exchange.coinbase.com");
-                
-                // Wait a moment before subscribing
-                std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-                subscribeToTicker();
+                onOpen();
                 break;
                 
             case ix::WebSocketMessageType::Close:
-                connected = false;
-                logger.info("WebSocket connection closed - Code: " + std::to_string(msg->closeInfo.code) + 
-                           ", Reason: " + msg->closeInfo.reason);
-                logger.logTest("WEBSOCKET_DISCONNECT", "INFO", 
-                              "Code: " + std::to_string(msg->closeInfo.code) + ", Reason: " + msg->closeInfo.reason);
+                onClose(msg->closeInfo.code, msg->closeInfo.reason);
                 break;
                 
             case ix::WebSocketMessageType::Error:
-                logger.error("WebSocket error: " + msg->errorInfo.reason);
-                logger.error("HTTP Status: " + std::to_string(msg->errorInfo.http_status));
-                logger.logTest("WEBSOCKET_ERROR", "FAILED", 
-                              "HTTP: " + std::to_string(msg->errorInfo.http_status) + 
-                              " - " + msg->errorInfo.reason);
+                onError(msg->errorInfo.http_status, msg->errorInfo.reason);
                 break;
                 
             case ix::WebSocketMessageType::Ping:
@@ -95,25 +138,139 @@ void WebSocketClient::setupCallbacks() {
     });
 }
 
-void WebSocketClient::subscribeToTicker() {
-    logger.info("Sending subscription request for " + product_id + "...");
+void WebSocketClient::setupNativeCallbacks() {
+    // Runs on the transport's I/O thread; payload points into its receive buffer
+    native_socket->setEventCallback([this](const WebSocketEvent& event) {
+        switch (event.type) {
+            case WebSocketEventType::MESSAGE:
+                if (logger.isEnabled(LogLevel::DEBUG)) {
+                    logger.debug("Received message: " + std::string(event.payload.substr(0, 100)) + "...");
+                }
+                handleMessage(event.payload);
+                break;
+                
+            case WebSocketEventType::OPEN:
+                onOpen();
+                break;
+                
+            case WebSocketEventType::CLOSE:
+                onClose(event.close_code, event.reason);
+                break;
+                
+            case WebSocketEventType::ERROR:
+                onError(0, event.reason);
+                break;
+        }
+    });
+}
+
+void WebSocketClient::onOpen() {
+    connected = true;
+    connected_metric.set(1);
+    logger.info("WebSocket connection opened successfully!");
+    logger.logTest("WEBSOCKET_CONNECTION", "PASSED", "Connected to " + ws_url);
     
-    // Create subscription message
-    nlohmann::json subscription;
-    subscription["type"] = "subscribe";
-    subscription["product_ids"] = nlohmann::json::array({product_id});
-    subscription["channels"] = nlohmann::json::array({"ticker"});
+    // Wait a moment before subscribing; the native transport is ready once OPEN fires
+    if (!native_socket) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    }
+    subscribeToTicker();
+}
+
+void WebSocketClient::onClose(int code, const std::string& reason) {
+    connected = false;
+    connected_metric.set(0);
+    disconnects_metric.increment();
+    logger.info("WebSocket connection closed - Code: " + std::to_string(code) + ", Reason: " + reason);
+    logger.logTest("WEBSOCKET_DISCONNECT", "INFO", "Code: " + std::to_string(code) + ", Reason: " + reason);
+}
+
+void WebSocketClient::onError(int http_status, const std::string& reason) {
+    logger.error("WebSocket error: " + reason);
+    logger.error("HTTP Status: " + std::to_string(http_status));
+    logger.logTest("WEBSOCKET_ERROR", "FAILED", "HTTP: " + std::to_string(http_status) + " - " + reason);
+}
+
+void WebSocketClient::addProducts(const std::vector<std::string>& product_ids) {
+    std::lock_guard<std::mutex> lock(subscription_mutex);
+    for (const auto& id : product_ids) {
+        if (std::find(subscribed_products.begin(), subscribed_products.end(), id) == subscribed_products.end()) {
+            subscribed_products.push_back(id);
+        }
+    }
+}
+
+void WebSocketClient::subscribe(const std::vector<std::string>& product_ids) {
+    std::vector<std::string> added;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        for (const auto& id : product_ids) {
+            if (std::find(subscribed_products.begin(), subscribed_products.end(), id) == subscribed_products.end()) {
+                subscribed_products.push_back(id);
+                added.push_back(id);
+            }
+        }
+    }
     
-    std::string sub_message = subscription.dump();
-    logger.info("Subscription message: " + sub_message);
+    // Not connected: the next open subscribes to the whole list
+    if (!added.empty() && connected) {
+        sendChannelMessage("subscribe", added);
+    }
+}
+
+void WebSocketClient::unsubscribe(const std::vector<std::string>& product_ids) {
+    std::vector<std::string> removed;
+    {
+        std::lock_guard<std::mutex> lock(subscription_mutex);
+        for (const auto& id : product_ids) {
+            auto it = std::find(subscribed_products.begin(), subscribed_products.end(), id);
+            if (it != subscribed_products.end()) {
+                subscribed_products.erase(it);
+                removed.push_back(id);
+            }
+        }
+    }
     
-    // Send the subscription message
-    ix::WebSocketSendInfo sendInfo = webSocket.send(sub_message);
+    if (!removed.empty() && connected) {
+        sendChannelMessage("unsubscribe", removed);
+    }
+}
+
+std::vector<std::string> WebSocketClient::getSubscribedProducts() const {
+    std::lock_guard<std::mutex> lock(subscription_mutex);
+    return subscribed_products;
+}
+
+void WebSocketClient::enableHeartbeats(std::function<void()> callback) {
+    heartbeat_callback = std::move(callback);
+}
+
+void WebSocketClient::reconnect(const std::string& reason) {
+    if (!running) return;
     
-    if (sendInfo.success) {
+    reconnects.fetch_add(1, std::memory_order_relaxed);
+    reconnects_metric.increment();
+    logger.warning("Reconnecting WebSocket: " + reason);
+    logger.logTest("WEBSOCKET_RECONNECT", "INFO", reason);
+    if (native_socket) {
+        native_socket->close(ix::WebSocketCloseConstants::kNormalClosureCode, "Reconnecting: " + reason);
+    } else {
+        webSocket.close(ix::WebSocketCloseConstants::kNormalClosureCode, "Reconnecting: " + reason);
+    }
+}
+
+void WebSocketClient::subscribeToTicker() {
+    std::vector<std::string> products = getSubscribedProducts();
+    if (products.empty()) {
+        logger.info("No products to subscribe to yet");
+        return;
+    }
+    logger.info("Sending subscription request for " + products.front() + 
+               (products.size() == 1 ? "" : " and " + std::to_string(products.size() - 1) + " more") + "...");
+    
+    if (sendChannelMessage("subscribe", products)) {
         logger.info("Subscription message sent successfully!");
-        logger.info("Payload size: " + std::to_string(sendInfo.payloadSize) + " bytes");
-        logger.logTest("TICKER_SUBSCRIPTION", "PASSED", "Subscribed to " + product_id);
+        logger.logTest("TICKER_SUBSCRIPTION", "PASSED", "Subscribed to " + products.front());
     } else {
         logger.error("Failed to send subscription message");
         logger.logTest("TICKER_SUBSCRIPTION", "FAILED", "Failed to send subscription");
@@ -122,52 +279,95 @@ void WebSocketClient::subscribeToTicker() {
     logger.info("Waiting for ticker data...");
 }
 
-void WebSocketClient::handleMessage(const std::string& message) {
-    messages_received++;
+bool WebSocketClient::sendChannelMessage(const char* type, const std::vector<std::string>& product_ids) {
+    // Create subscription message
+    nlohmann::json subscription;
+    subscription["type"] = type;
+    subscription["product_ids"] = product_ids;
+    subscription["channels"] = nlohmann::json::array({"ticker"});
+    if (heartbeat_callback) {
+        subscription["channels"].push_back("heartbeat");
+    }
+    
+    std::string sub_message = subscription.dump();
+    logger.info("Subscription message: " + sub_message);
+    
+    bool sent = native_socket ? native_socket->send(sub_message) : webSocket.send(sub_message).success;
+    if (sent) {
+        logger.info("Payload size: " + std::to_string(sub_message.size()) + " bytes");
+    }
+    return sent;
+}
+
+void WebSocketClient::handleMessage(std::string_view message) {
+    size_t message_number = messages_received.fetch_add(1, std::memory_order_relaxed) + 1;
+    HFT_TRACE2(frame_received, message_number, message.size());
+    messages_metric.increment();
     
     try {
+        // Heartbeats only prove the connection is alive
+        if (heartbeat_callback && message.find("\"type\":\"heartbeat\"") != std::string_view::npos) {
+            heartbeats_received.fetch_add(1, std::memory_order_relaxed);
+            heartbeats_metric.increment();
+            heartbeat_callback();
+            return;
+        }
+        
         // Log the first few messages to see what we're getting
-        if (messages_received <= 3) {
-            logger.info("Message #" + std::to_string(messages_received) + ": " + message);
+        if (message_number <= 3) {
+            logger.info("Message #" + std::to_string(message_number) + ": " + std::string(message));
         }
         
         // Check if this is a subscription confirmation
-        if (message.find("\"type\":\"subscriptions\"") != std::string::npos) {
+        if (message.find("\"type\":\"subscriptions\"") != std::string_view::npos) {
             logger.info("Received subscription confirmation!");
             logger.logTest("SUBSCRIPTION_CONFIRMED", "PASSED", "Coinbase confirmed subscription");
             return;
         }
         
-        TickerData ticker = json_parser.parseTickerMessage(message);
+        TickerData& ticker = scratch_ticker;
+        json_parser.parseTickerMessage(message, ticker);
         
         if (ticker.type == "ticker" && data_callback) {
-            logger.info("Processing ticker: " + ticker.product_id + 
-                       " - Price: $" + std::to_string(ticker.price) +
-                       " - Mid: $" + std::to_string(ticker.mid_price));
+            if (logger.isEnabled(LogLevel::DEBUG)) {
+                logger.log(LogLevel::DEBUG, PROCESSING_TICKER, ticker.product_id, ticker.price, ticker.mid_price);
+            }
             data_callback(ticker);
         } else if (!ticker.type.empty() && ticker.type != "ticker") {
             logger.info("Received message type: " + ticker.type);
         }
         
         // Log progress every 25 messages
-        if (messages_received % 25 == 0) {
-            logger.info("Progress: " + std::to_string(messages_received) + " messages processed");
-            logger.logTest("MESSAGE_PROCESSING", "PASSED", 
-                          "Processed " + std::to_string(messages_received) + " messages");
+        if (message_number % 25 == 0) {
+            logger.log(LogLevel::INFO, MESSAGE_PROGRESS, message_number);
+            logger.logTest(MESSAGE_PROCESSING_PASSED, message_number);
         }
         
+    } catch (const nlohmann::json::parse_error& e) {
+        countParseError(malformed_json_metric, e.what(), message);
+    } catch (const nlohmann::json::exception& e) {
+        countParseError(wrong_field_type_metric, e.what(), message);
+    } catch (const FieldTypeError& e) {
+        countParseError(wrong_field_type_metric, e.what(), message);
+    } catch (const NotATickerError& e) {
+        countParseError(not_a_ticker_metric, e.what(), message);
     } catch (const std::exception& e) {
-        parse_errors++;
-        logger.debug("Parse error: " + std::string(e.what()));
-        
-        // Show problematic message for first few errors
-        if (parse_errors <= 3) {
-            logger.debug("Problematic message: " + message.substr(0, 200) + "...");
-        }
-        
-        if (parse_errors % 10 == 0) {
-            logger.logTest("PARSE_ERRORS", "WARNING", 
-                          "Total parse errors: " + std::to_string(parse_errors));
-        }
+        countParseError(other_error_metric, e.what(), message);
     }
-}
\ No newline at end of file
+}
+
+void WebSocketClient::countParseError(MetricCounter& reason, const char* what, std::string_view message) {
+    size_t error_number = parse_errors.fetch_add(1, std::memory_order_relaxed) + 1;
+    reason.increment();
+    logger.debug("Parse error: " + std::string(what));
+    
+    // Show problematic message for first few errors
+    if (error_number <= 3) {
+        logger.debug("Problematic message: " + std::string(message.substr(0, 200)) + "...");
+    }
+    
+    if (error_number % 10 == 0) {
+        logger.logTest("PARSE_ERRORS", "WARNING", 
+                      "Total parse errors: " + std::to_string(error_number));
+    }
+}
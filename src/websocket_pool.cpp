@@ -0,0 +1,473 @@
+#include "websocket_pool.h"
+#include "allocation_counter.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const size_t DELIVERY_BATCH = 64;          // per ring per pass, so one busy session cannot starve the rest
+const int DELIVERY_SPINS = 64;             // empty passes before the delivery thread starts sleeping
+const std::chrono::microseconds DELIVERY_IDLE_SLEEP(50);
+const std::chrono::milliseconds CONTROL_PERIOD(100);
+
+double secondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::max(1e-3, std::chrono::duration<double>(to - from).count());
+}
+
+} // namespace
+
+WebSocketPool::WebSocketPool(const std::vector<std::string>& product_ids, Logger& log, const WebSocketPoolOptions& opts)
+    : logger(log), options(opts), products(product_ids),
+      product_messages(product_ids.size() * std::max<size_t>(1, std::min(opts.sessions, product_ids.size()))),
+      session_messages(std::max<size_t>(1, std::min(opts.sessions, product_ids.size()))),
+      handoff_target(product_ids.size()), last_delivered(product_ids.size(), 0), held(product_ids.size()),
+      products_held(0), moves_completed(0), rebalance_requested(false),
+      duplicates_metric(MetricsRegistry::global().counter("hft_pool_duplicates_dropped_total",
+          "Ticks delivered by two sessions during a handoff, or older than one already delivered")),
+      moves_metric(MetricsRegistry::global().counter("hft_pool_product_moves_total",
+          "Products handed over to another session")) {
+    if (products.empty()) {
+        throw std::invalid_argument("WebSocketPool needs at least one product");
+    }
+    for (size_t i = 0; i < products.size(); ++i) {
+        if (!product_index.emplace(products[i], i).second) {
+            throw std::invalid_argument("Duplicate product in pool: " + products[i]);
+        }
+        handoff_target[i].store(NO_HANDOFF, std::memory_order_relaxed);
+    }
+    
+    size_t session_count = session_messages.size();
+    assignment = initialAssignment(products.size(), session_count);
+    session_rates.assign(session_count, 0.0);
+    rate_baseline.assign(session_count, 0);
+    rebalance_baseline.assign(products.size(), 0);
+    
+    for (size_t s = 0; s < session_count; ++s) {
+        std::vector<std::string> assigned;
+        for (size_t p = 0; p < products.size(); ++p) {
+            if (assignment[p] == s) assigned.push_back(products[p]);
+        }
+        
+        auto session = std::make_unique<WebSocketClient>(assigned.front(), logger, options.transport, options.url);
+        session->addProducts(assigned);
+        session->setDataCallback([this, s](TickerData& ticker) { deliver(s, ticker); });
+        sessions.push_back(std::move(session));
+        queues.push_back(std::make_unique<SPSCRing<TickerData>>(options.queue_capacity));
+        
+        std::string labels = "session=\"" + std::to_string(s) + "\"";
+        rate_metrics.push_back(&MetricsRegistry::global().gauge("hft_pool_session_message_rate",
+            "Messages per second received on each pool session", labels));
+        products_metrics.push_back(&MetricsRegistry::global().gauge("hft_pool_session_products",
+            "Products subscribed on each pool session", labels));
+        products_metrics.back()->set(static_cast<double>(assigned.size()));
+    }
+    
+    logger.info("WebSocket pool: " + std::to_string(products.size()) + " products over " +
+               std::to_string(session_count) + " sessions");
+}
+
+WebSocketPool::~WebSocketPool() {
+    stop();
+}
+
+void WebSocketPool::setDataCallback(std::function<void(TickerData&)> callback) {
+    data_callback = std::move(callback);
+}
+
+void WebSocketPool::start() {
+    if (running) return;
+    
+    running = true;
+    delivering = true;
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        last_rate_sample = now;
+        last_rebalance = now;
+        rebalance_requested = false;
+    }
+    delivery_thread = std::thread(&WebSocketPool::deliveryLoop, this);
+    control_thread = std::thread(&WebSocketPool::controlLoop, this);
+    for (auto& session : sessions) {
+        session->start();
+    }
+}
+
+void WebSocketPool::stop() {
+    if (!running) return;
+    
+    // Sessions first: once their transport threads are joined nothing more is
+    // pushed, and the delivery thread empties the rings before it exits
+    for (auto& session : sessions) {
+        session->stop();
+    }
+    {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        running = false;
+    }
+    control_cv.notify_all();
+    control_thread.join();
+    delivery_thread.join();
+    logStatistics();
+}
+
+void WebSocketPool::rebalance() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        rebalance_requested = true;
+    }
+    control_cv.notify_all();
+}
+
+bool WebSocketPool::moveProduct(const std::string& product_id, size_t to_session) {
+    auto it = product_index.find(product_id);
+    if (it == product_index.end() || to_session >= sessions.size()) return false;
+    
+    std::lock_guard<std::mutex> lock(state_mutex);
+    size_t product = it->second;
+    if (assignment[product] == to_session) return false;
+    for (const auto& handoff : handoffs) {
+        if (handoff.product == product) return false;
+    }
+    startHandoff(product, to_session, std::chrono::steady_clock::now());
+    return true;
+}
+
+void WebSocketPool::deliver(size_t session, TickerData& ticker) {
+    session_messages[session].fetch_add(1, std::memory_order_relaxed);
+    
+    // Duplicates and the order across sessions are settled on the delivery thread
+    auto it = product_index.find(ticker.product_id);
+    if (it != product_index.end()) {
+        product_messages[session * products.size() + it->second].fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    SPSCRing<TickerData>& queue = *queues[session];
+    while (!queue.push(ticker)) {
+        if (!delivering.load(std::memory_order_acquire)) {
+            throw std::logic_error("WebSocketPool session " + std::to_string(session) +
+                                   " queue is full and no delivery thread is running");
+        }
+        backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+}
+
+void WebSocketPool::deliveryLoop() {
+    AllocationScope scope(AllocationTag::RECEIVE);
+    TickerData ticker;
+    int idle_passes = 0;
+    while (true) {
+        // Exit only after a pass that began once stop() was seen came up empty;
+        // a pass that began earlier may have missed the sessions' last pushes
+        bool stopping = !running.load();
+        bool delivered_any = false;
+        for (size_t s = 0; s < queues.size(); ++s) {
+            for (size_t n = 0; n < DELIVERY_BATCH && queues[s]->pop(ticker); ++n) {
+                delivered_any = true;
+                route(s, ticker);
+            }
+        }
+        
+        // A handoff can finish without another tick from either session
+        for (size_t p = 0; products_held > 0 && p < products.size(); ++p) {
+            if (!held[p].ticks.empty() && handoff_target[p].load(std::memory_order_acquire) != held[p].session) {
+                releaseHeld(p);
+                delivered_any = true;
+            }
+        }
+        
+        if (delivered_any) {
+            idle_passes = 0;
+        } else if (stopping) {
+            break;
+        } else if (++idle_passes < DELIVERY_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(DELIVERY_IDLE_SLEEP);
+        }
+    }
+    
+    // Rings are empty; ticks held for a handoff that never finished go last
+    for (size_t p = 0; products_held > 0 && p < products.size(); ++p) {
+        if (!held[p].ticks.empty()) {
+            releaseHeld(p);
+        }
+    }
+    delivering.store(false, std::memory_order_release);
+}
+
+void WebSocketPool::route(size_t session, TickerData& ticker) {
+    auto it = product_index.find(ticker.product_id);
+    if (it == product_index.end()) {
+        delivered.fetch_add(1, std::memory_order_relaxed);
+        if (data_callback) {
+            data_callback(ticker);
+        }
+        return;
+    }
+    
+    size_t product = it->second;
+    size_t target = handoff_target[product].load(std::memory_order_acquire);
+    HeldTicks& holding = held[product];
+    
+    // Once the handoff the held ticks belong to has finished, they follow
+    // whatever the old session queued and precede the new session's next tick
+    size_t held_session = holding.session;
+    bool finished = !holding.ticks.empty() && target != held_session;
+    if (finished && session == held_session) {
+        releaseHeld(product);
+    }
+    
+    if (target == session) {
+        if (holding.ticks.empty()) {
+            holding.session = session;
+            products_held++;
+        }
+        holding.ticks.push_back(ticker);
+    } else {
+        dispatch(product, ticker);
+    }
+    
+    if (finished && session != held_session) {
+        releaseHeld(product);
+    }
+}
+
+void WebSocketPool::dispatch(size_t product, TickerData& ticker) {
+    // At most once per exchange sequence, whichever session has it first
+    if (ticker.exchange_sequence != 0) {
+        if (ticker.exchange_sequence <= last_delivered[product]) {
+            duplicates_dropped.fetch_add(1, std::memory_order_relaxed);
+            duplicates_metric.increment();
+            return;
+        }
+        last_delivered[product] = ticker.exchange_sequence;
+    }
+    
+    delivered.fetch_add(1, std::memory_order_relaxed);
+    if (data_callback) {
+        data_callback(ticker);
+    }
+}
+
+void WebSocketPool::releaseHeld(size_t product) {
+    HeldTicks holding;
+    std::swap(holding, held[product]);
+    held[product].session = NO_HANDOFF;
+    products_held--;
+    
+    // Whatever the other rings held when the handoff finished was received
+    // before it; anything the old session pushes later arrived while the new
+    // one was already live, so it is a duplicate or newer than the held ticks
+    TickerData ticker;
+    for (size_t s = 0; s < queues.size(); ++s) {
+        if (s == holding.session) continue;
+        for (size_t n = 0; n < options.queue_capacity && queues[s]->pop(ticker); ++n) {
+            route(s, ticker);
+        }
+    }
+    for (auto& held_ticker : holding.ticks) {
+        dispatch(product, held_ticker);
+    }
+}
+
+void WebSocketPool::controlLoop() {
+    AllocationScope scope(AllocationTag::RECEIVE);
+    std::unique_lock<std::mutex> lock(control_mutex);
+    while (running) {
+        control_cv.wait_for(lock, CONTROL_PERIOD);
+        if (!running) break;
+        lock.unlock();
+        
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> state(state_mutex);
+            advanceHandoffs(now);
+            if (now - last_rate_sample >= options.rate_window) {
+                sampleRates(now);
+            }
+            
+            // One round of moves at a time; a request waits for the current round
+            bool due = options.rebalance_interval.count() > 0 && now - last_rebalance >= options.rebalance_interval;
+            if (handoffs.empty() && (due || rebalance_requested)) {
+                rebalance_requested = false;
+                rebalanceNow(now);
+            }
+        }
+        
+        lock.lock();
+    }
+}
+
+void WebSocketPool::sampleRates(std::chrono::steady_clock::time_point now) {
+    double seconds = secondsBetween(last_rate_sample, now);
+    last_rate_sample = now;
+    
+    for (size_t s = 0; s < sessions.size(); ++s) {
+        size_t messages = session_messages[s].load(std::memory_order_relaxed);
+        session_rates[s] = static_cast<double>(messages - rate_baseline[s]) / seconds;
+        rate_baseline[s] = messages;
+        rate_metrics[s]->set(session_rates[s]);
+        products_metrics[s]->set(static_cast<double>(std::count(assignment.begin(), assignment.end(), s)));
+    }
+}
+
+void WebSocketPool::rebalanceNow(std::chrono::steady_clock::time_point now) {
+    double seconds = secondsBetween(last_rebalance, now);
+    last_rebalance = now;
+    
+    std::vector<double> rates(products.size());
+    for (size_t p = 0; p < products.size(); ++p) {
+        size_t total = 0;
+        for (size_t s = 0; s < sessions.size(); ++s) {
+            total += productMessages(s, p);
+        }
+        rates[p] = static_cast<double>(total - rebalance_baseline[p]) / seconds;
+        rebalance_baseline[p] = total;
+    }
+    
+    std::vector<Move> moves = planRebalance(assignment, rates, sessions.size(),
+                                            options.imbalance_tolerance, options.max_moves_per_rebalance);
+    if (moves.empty()) {
+        logger.debug("WebSocket pool balanced, no moves");
+        return;
+    }
+    
+    logger.info("Rebalancing WebSocket pool: moving " + std::to_string(moves.size()) + " products");
+    for (const auto& move : moves) {
+        startHandoff(move.product, move.to, now);
+    }
+}
+
+void WebSocketPool::startHandoff(size_t product, size_t to, std::chrono::steady_clock::time_point now) {
+    size_t from = assignment[product];
+    handoffs.push_back(Handoff{product, from, to, productMessages(to, product), now + options.handoff_timeout});
+    assignment[product] = to;
+    handoff_target[product].store(to, std::memory_order_release);
+    
+    // New session first; the old one keeps it until the new one has delivered it
+    sessions[to]->subscribe({products[product]});
+    logger.info("Moving " + products[product] + " from pool session " + std::to_string(from) +
+               " to " + std::to_string(to));
+}
+
+void WebSocketPool::advanceHandoffs(std::chrono::steady_clock::time_point now) {
+    for (auto it = handoffs.begin(); it != handoffs.end();) {
+        bool arrived = productMessages(it->to, it->product) > it->seen_on_target;
+        if (!arrived && now < it->deadline) {
+            ++it;
+            continue;
+        }
+        
+        sessions[it->from]->unsubscribe({products[it->product]});
+        handoff_target[it->product].store(NO_HANDOFF, std::memory_order_release);
+        moves_completed++;
+        moves_metric.increment();
+        logger.info("Moved " + products[it->product] + " to pool session " + std::to_string(it->to) +
+                   (arrived ? "" : " (no tick within the handoff timeout)"));
+        it = handoffs.erase(it);
+    }
+}
+
+size_t WebSocketPool::sessionOf(const std::string& product_id) const {
+    auto it = product_index.find(product_id);
+    if (it == product_index.end()) {
+        throw std::invalid_argument("Product not in pool: " + product_id);
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return assignment[it->second];
+}
+
+size_t WebSocketPool::getPendingHandoffs() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return handoffs.size();
+}
+
+size_t WebSocketPool::getMovesCompleted() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return moves_completed;
+}
+
+std::vector<PoolSessionStats> WebSocketPool::getSessionStats() const {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    std::vector<PoolSessionStats> stats;
+    for (size_t s = 0; s < sessions.size(); ++s) {
+        stats.push_back(PoolSessionStats{s, static_cast<size_t>(std::count(assignment.begin(), assignment.end(), s)),
+                                         session_messages[s].load(std::memory_order_relaxed), session_rates[s],
+                                         sessions[s]->isConnected()});
+    }
+    return stats;
+}
+
+void WebSocketPool::logStatistics() const {
+    for (const auto& session : getSessionStats()) {
+        std::ostringstream line;
+        line.setf(std::ios::fixed);
+        line.precision(1);
+        line << "Pool session " << session.session << ": " << session.products << " products, "
+             << session.messages << " messages, " << session.message_rate << " msg/s"
+             << (session.connected ? "" : ", disconnected");
+        logger.info(line.str());
+    }
+    logger.info("Pool delivered " + std::to_string(getDelivered()) + " ticks | Duplicates dropped: " +
+               std::to_string(getDuplicatesDropped()) + " | Moves: " + std::to_string(getMovesCompleted()) +
+               " | Backpressure waits: " + std::to_string(getBackpressureWaits()));
+}
+
+std::vector<size_t> WebSocketPool::initialAssignment(size_t product_count, size_t session_count) {
+    std::vector<size_t> result(product_count);
+    for (size_t p = 0; p < product_count; ++p) {
+        result[p] = session_count > 0 ? p % session_count : 0;
+    }
+    return result;
+}
+
+std::vector<WebSocketPool::Move> WebSocketPool::planRebalance(const std::vector<size_t>& assignment,
+                                                              const std::vector<double>& rates, size_t session_count,
+                                                              double tolerance, size_t max_moves) {
+    std::vector<Move> moves;
+    if (session_count < 2) return moves;
+    
+    std::vector<double> load(session_count, 0.0);
+    double total = 0.0;
+    for (size_t p = 0; p < assignment.size(); ++p) {
+        load[assignment[p]] += rates[p];
+        total += rates[p];
+    }
+    double mean = total / static_cast<double>(session_count);
+    if (mean <= 0.0) return moves;
+    
+    std::vector<bool> moved(assignment.size(), false);
+    while (moves.size() < max_moves) {
+        size_t busiest = static_cast<size_t>(std::max_element(load.begin(), load.end()) - load.begin());
+        size_t idlest = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+        if (load[busiest] <= mean * (1.0 + tolerance)) break;
+        
+        // Moving rate r leaves max(busiest - r, idlest + r); best when r is
+        // nearest half the gap, and no improvement at all once r >= gap. On a
+        // tie the quieter product moves: both sessions carry it while it moves.
+        double gap = load[busiest] - load[idlest];
+        size_t best = assignment.size();
+        double best_distance = std::numeric_limits<double>::infinity();
+        for (size_t p = 0; p < assignment.size(); ++p) {
+            if (moved[p] || assignment[p] != busiest || rates[p] <= 0.0 || rates[p] >= gap) continue;
+            double distance = std::abs(rates[p] - gap / 2.0);
+            bool tie = best < assignment.size() && std::abs(distance - best_distance) < 1e-9;
+            if (tie ? rates[p] < rates[best] : distance < best_distance) {
+                best = p;
+                best_distance = distance;
+            }
+        }
+        if (best == assignment.size()) break;
+        
+        moved[best] = true;
+        load[busiest] -= rates[best];
+        load[idlest] += rates[best];
+        moves.push_back(Move{best, busiest, idlest});
+    }
+    return moves;
+}
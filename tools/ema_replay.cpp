@@ -0,0 +1,89 @@
+// Recomputes price and mid-price EMAs over captured ticker_data.csv files
+// (plain or rolled .csv.gz segments) without running the live app.
+//
+// Usage: ema_replay [--alpha A] [--price-alpha A] [--mid-alpha A] [--threads N]
+//                   [--binary] --output PATH input.csv [input2.csv ...]
+//
+// Inputs are replayed in the order given, so pass rolled segments oldest first.
+// The EMAs are those of the rows in the inputs. The live CSV is conflated, so
+// replaying it gives EMAs of that subsample, not the live columns; only an
+// unconflated capture replayed with the live alpha (0.2) reproduces its input
+// byte for byte.
+#include "ema_replay.h"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage() {
+    std::fprintf(stderr, "usage: ema_replay [--alpha A] [--price-alpha A] [--mid-alpha A] [--threads N]\n"
+                         "                  [--binary] --output PATH input.csv [input2.csv ...]\n"
+                         "EMAs are recomputed from the input rows only; a conflated capture (the live\n"
+                         "default) yields EMAs of that subsample, not the values the live app computed.\n");
+    std::exit(2);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    EMAReplayOptions options;
+    std::string output;
+    bool binary = false;
+    std::vector<std::string> inputs;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (arg == "--alpha") {
+            options.price_alpha = options.mid_price_alpha = std::atof(value());
+        } else if (arg == "--price-alpha") {
+            options.price_alpha = std::atof(value());
+        } else if (arg == "--mid-alpha") {
+            options.mid_price_alpha = std::atof(value());
+        } else if (arg == "--threads") {
+            options.threads = std::strtoul(value(), nullptr, 10);
+        } else if (arg == "--output" || arg == "-o") {
+            output = value();
+        } else if (arg == "--binary") {
+            binary = true;
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage();
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (output.empty() || inputs.empty()) {
+        usage();
+    }
+    
+    try {
+        EMAReplay replay(options);
+        for (const auto& input : inputs) {
+            replay.addInput(input);
+        }
+        const EMAReplayStats& stats = replay.run();
+        binary ? replay.writeBinary(output) : replay.writeCSV(output);
+        
+        double busy = stats.index_seconds + stats.compute_seconds;
+        double rows_per_second = busy > 0 ? stats.rows / busy : 0.0;
+        std::printf("rows: %zu (%zu malformed skipped), products: %zu, threads: %zu\n",
+                    stats.rows, stats.malformed_rows, stats.products, stats.threads);
+        std::printf("index:   %8.3f s  %12.0f rows/s\n", stats.index_seconds,
+                    stats.index_seconds > 0 ? stats.rows / stats.index_seconds : 0.0);
+        std::printf("compute: %8.3f s  %12.0f rows/s\n", stats.compute_seconds,
+                    stats.compute_seconds > 0 ? stats.rows / stats.compute_seconds : 0.0);
+        std::printf("output:  %8.3f s  (%s)\n", stats.output_seconds, output.c_str());
+        std::printf("index+compute: %.0f rows/s, %.0f rows/s per core\n",
+                    rows_per_second, rows_per_second / stats.threads);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "ema_replay: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Turns a binary log (Logger with LogFormat::BINARY) back into the text the
+// text format would have written, line for line.
+//
+// Usage: log_decode input.blog [output.log]
+//
+// Without an output path the text goes to stdout. Timestamps are rendered in
+// the local time zone, as the logger does. A record cut short by a crash ends
+// the output; everything before it is decoded.
+#include "binary_log.h"
+#include "mapped_file.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: log_decode input.blog [output.log]\n");
+        return 2;
+    }
+    
+    try {
+        MappedFile input(argv[1]);
+        std::string text;
+        text.reserve(input.size() * 4);
+        size_t records = binlog::decode(input.view(), text);
+        
+        FILE* output = argc > 2 ? std::fopen(argv[2], "wb") : stdout;
+        if (!output) {
+            std::fprintf(stderr, "log_decode: cannot create %s\n", argv[2]);
+            return 1;
+        }
+        bool written = std::fwrite(text.data(), 1, text.size(), output) == text.size();
+        if (output != stdout) {
+            written = std::fclose(output) == 0 && written;
+        }
+        if (!written) {
+            std::fprintf(stderr, "log_decode: write failed\n");
+            return 1;
+        }
+        std::fprintf(stderr, "%zu records, %zu bytes binary -> %zu bytes text\n", records, input.size(), text.size());
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "log_decode: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}